@@ -2,6 +2,7 @@
 #include "LoadFile.h"
 
 #include "./libs/Restart.h"
+#include "./util/Log.h"
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,7 +33,7 @@ int LoadFile(char* path, char** buffer, int* size)
 	    strcat(newpath, ".html");
 	    if ((fd = r_open2(newpath, O_RDONLY)) == -1) 
 	    {
-	        fprintf(stderr, "[%ld] Failed to open %s: %s\n", (long)getpid(), path, strerror(errno));
+	        fprintf(stderr, "[%ld] Failed to open %s: %s\n", GetLogId(), path, strerror(errno));
 	        return -2;
 	    }
 	} 
@@ -40,32 +41,32 @@ int LoadFile(char* path, char** buffer, int* size)
 	int filesize = (int) lseek(fd, 0, SEEK_END); 
 	if ((int)lseek(fd, 0, SEEK_SET) == -1) 
 	{ 
-	    fprintf(stderr, "[%ld] Failed to move file offset back to beginning after getting the file size: %s\n", (long)getpid(), strerror(errno));
+	    fprintf(stderr, "[%ld] Failed to move file offset back to beginning after getting the file size: %s\n", GetLogId(), strerror(errno));
 	    if (r_close(fd) == -1) 
-	        fprintf(stderr, "[%ld] Failed to close: %s: %s\n", (long)getpid, path, strerror(errno));
+	        fprintf(stderr, "[%ld] Failed to close: %s: %s\n", GetLogId(), path, strerror(errno));
 	    return -1;
 	}
 	
 	char* bytes;
 	if ((bytes = (char*) malloc( (filesize+1) * sizeof(char))) == 0) 
 	{
-	    fprintf(stderr, "[%ld] Failed to allocate memory to read the file content\n", (long)getpid());
+	    fprintf(stderr, "[%ld] Failed to allocate memory to read the file content\n", GetLogId());
 	    if (r_close(fd) == -1) 
-	        fprintf(stderr, "[%ld] Failed to close: %s: %s\n", (long)getpid, path, strerror(errno));
+	        fprintf(stderr, "[%ld] Failed to close: %s: %s\n", GetLogId(), path, strerror(errno));
 	    return -1;
 	}
 	
 	int bytesread;
 	if ((bytesread = readblock(fd, bytes, filesize)) <= 0) 
 	{
-	    fprintf(stderr, "[%ld] Failed to read the requested file: %s: %s\n", (long)getpid(), path, strerror(errno));
+	    fprintf(stderr, "[%ld] Failed to read the requested file: %s: %s\n", GetLogId(), path, strerror(errno));
 	    if (r_close(fd) == -1) 
-	        fprintf(stderr, "[%ld] Failed to close: %s: %s\n", (long)getpid, path, strerror(errno));
+	        fprintf(stderr, "[%ld] Failed to close: %s: %s\n", GetLogId(), path, strerror(errno));
 	    return -1;
 	}
 	
 	if (r_close(fd) == -1)
-	    fprintf(stderr, "[%ld] Failed to close: %s: %s\n", (long)getpid, path, strerror(errno));
+	    fprintf(stderr, "[%ld] Failed to close: %s: %s\n", GetLogId(), path, strerror(errno));
 
 	bytes[bytesread] = '\0';
 	*buffer = bytes;  // The buffer needs to be manually freed later
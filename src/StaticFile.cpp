@@ -0,0 +1,137 @@
+#include "StaticFile.h"
+
+#include "LoadFile.h"
+#include "./libs/Restart.h"
+#include "./pages/CreatePages.h"
+#include "./server/Server.h"
+#include "./util/Log.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// The files are opened once and kept open, so every worker process and thread can send them
+// with "sendfile" directly from the open file descriptor
+static StaticFile static_files[] = {
+    { "./resources/homepage/index.html", TYPE_HTML, false, -1, 0, 0, "", 0 },
+    { "./resources/homepage/main.js", TYPE_JAVASCRIPT, false, -1, 0, 0, "", 0 },
+    { TEMPLATE_ATHLETE, TYPE_HTML, true, -1, 0, 0, "", 0 },
+    { TEMPLATE_RACE, TYPE_HTML, true, -1, 0, 0, "", 0 },
+};
+static const int STATIC_FILE_COUNT = sizeof(static_files) / sizeof(static_files[0]);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Opens all static files, and precomputes the header lines that describe their content
+ * This should be called once at startup, before any threads or worker processes are started.
+ * The files are never reopened, so the server needs to be restarted to pick up changes to them
+ *
+ * Returns 0 if all files were opened, and -1 if any file failed to open
+ * --------------------------------------------------------------------------------------------------
+ */
+int StaticFile_OpenAll()
+{
+    int result = 0;
+    for (int i = 0; i < STATIC_FILE_COUNT; i++)
+    {
+        StaticFile* file = &(static_files[i]);
+        if (file->fd != -1) {
+            continue;
+        }
+
+        struct stat info;
+        if ((file->fd = r_open2(file->path, O_RDONLY)) == -1 || fstat(file->fd, &info) == -1) {
+            fprintf(stderr, "[%ld] Failed to open static file: %s: %s\n", GetLogId(), file->path, strerror(errno));
+            if (file->fd != -1) { r_close(file->fd); }
+            file->fd = -1;
+            result = -1;
+            continue;
+        }
+        file->size = (int) info.st_size;
+        file->header_size = snprintf(file->header, STATIC_HEADER_MAX_SIZE, "Content-Type: %s\r\nContent-Length: %d\r\n\r\n", file->type, file->size);
+
+        if (file->keep_content && LoadFile((char*) file->path, &(file->content), 0) < 0) {
+            file->content = 0;
+            result = -1;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets a static file that has been opened by "StaticFile_OpenAll"
+ *
+ * path: The path to the file
+ * file: Set to the static file. It is shared and must not be modified
+ *
+ * Returns 0 on success
+ * Returns -2 if the file has not been opened
+ * --------------------------------------------------------------------------------------------------
+ */
+int StaticFile_Get(const char* path, const StaticFile** file)
+{
+    for (int i = 0; i < STATIC_FILE_COUNT; i++)
+    {
+        if (static_files[i].fd != -1 && strcmp(static_files[i].path, path) == 0) {
+            *file = &(static_files[i]);
+            return 0;
+        }
+    }
+    return -2;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Loads the content of a file into a buffer
+ * Uses the shared in-memory copy if the file is a static file that is kept in memory, otherwise the file is read from disk.
+ * The buffer must not be modified, and needs to be released with "StaticFile_FreeContent"
+ *
+ * path: The path to the file
+ * buffer: Set to the content of the file
+ * size: Set to the size of the file
+ *
+ * Returns 0 on success
+ * Returns -1 on internal errors
+ * Returns -2 if the file could not be opened
+ * --------------------------------------------------------------------------------------------------
+ */
+int StaticFile_LoadContent(char* path, char** buffer, int* size)
+{
+    for (int i = 0; i < STATIC_FILE_COUNT; i++)
+    {
+        if (static_files[i].content != 0 && strcmp(static_files[i].path, path) == 0) {
+            *buffer = static_files[i].content;
+            if (size) {
+                *size = static_files[i].size;
+            }
+            return 0;
+        }
+    }
+    return LoadFile(path, buffer, size);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Releases a buffer that was returned by "StaticFile_LoadContent"
+ * Shared in-memory copies are kept, and all other buffers are freed
+ * --------------------------------------------------------------------------------------------------
+ */
+void StaticFile_FreeContent(char* buffer)
+{
+    if (buffer == 0) {
+        return;
+    }
+    for (int i = 0; i < STATIC_FILE_COUNT; i++) {
+        if (static_files[i].content == buffer) {
+            return;
+        }
+    }
+    free(buffer);
+}
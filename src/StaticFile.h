@@ -0,0 +1,21 @@
+#pragma once
+
+#define STATIC_HEADER_MAX_SIZE 256
+
+typedef struct {
+    const char* path;
+    const char* type;
+    bool keep_content;  // Templates are also kept in memory, since they are read for every generated page
+    int fd;
+    int size;
+    char* content;
+
+    // The "Content-Type" and "Content-Length" lines, and the empty line that ends the header
+    char header[STATIC_HEADER_MAX_SIZE];
+    int header_size;
+} StaticFile;
+
+int StaticFile_OpenAll();
+int StaticFile_Get(const char* path, const StaticFile** file);
+int StaticFile_LoadContent(char* path, char** buffer, int* size);
+void StaticFile_FreeContent(char* buffer);
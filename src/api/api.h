@@ -3,14 +3,6 @@
 
 #include "../libs/cJSON.h"
 
-#define DB_ATHLETES       "./db/athletes.bin"
-#define DB_ATHLETES_RACES "./db/athletes-races.bin"
-#define DB_RACE_INFO      "./db/races-info.bin"
-#define DB_RACE_RESULTS   "./db/races-results.bin"
-
-
-int load_resource(char* path, char** buffer, int* size, int* status_code);
-
 
 /* ===============================================================
  * Api calls for getting athletes
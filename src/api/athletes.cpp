@@ -4,8 +4,10 @@
 
 #include "../server/Server.h"
 //#include "../Response.h"
+#include "../db/Database.h"
 #include "../libs/cJSON.h"
 #include "../util/StringUtil.h"
+#include "../util/Log.h"
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,7 +17,8 @@
 
 enum name_t { FIRSTNAME, LASTNAME, FULLNAME };
 static int getAthletes_name(int socket, name_t name_type, char* search_str);
-static cJSON* convertAthleteToJSON(char* buffer, int buffer_size, int start);
+static bool isNameMatch(const char* name, const char* search_str, int search_str_size);
+static cJSON* convertAthleteToJSON(const AthleteRecord* record);
 
 
 /**
@@ -77,69 +80,30 @@ int api_getAthlete_fiscode(int socket, char* fiscode)
     // -----------------------------------------------------------------
     int fiscode_int = validate_and_convert_parameter(fiscode);
     if (fiscode_int <= -1) {
-        fprintf(stderr, "[%ld] HTTP 400: Api call failed, invalid parameter\n", (long)getpid());
-        SendHttpResponse(socket, 400, CONNECTION_CLOSE, TYPE_HTML, "400 Bad Request: Invalid parameter");
+        fprintf(stderr, "[%ld] HTTP 400: Api call failed, invalid parameter\n", GetLogId());
+        SendHttpResponse(socket, 400, CONNECTION_ALIVE, TYPE_HTML, "400 Bad Request: Invalid parameter");
         return -1;
     }
     
     
-    // -----------------------------------------------------------------
-    // Load the file that stores all athletes 
-    // -----------------------------------------------------------------
-    char file[] = DB_ATHLETES;
-    char* buffer = 0;
-    int buffer_size = 0;
-    int status_code = 500;  // Default status code on failure
-    if (load_resource(file, &buffer, &buffer_size, &status_code) == -1) {
-        SendHttpResponse(socket, status_code, CONNECTION_CLOSE, TYPE_HTML, "Failed to load requested resource");
-        if (buffer != 0) free(buffer);
-        return -1;
-    }
-
-
     // -----------------------------------------------------------------
     // Try to find the athlete with the requsted fiscode
     // -----------------------------------------------------------------
-    cJSON* athlete = NULL;
-    int currentByte = 0;   
-    int offset = 0; 
-    while (currentByte < buffer_size)
-    {
-        // Extract and combines the bytes that stores the fiscode
-        offset = currentByte;
-        unsigned char bytes[4];
-        bytes[0] = buffer[currentByte++]; 
-        bytes[1] = buffer[currentByte++]; 
-        bytes[2] = buffer[currentByte++];
-        bytes[3] = buffer[currentByte++];
-        unsigned int combined_bytes = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-        if (fiscode_int == combined_bytes) {
-            athlete = convertAthleteToJSON(buffer, buffer_size, offset);
-            break;
-        }
-        else {
-            // Move past all the data for this current athlete, since the current fiscode does not match the requested one
-            currentByte += 4;  
-            int string_counter = 0; 
-            while (string_counter < 6 && currentByte < buffer_size) {
-                if (buffer[currentByte++] == '\0') {
-                    string_counter++;  
-                }
-            }
-        }
+    AthleteRecord record;
+    int res = Database_FindAthlete(fiscode_int, &record);
+    if (res == -1) {
+        SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "Failed to load requested resource");
+        return -1;
     }
-
-    if (buffer != 0) 
-        free(buffer);
+    cJSON* athlete = (res == 0) ? convertAthleteToJSON(&record) : NULL;
 
 
     // ------------------------------------------------------------
     // Check if the requested athlete was found
     // ------------------------------------------------------------
     if (athlete == NULL) {
-        fprintf(stderr, "[%ld] HTTP 404: Could not find the requested athlete\n", (long)getpid());
-        SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "404 Not Found: Could not find the requested athlete");
+        fprintf(stderr, "[%ld] HTTP 404: Could not find the requested athlete\n", GetLogId());
+        SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "404 Not Found: Could not find the requested athlete");
         return -1;
     }
 
@@ -154,12 +118,12 @@ int api_getAthlete_fiscode(int socket, char* fiscode)
     if (athlete_str != 0) free(athlete_str);
     cJSON_Delete(athlete);
 
-    if (SendHttpResponse(socket, 200, CONNECTION_CLOSE, TYPE_JSON, response) == -1) {
+    if (SendHttpResponse(socket, 200, CONNECTION_ALIVE, TYPE_JSON, response) == -1) {
         if (response != 0) free(response);
         return -1;
     }
 
-    fprintf(stderr, "[%ld] HTTP 200: Found and sent back the requested athlete!\n", (long)getpid());
+    fprintf(stderr, "[%ld] HTTP 200: Found and sent back the requested athlete!\n", GetLogId());
     if (response != 0) free(response);
     
     return 0;
@@ -190,13 +154,13 @@ static int getAthletes_name(int socket, name_t name_type, char* search_str)
     // Validate the search string and convert it to lower case
     // -----------------------------------------------------------------
     if (search_str == 0 || strlen(search_str) == 0) {
-        fprintf(stderr, "[%ld] HTTP 400: Api call failed. Invalid parameter, no search string was given\n", (long)getpid());
-        SendHttpResponse(socket, 400, CONNECTION_CLOSE, TYPE_HTML, "400 Bad Request: Invalid parameter, no search string was given");
+        fprintf(stderr, "[%ld] HTTP 400: Api call failed. Invalid parameter, no search string was given\n", GetLogId());
+        SendHttpResponse(socket, 400, CONNECTION_ALIVE, TYPE_HTML, "400 Bad Request: Invalid parameter, no search string was given");
         return -1;
     }
     if (!isalpha(search_str[0])) {
-        fprintf(stderr, "[%ld] HTTP 400: Api call failed. Invalid search string\n", (long)getpid());
-        SendHttpResponse(socket, 400, CONNECTION_CLOSE, TYPE_HTML, "400 Bad Request: Invalid search string");
+        fprintf(stderr, "[%ld] HTTP 400: Api call failed. Invalid search string\n", GetLogId());
+        SendHttpResponse(socket, 400, CONNECTION_ALIVE, TYPE_HTML, "400 Bad Request: Invalid search string");
         return -1;
     }
 
@@ -252,8 +216,8 @@ static int getAthletes_name(int socket, name_t name_type, char* search_str)
 
         // Make sure the substrings are valid names
         if (!isValidNames) {
-            fprintf(stderr, "[%ld] HTTP 400: Api call failed, invalid parameter\n", (long)getpid());
-            SendHttpResponse(socket, 400, CONNECTION_CLOSE, TYPE_HTML, "400 Bad Request: Invalid parameter");
+            fprintf(stderr, "[%ld] HTTP 400: Api call failed, invalid parameter\n", GetLogId());
+            SendHttpResponse(socket, 400, CONNECTION_ALIVE, TYPE_HTML, "400 Bad Request: Invalid parameter");
             return -1;
         }
 
@@ -263,15 +227,13 @@ static int getAthletes_name(int socket, name_t name_type, char* search_str)
 
 
     // -----------------------------------------------------------------
-    // Load the file that stores all athletes 
+    // Read the first athlete in the database. The rest are read one at a time while searching
     // -----------------------------------------------------------------
-    char file[] = DB_ATHLETES;
-    char* buffer = 0;
-    int buffer_size = 0;
-    int status_code = 500;  // Default status code on failure
-    if (load_resource(file, &buffer, &buffer_size, &status_code) == -1) {
-        SendHttpResponse(socket, status_code, CONNECTION_CLOSE, TYPE_HTML, "Failed to load requested resource");
-        if (buffer != 0) free(buffer);
+    AthleteRecord record;
+    int offset = 0;
+    int res = Database_NextAthlete(&offset, &record);
+    if (res == -1) {
+        SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "Failed to load requested resource");
         return -1;
     }
 
@@ -282,8 +244,8 @@ static int getAthletes_name(int socket, name_t name_type, char* search_str)
     cJSON* json_array = cJSON_CreateArray();
     if (json_athletes == NULL || json_array == NULL) 
     {
-        fprintf(stderr, "[%ld] HTTP 500: Failed to create JSON object\n", (long)getpid());
-        SendHttpResponse(socket, 500, CONNECTION_CLOSE, TYPE_HTML, "500 Internal Server Error: Failed to create JSON object");
+        fprintf(stderr, "[%ld] HTTP 500: Failed to create JSON object\n", GetLogId());
+        SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "500 Internal Server Error: Failed to create JSON object");
         if (json_athletes != 0) cJSON_Delete(json_athletes);
         if (json_array != 0) cJSON_Delete(json_array);
         return -1;
@@ -295,105 +257,25 @@ static int getAthletes_name(int socket, name_t name_type, char* search_str)
     // Try to find athletes that matches the search
     // -----------------------------------------------------------------
     int found_counter = 0;
-    int currentByte = 0;    
-    int offset = 0;
-    while (currentByte < buffer_size)
+    for (; res == 0; res = Database_NextAthlete(&offset, &record))
     {
-        // Skip the fiscode and the compid
-        offset = currentByte;
-        currentByte += 8;
-        if (currentByte >= buffer_size) break;
-
-
-        if (name_type == FIRSTNAME)
-        {
-            // Read the firstname and convert it to lowercase
-            char firstname[256];
-            int str_index = 0;
-            while (buffer[currentByte++] != '\0' && str_index < 256 && currentByte-1 < buffer_size) {
-                firstname[str_index++] = tolower(buffer[currentByte - 1]); 
-            }
-            firstname[str_index] = '\0';
-
-            // Add the athlete to the array if the firstname matches the search string
-            if (strncmp(firstname, search_str, search_str_size) == 0) {
-                cJSON* athlete = convertAthleteToJSON(buffer, buffer_size, offset);
-                cJSON_AddItemReferenceToArray(json_array, athlete);
-                found_counter++;
-            }
-
-            // Skip the rest of the data for this athlete (5 fields)
-            int null_counter = 0; 
-            while (null_counter < 5 && currentByte < buffer_size) {
-                if (buffer[currentByte++] == '\0') {
-                    null_counter++;  
-                }
-            }
+        bool isMatch = false;
+        if (name_type == FIRSTNAME) {
+            isMatch = isNameMatch(record.firstname, search_str, search_str_size);
         }
-
-
-        if (name_type == LASTNAME)
-        {
-            // Skip the firstname
-            while (currentByte < buffer_size && buffer[currentByte++] != '\0');
-
-            // Read the lastname and convert it to lowercase
-            char lastname[256];
-            int str_index = 0;
-            while (buffer[currentByte++] != '\0' && str_index < 256 && currentByte-1 < buffer_size) {
-                lastname[str_index++] = tolower(buffer[currentByte - 1]); 
-            }
-            lastname[str_index] = '\0';
-
-            // Add the athlete to the array if the lastname matches the search string
-            if (strncmp(lastname, search_str, search_str_size) == 0) {
-                cJSON* athlete = convertAthleteToJSON(buffer, buffer_size, offset);
-                cJSON_AddItemReferenceToArray(json_array, athlete);
-                found_counter++;
-            }
-
-            // Skip the rest of the data for this athlete (4 fields)
-            int null_counter = 0; 
-            while (null_counter < 4 && currentByte < buffer_size) {
-                if (buffer[currentByte++] == '\0') {
-                    null_counter++;  
-                }
-            }
+        if (name_type == LASTNAME) {
+            isMatch = isNameMatch(record.lastname, search_str, search_str_size);
+        }
+        if (name_type == FULLNAME) {
+            isMatch = isNameMatch(record.firstname, search_str_firstname, search_str_firstname_size) &&
+                      isNameMatch(record.lastname, search_str_lastname, search_str_lastname_size);
         }
 
-
-        if (name_type == FULLNAME)
-        {
-            // Read the first- and lastname and convert them to lowercase
-            char firstname[256];
-            int str_index = 0;
-            while (buffer[currentByte++] != '\0' && str_index < 256 && currentByte-1 < buffer_size) {
-                firstname[str_index++] = tolower(buffer[currentByte - 1]); 
-            }
-            firstname[str_index] = '\0';
-
-            char lastname[256];
-            str_index = 0;
-            while (buffer[currentByte++] != '\0' && str_index < 256 && currentByte-1 < buffer_size) {
-                lastname[str_index++] = tolower(buffer[currentByte - 1]); 
-            }
-            lastname[str_index] = '\0';
-
-            // Add the athlete to the array if the first- and lastname matches the search string
-            if ((strncmp(firstname, search_str_firstname, search_str_firstname_size) == 0) && 
-                (strncmp(lastname, search_str_lastname, search_str_lastname_size) == 0)) {
-                cJSON* athlete = convertAthleteToJSON(buffer, buffer_size, offset);
-                cJSON_AddItemReferenceToArray(json_array, athlete);
-                found_counter++;
-            }
-
-            // Skip the rest of the data for this athlete (4 fields)
-            int null_counter = 0; 
-            while (null_counter < 4 && currentByte < buffer_size) {
-                if (buffer[currentByte++] == '\0') {
-                    null_counter++;  
-                }
-            }
+        // Add the athlete to the array if the name matches the search string
+        if (isMatch) {
+            cJSON* athlete = convertAthleteToJSON(&record);
+            cJSON_AddItemToArray(json_array, athlete);
+            found_counter++;
         }
     }
 
@@ -401,16 +283,14 @@ static int getAthletes_name(int socket, name_t name_type, char* search_str)
     // Convert the JSON object to a string and free up allocated memory
     char* athlete_str = cJSON_Print(json_athletes);
     cJSON_Delete(json_athletes);
-    if (buffer != 0) 
-        free(buffer);
 
 
     // ------------------------------------------------------------
     // Check if any athletes was found
     // ------------------------------------------------------------
     if (found_counter <= 0) {
-        fprintf(stderr, "[%ld] HTTP 404: Could not find any athletes\n", (long)getpid());
-        SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "404 Not Found: Could not find any athletes");
+        fprintf(stderr, "[%ld] HTTP 404: Could not find any athletes\n", GetLogId());
+        SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "404 Not Found: Could not find any athletes");
         if (athlete_str != 0) free(athlete_str);
         return -1;
     }
@@ -424,12 +304,12 @@ static int getAthletes_name(int socket, name_t name_type, char* search_str)
     //strcat(response, "\n");  // strcar also adds '\0' at the end
     if (athlete_str != 0) free(athlete_str);
 
-    if (SendHttpResponse(socket, 200, CONNECTION_CLOSE, TYPE_JSON, response) == -1) {
+    if (SendHttpResponse(socket, 200, CONNECTION_ALIVE, TYPE_JSON, response) == -1) {
         if (response != 0) free(response);
         return -1;
     }
 
-    fprintf(stderr, "[%ld] HTTP 200: Found and sent back the results successfully!\n", (long)getpid());
+    fprintf(stderr, "[%ld] HTTP 200: Found and sent back the results successfully!\n", GetLogId());
     if (response != 0) free(response);
     
     return 0;
@@ -439,90 +319,46 @@ static int getAthletes_name(int socket, name_t name_type, char* search_str)
 
 /**
  * -------------------------------------------------------------------------------------
- * Reads one athlete from "buffer", starting at the offset given for "start".
- * It will be read and convert the athlete to a cJSON object. This object needs to be freed manually later.
- * The parameter "buffer" should contain the binary data that gets loaded from the database.
- * 
- * buffer: The binary data for all athletes in the database.
- * buffer_size: The size of the buffer.
- * start: The offset, i.e. the location in the buffer where the requested athlete is stored.
- * 
- * Returns a pointer to a cJSON object on success, and NULL on failure.
+ * Checks if a name begins with the search string, without comparing the case of the letters
+ *
+ * name: The name of an athlete in the database
+ * search_str: The search string, that has already been converted to lowercase
+ * search_str_size: The number of characters in the search string
+ *
+ * Returns true if the name matches the search string, and false otherwise
  * -------------------------------------------------------------------------------------
  */
-static cJSON* convertAthleteToJSON(char* buffer, int buffer_size, int start)
+static bool isNameMatch(const char* name, const char* search_str, int search_str_size)
 {
-    // Validate the buffer and make sure the first 8 bytes after the offset can be read
-    if ((buffer == 0) || (start >= buffer_size) || (start + 8 >= buffer_size)) {
-        return NULL;
-    }
-
-    unsigned int fiscode;
-    unsigned int compid;
-    char firstname[256];
-    char lastname[256];
-    char nation[256];
-    char birthdate[32];
-    char gender[8];
-    char club[256];
-    int currentByte = start;
-
-    // Read the fiscode
-    unsigned char bytes[4];
-    bytes[0] = buffer[currentByte++]; 
-    bytes[1] = buffer[currentByte++]; 
-    bytes[2] = buffer[currentByte++];
-    bytes[3] = buffer[currentByte++];
-    fiscode = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-    // Read the compid
-    bytes[0] = buffer[currentByte++]; 
-    bytes[1] = buffer[currentByte++]; 
-    bytes[2] = buffer[currentByte++];
-    bytes[3] = buffer[currentByte++];
-    compid = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-    // Read the firstname
-    int str_index = 0;
-    while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-        firstname[str_index++] = buffer[currentByte - 1]; 
-    }
-    firstname[str_index] = '\0';
-
-    // Read the lastname
-    str_index = 0;
-    while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-        lastname[str_index++] = buffer[currentByte - 1]; 
-    }
-    lastname[str_index] = '\0';
-
-    // Read the nation
-    str_index = 0;
-    while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-        nation[str_index++] = buffer[currentByte - 1]; 
+    for (int i = 0; i < search_str_size; i++) {
+        if (name[i] == '\0' || tolower(name[i]) != search_str[i]) {
+            return false;
+        }
     }
-    nation[str_index] = '\0';
+    return true;
+}
 
-    // Read the birthdate
-    str_index = 0;
-    while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 32) {
-        birthdate[str_index++] = buffer[currentByte - 1]; 
-    }
-    birthdate[str_index] = '\0';
 
-    // Read the gender
-    str_index = 0;
-    while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 8) {
-        gender[str_index++] = buffer[currentByte - 1]; 
-    }
-    gender[str_index] = '\0';
 
-    // Read the club
-    str_index = 0;
-    while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-        club[str_index++] = buffer[currentByte - 1]; 
-    }
-    club[str_index] = '\0';
+/**
+ * -------------------------------------------------------------------------------------
+ * Converts an athlete from the database to a cJSON object. This object needs to be freed manually later.
+ * 
+ * record: The athlete in the database
+ * 
+ * Returns a pointer to a cJSON object on success, and NULL on failure.
+ * -------------------------------------------------------------------------------------
+ */
+static cJSON* convertAthleteToJSON(const AthleteRecord* record)
+{
+    unsigned int fiscode = record->fiscode;
+    unsigned int compid = record->compid;
+    const char* firstname = record->firstname;
+    const char* lastname = record->lastname;
+    const char* nation = record->nation;
+    const char* birthdate = record->birthdate;
+    const char* gender = record->gender;
+    const char* club = record->club;
 
     // Create a JSON object for the athlete
     cJSON* athlete = cJSON_CreateObject();
@@ -539,6 +375,7 @@ static cJSON* convertAthleteToJSON(char* buffer, int buffer_size, int start)
         if (fiscode_json == NULL || compid_json == NULL || firstname_json == NULL || lastname_json == NULL || 
             nation_json == NULL || birthdate_json == NULL || gender_json == NULL || club_json == NULL) {
             cJSON_Delete(athlete);
+            athlete = NULL;
         }
         else {
             cJSON_AddItemToObject(athlete, "fiscode", fiscode_json);
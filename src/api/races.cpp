@@ -4,8 +4,10 @@
 
 #include "../server/Server.h"
 //#include "../Response.h"
+#include "../db/Database.h"
 #include "../libs/cJSON.h"
 #include "../util/StringUtil.h"
+#include "../util/Log.h"
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -37,24 +39,22 @@ int api_getAthletesRaceids(int socket, char* fiscode)
     // -----------------------------------------------------------------
     int fiscode_int = validate_and_convert_parameter(fiscode);
     if (fiscode_int <= -1) {
-        fprintf(stderr, "[%ld] HTTP 400: Api call failed, invalid parameter\n", (long)getpid());
-        SendHttpResponse(socket, 400, CONNECTION_CLOSE, TYPE_HTML, "400 Bad Request: Invalid parameter");
+        fprintf(stderr, "[%ld] HTTP 400: Api call failed, invalid parameter\n", GetLogId());
+        SendHttpResponse(socket, 400, CONNECTION_ALIVE, TYPE_HTML, "400 Bad Request: Invalid parameter");
         return -1;
     }
     
 
     // -----------------------------------------------------------------
-    // Load the file that stores all races for each athlete
+    // Try to find the athlete with the requsted fiscode
     // -----------------------------------------------------------------
-    char file[] = DB_ATHLETES_RACES;
-    char* buffer = 0;
-    int buffer_size = 0;
-    int status_code = 500;  // Default status code on failure
-    if (load_resource(file, &buffer, &buffer_size, &status_code) == -1) {
-        SendHttpResponse(socket, status_code, CONNECTION_CLOSE, TYPE_HTML, "Failed to load requested resource");
-        if (buffer != 0) free(buffer);
+    RaceIdsRecord race_ids;
+    int res = Database_FindRaceIds(fiscode_int, &race_ids);
+    if (res == -1) {
+        SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "Failed to load requested resource");
         return -1;
     }
+    bool foundAthlete = (res == 0);
 
 
     // -----------------------------------------------------------------
@@ -64,8 +64,8 @@ int api_getAthletesRaceids(int socket, char* fiscode)
     cJSON* json_array = cJSON_CreateArray();
     if (json_races == NULL || json_array == NULL) 
     {
-        fprintf(stderr, "[%ld] HTTP 500: Failed to create JSON object\n", (long)getpid());
-        SendHttpResponse(socket, 500, CONNECTION_CLOSE, TYPE_HTML, "500 Internal Server Error: Failed to create JSON object");
+        fprintf(stderr, "[%ld] HTTP 500: Failed to create JSON object\n", GetLogId());
+        SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "500 Internal Server Error: Failed to create JSON object");
         if (json_races != 0) cJSON_Delete(json_races);
         if (json_array != 0) cJSON_Delete(json_array);
         return -1;
@@ -74,54 +74,14 @@ int api_getAthletesRaceids(int socket, char* fiscode)
 
 
     // -----------------------------------------------------------------
-    // Try to find the athlete with the requsted fiscode
+    // Add all the raceids for the athlete to the JSON object that will be sent back to the client
     // -----------------------------------------------------------------
-    bool foundAthlete = false;
-    int currentByte = 0;
-    while (currentByte < buffer_size)
-    {
-        // Make sure the next 8 bytes can be read from the buffer
-        if (currentByte + 8 >= buffer_size) break;
-
-        // Read the current fiscode and how many races are stored for that athlete
-        unsigned char bytes[4];
-        bytes[0] = buffer[currentByte++]; 
-        bytes[1] = buffer[currentByte++]; 
-        bytes[2] = buffer[currentByte++];
-        bytes[3] = buffer[currentByte++];
-        unsigned int currentFiscode = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-        bytes[0] = buffer[currentByte++]; 
-        bytes[1] = buffer[currentByte++]; 
-        bytes[2] = buffer[currentByte++];
-        bytes[3] = buffer[currentByte++];
-        unsigned int numberOfRaces = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-        // If the current fiscode is not the requested one, then skip past the list of raceids for this athlete
-        if (currentFiscode != fiscode_int) {
-            currentByte += (numberOfRaces * 4);
-        }
-        else {
-            // Loop through and read all the raceids
-            for (int i = 0; i < numberOfRaces; i++)
-            {
-                // Make sure the next 4 bytes can be read from the buffer
-                if (currentByte + 4 >= buffer_size) break;
-
-                // Read the current raceid and add it to the JSON object that will be sent back to the client
-                bytes[0] = buffer[currentByte++]; 
-                bytes[1] = buffer[currentByte++]; 
-                bytes[2] = buffer[currentByte++];
-                bytes[3] = buffer[currentByte++];
-                unsigned int currentRaceid = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-                cJSON* json_raceid = cJSON_CreateNumber(currentRaceid);
-                if (json_raceid != NULL) {
-                    cJSON_AddItemReferenceToArray(json_array, json_raceid);
-                }
+    if (foundAthlete) {
+        for (int i = 0; i < race_ids.raceids_size; i++) {
+            cJSON* json_raceid = cJSON_CreateNumber(Database_GetRaceId(&race_ids, i));
+            if (json_raceid != NULL) {
+                cJSON_AddItemToArray(json_array, json_raceid);
             }
-            foundAthlete = true;
-            break;
         }
     }
 
@@ -129,16 +89,14 @@ int api_getAthletesRaceids(int socket, char* fiscode)
     // Convert the JSON object to a string and free up allocated memory
     char* races_str = cJSON_Print(json_races);
     cJSON_Delete(json_races);
-    if (buffer != 0) 
-        free(buffer);
 
 
     // ------------------------------------------------------------
     // Check if the requested athlete was found
     // ------------------------------------------------------------
     if (!foundAthlete) {
-        fprintf(stderr, "[%ld] HTTP 404: Could not find the requested athlete\n", (long)getpid());
-        SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "404 Not Found: Could not find the requested athlete");
+        fprintf(stderr, "[%ld] HTTP 404: Could not find the requested athlete\n", GetLogId());
+        SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "404 Not Found: Could not find the requested athlete");
         if (races_str != 0) free(races_str);
         return -1;
     }
@@ -152,12 +110,12 @@ int api_getAthletesRaceids(int socket, char* fiscode)
     //strcat(response, "\n");  // strcar also adds '\0' at the end
     if (races_str != 0) free(races_str);
 
-    if (SendHttpResponse(socket, 200, CONNECTION_CLOSE, TYPE_JSON, response) == -1) {
+    if (SendHttpResponse(socket, 200, CONNECTION_ALIVE, TYPE_JSON, response) == -1) {
         if (response != 0) free(response);
         return -1;
     }
 
-    fprintf(stderr, "[%ld] HTTP 200: Found and sent back the results successfully!\n", (long)getpid());
+    fprintf(stderr, "[%ld] HTTP 200: Found and sent back the results successfully!\n", GetLogId());
     if (response != 0) free(response);
     
     return 0;
@@ -188,169 +146,63 @@ int api_getRaceInfo(int socket, char* raceid)
     // -----------------------------------------------------------------
     int raceid_int = validate_and_convert_parameter(raceid);
     if (raceid_int <= -1) {
-        fprintf(stderr, "[%ld] HTTP 400: Api call failed, invalid parameter\n", (long)getpid());
-        SendHttpResponse(socket, 400, CONNECTION_CLOSE, TYPE_HTML, "400 Bad Request: Invalid parameter");
+        fprintf(stderr, "[%ld] HTTP 400: Api call failed, invalid parameter\n", GetLogId());
+        SendHttpResponse(socket, 400, CONNECTION_ALIVE, TYPE_HTML, "400 Bad Request: Invalid parameter");
         return -1;
     }
 
 
     // -----------------------------------------------------------------
-    // Load the file that stores the info for all races
+    // Try to find the requested race
     // -----------------------------------------------------------------
-    char file[] = DB_RACE_INFO;
-    char* buffer = 0;
-    int buffer_size = 0;
-    int status_code = 500;  // Default status code on failure
-    if (load_resource(file, &buffer, &buffer_size, &status_code) == -1) {
-        SendHttpResponse(socket, status_code, CONNECTION_CLOSE, TYPE_HTML, "Failed to load requested resource");
-        if (buffer != 0) free(buffer);
+    RaceInfoRecord race_info;
+    int res = Database_FindRaceInfo(raceid_int, &race_info);
+    if (res == -1) {
+        SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "Failed to load requested resource");
         return -1;
     }
 
-
-    // -----------------------------------------------------------------
-    // Try to find athletes that matches the search
-    // -----------------------------------------------------------------
+    // Create a JSON object that contains all the data for this race
     cJSON* json_raceinfo = NULL;
-    int currentByte = 0;
-    while (currentByte < buffer_size)
-    {
-        // Make sure the next 4 bytes can be read from the buffer
-        if (currentByte + 4 >= buffer_size) break;
-
-        // Read the current raceid
-        unsigned char bytes[4];
-        bytes[0] = buffer[currentByte++]; 
-        bytes[1] = buffer[currentByte++]; 
-        bytes[2] = buffer[currentByte++];
-        bytes[3] = buffer[currentByte++];
-        unsigned int currentRaceid = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-        if (currentRaceid != raceid_int)
-        {
-            // This is not the requested race, so skip all its fields
-            currentByte += 4;  
-            int string_counter = 0; 
-            while (string_counter < 7 && currentByte < buffer_size) {
-                if (buffer[currentByte++] == '\0') {
-                    string_counter++;  
-                }
-            }
+    if (res == 0) {
+        json_raceinfo = cJSON_CreateObject();
+    }
+    if (json_raceinfo != NULL) {
+        cJSON* raceid_json = cJSON_CreateNumber(race_info.raceid);
+        cJSON* codex_json = cJSON_CreateNumber(race_info.codex);
+        cJSON* date_json = cJSON_CreateString(race_info.date);
+        cJSON* nation_json = cJSON_CreateString(Database_GetDictionaryString(race_info.nation));
+        cJSON* location_json = cJSON_CreateString(race_info.location);
+        cJSON* category_json = cJSON_CreateString(Database_GetDictionaryString(race_info.category));
+        cJSON* discipline_json = cJSON_CreateString(Database_GetDictionaryString(race_info.discipline));
+        cJSON* type_json = cJSON_CreateString(Database_GetDictionaryString(race_info.type));
+        cJSON* gender_json = cJSON_CreateString(Database_GetDictionaryString(race_info.gender));
+        
+        if (raceid_json == NULL || codex_json == NULL || date_json == NULL || nation_json == NULL || location_json == NULL || 
+            category_json == NULL || discipline_json == NULL || type_json == NULL || gender_json == NULL) {
+            cJSON_Delete(json_raceinfo);
+            json_raceinfo = NULL;
         }
-        else
-        {
-            // The requested race was found, so read all the fields
-            unsigned int codex;
-            char date[256];
-            char nation[256];
-            char location[256];
-            char category[256];
-            char discipline[256];
-            char type[256];
-            char gender[8];
-
-            // Make sure the next 4 bytes can be read from the buffer
-            if (currentByte + 4 >= buffer_size) break;
-
-            // Read the codex
-            bytes[0] = buffer[currentByte++]; 
-            bytes[1] = buffer[currentByte++]; 
-            bytes[2] = buffer[currentByte++];
-            bytes[3] = buffer[currentByte++];
-            codex = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-            // Read the date
-            int str_index = 0;
-            while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-                date[str_index++] = buffer[currentByte - 1]; 
-            }
-            date[str_index] = '\0';
-
-            // Read the nation
-            str_index = 0;
-            while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-                nation[str_index++] = buffer[currentByte - 1]; 
-            }
-            nation[str_index] = '\0';
-
-            // Read the location
-            str_index = 0;
-            while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-                location[str_index++] = buffer[currentByte - 1]; 
-            }
-            location[str_index] = '\0';
-
-            // Read the category
-            str_index = 0;
-            while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-                category[str_index++] = buffer[currentByte - 1]; 
-            }
-            category[str_index] = '\0';
-
-            // Read the discipline
-            str_index = 0;
-            while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-                discipline[str_index++] = buffer[currentByte - 1]; 
-            }
-            discipline[str_index] = '\0';
-
-            // Read the type
-            str_index = 0;
-            while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-                type[str_index++] = buffer[currentByte - 1]; 
-            }
-            type[str_index] = '\0';
-
-            // Read the gender
-            str_index = 0;
-            while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 8) {
-                gender[str_index++] = buffer[currentByte - 1]; 
-            }
-            gender[str_index] = '\0';
-
-            // Create a JSON object that contains all the data for this race
-            json_raceinfo = cJSON_CreateObject();
-            if (json_raceinfo != NULL) {
-                cJSON* raceid_json = cJSON_CreateNumber(currentRaceid);
-                cJSON* codex_json = cJSON_CreateNumber(codex);
-                cJSON* date_json = cJSON_CreateString(date);
-                cJSON* nation_json = cJSON_CreateString(nation);
-                cJSON* location_json = cJSON_CreateString(location);
-                cJSON* category_json = cJSON_CreateString(category);
-                cJSON* discipline_json = cJSON_CreateString(discipline);
-                cJSON* type_json = cJSON_CreateString(type);
-                cJSON* gender_json = cJSON_CreateString(gender);
-                
-                if (raceid_json == NULL || codex_json == NULL || date_json == NULL || nation_json == NULL || location_json == NULL || 
-                    category_json == NULL || discipline_json == NULL || type_json == NULL || gender_json == NULL) {
-                    cJSON_Delete(json_raceinfo);
-                }
-                else {
-                    cJSON_AddItemToObject(json_raceinfo, "raceid", raceid_json);
-                    cJSON_AddItemToObject(json_raceinfo, "codex", codex_json);
-                    cJSON_AddItemToObject(json_raceinfo, "date", date_json);
-                    cJSON_AddItemToObject(json_raceinfo, "nation", nation_json);
-                    cJSON_AddItemToObject(json_raceinfo, "location", location_json);
-                    cJSON_AddItemToObject(json_raceinfo, "category", category_json);
-                    cJSON_AddItemToObject(json_raceinfo, "discipline", discipline_json);
-                    cJSON_AddItemToObject(json_raceinfo, "type", type_json);
-                    cJSON_AddItemToObject(json_raceinfo, "gender", gender_json);
-                }
-            }
-            break;
+        else {
+            cJSON_AddItemToObject(json_raceinfo, "raceid", raceid_json);
+            cJSON_AddItemToObject(json_raceinfo, "codex", codex_json);
+            cJSON_AddItemToObject(json_raceinfo, "date", date_json);
+            cJSON_AddItemToObject(json_raceinfo, "nation", nation_json);
+            cJSON_AddItemToObject(json_raceinfo, "location", location_json);
+            cJSON_AddItemToObject(json_raceinfo, "category", category_json);
+            cJSON_AddItemToObject(json_raceinfo, "discipline", discipline_json);
+            cJSON_AddItemToObject(json_raceinfo, "type", type_json);
+            cJSON_AddItemToObject(json_raceinfo, "gender", gender_json);
         }
     }
 
-   if (buffer != 0) 
-       free(buffer);
-
 
    // ------------------------------------------------------------
    // Check if the requested race was found
    // ------------------------------------------------------------
    if (json_raceinfo == NULL) {
-       fprintf(stderr, "[%ld] HTTP 404: Could not find the requested race\n", (long)getpid());
-       SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "404 Not Found: Could not find the requested race");
+       fprintf(stderr, "[%ld] HTTP 404: Could not find the requested race\n", GetLogId());
+       SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "404 Not Found: Could not find the requested race");
        return -1;
    }
 
@@ -366,12 +218,12 @@ int api_getRaceInfo(int socket, char* raceid)
    if (raceinfo_str != 0) free(raceinfo_str);
    cJSON_Delete(json_raceinfo);
 
-   if (SendHttpResponse(socket, 200, CONNECTION_CLOSE, TYPE_JSON, response) == -1) {
+   if (SendHttpResponse(socket, 200, CONNECTION_ALIVE, TYPE_JSON, response) == -1) {
        if (response != 0) free(response);
        return -1;
    }
 
-   fprintf(stderr, "[%ld] HTTP 200: Found and sent back the requested race info!\n", (long)getpid());
+   fprintf(stderr, "[%ld] HTTP 200: Found and sent back the requested race info!\n", GetLogId());
    if (response != 0) free(response);
    
    return 0;
@@ -402,24 +254,22 @@ int api_getRaceResult(int socket, char* raceid)
     // -----------------------------------------------------------------
     int raceid_int = validate_and_convert_parameter(raceid);
     if (raceid_int <= -1) {
-        fprintf(stderr, "[%ld] HTTP 400: Api call failed, invalid parameter\n", (long)getpid());
-        SendHttpResponse(socket, 400, CONNECTION_CLOSE, TYPE_HTML, "400 Bad Request: Invalid parameter");
+        fprintf(stderr, "[%ld] HTTP 400: Api call failed, invalid parameter\n", GetLogId());
+        SendHttpResponse(socket, 400, CONNECTION_ALIVE, TYPE_HTML, "400 Bad Request: Invalid parameter");
         return -1;
     }
 
 
     // -----------------------------------------------------------------
-    // Load the file that stores all race results
+    // Try to find the requested race and its list of results
     // -----------------------------------------------------------------
-    char file[] = DB_RACE_RESULTS;
-    char* buffer = 0;
-    int buffer_size = 0;
-    int status_code = 500;  // Default status code on failure
-    if (load_resource(file, &buffer, &buffer_size, &status_code) == -1) {
-        SendHttpResponse(socket, status_code, CONNECTION_CLOSE, TYPE_HTML, "Failed to load requested resource");
-        if (buffer != 0) free(buffer);
+    RaceResultsRecord race_results;
+    int res = Database_FindRaceResults(raceid_int, &race_results);
+    if (res == -1) {
+        SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "Failed to load requested resource");
         return -1;
     }
+    bool foundRace = (res == 0);
 
 
     // -----------------------------------------------------------------
@@ -429,8 +279,8 @@ int api_getRaceResult(int socket, char* raceid)
     cJSON* json_resultsarray = cJSON_CreateArray();
     if (json_race == NULL || json_resultsarray == NULL) 
     {
-        fprintf(stderr, "[%ld] HTTP 500: Failed to create JSON object\n", (long)getpid());
-        SendHttpResponse(socket, 500, CONNECTION_CLOSE, TYPE_HTML, "500 Internal Server Error: Failed to create JSON object");
+        fprintf(stderr, "[%ld] HTTP 500: Failed to create JSON object\n", GetLogId());
+        SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "500 Internal Server Error: Failed to create JSON object");
         if (json_race != 0) cJSON_Delete(json_race);
         if (json_resultsarray != 0) cJSON_Delete(json_resultsarray);
         return -1;
@@ -439,169 +289,61 @@ int api_getRaceResult(int socket, char* raceid)
 
 
     // ------------------------------------------------------------
-    // Try to find the requested race and its list of results
+    // Add all ranks in the result list to the JSON object
     // ------------------------------------------------------------
-    bool foundRace = false;
-    int currentByte = 0;
-    while (currentByte < buffer_size)
+    int offset = 0;
+    ResultRecord result_record;
+    for (int i = 0; foundRace && i < race_results.results_size && Database_NextResult(&race_results, &offset, &result_record) == 0; i++) 
     {
-        // Make sure the next 6 bytes can be read from the buffer
-        if (currentByte + 6 >= buffer_size) break;
-
-        // Read the current raceid and the number of ranks it has
-        unsigned char bytes[4];
-        bytes[0] = buffer[currentByte++]; 
-        bytes[1] = buffer[currentByte++]; 
-        bytes[2] = buffer[currentByte++];
-        bytes[3] = buffer[currentByte++];
-        unsigned int currentRaceid = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-        bytes[0] = buffer[currentByte++];
-        bytes[1] = buffer[currentByte++];
-        unsigned int number_of_ranks = bytes[0] | (bytes[1] << 8); 
-
-        // Check if the current race is the requested one
-        if (currentRaceid != raceid_int) 
+        const ResultRecord* result = &result_record;
+
+        // Create a JSON object that contains all the data for this rank
+        cJSON* json_rank = cJSON_CreateObject();
+        if (json_rank != NULL) 
         {
-            for (int i = 0; i < number_of_ranks; i++) {
-                // This is not the requested race, so skip all its fields for each rank    
-                currentByte += 18;  
-                int string_counter = 0; 
-                while (string_counter < 3 && currentByte < buffer_size) {
-                    if (buffer[currentByte++] == '\0') {
-                        string_counter++;  
-                    }
-                }
+            // Create JSON objects for all fields 
+            cJSON* rank_json = cJSON_CreateNumber(result->rank);
+            cJSON* bib_json = cJSON_CreateNumber(result->bib);
+            cJSON* fiscode_json = cJSON_CreateNumber(result->fiscode);
+            cJSON* time_json = cJSON_CreateNumber(result->time);
+            cJSON* diff_json = cJSON_CreateNumber(result->diff);
+            cJSON* year_json = cJSON_CreateNumber(result->year);
+            cJSON* athlete_json = cJSON_CreateString(result->name);
+            cJSON* nation_json = cJSON_CreateString(result->nation);
+            cJSON* fispoints_json = cJSON_CreateString(result->fispoints);
+            
+            if (rank_json == NULL || bib_json == NULL || fiscode_json == NULL || time_json == NULL || diff_json == NULL ||
+                year_json == NULL || athlete_json == NULL || nation_json == NULL || fispoints_json == NULL) {
+                cJSON_Delete(json_rank);
             }
-        }
-        else {
-            // This is the requested race, so loop through all its ranks
-            for (int i = 0; i < number_of_ranks; i++) 
+            else 
             {
-                // Read all the fields for this rank
-                unsigned int rank;
-                unsigned int bib;
-                unsigned int fiscode;
-                unsigned int time;
-                unsigned int diff;
-                unsigned int year;
-                char athlete[256];
-                char nation[256];
-                char fispoints[16];
-
-                // Make sure the next 18 bytes can be read from the buffer
-                if (currentByte + 18 >= buffer_size) break;
-
-                // Read the rank
-                bytes[0] = buffer[currentByte++]; 
-                bytes[1] = buffer[currentByte++]; 
-                rank = bytes[0] | (bytes[1] << 8);
-
-                // Read the bib
-                bytes[0] = buffer[currentByte++]; 
-                bytes[1] = buffer[currentByte++]; 
-                bib = bytes[0] | (bytes[1] << 8);
-
-                // Read the fiscode
-                bytes[0] = buffer[currentByte++]; 
-                bytes[1] = buffer[currentByte++]; 
-                bytes[2] = buffer[currentByte++];
-                bytes[3] = buffer[currentByte++];
-                fiscode = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-                // Read the time
-                bytes[0] = buffer[currentByte++]; 
-                bytes[1] = buffer[currentByte++]; 
-                bytes[2] = buffer[currentByte++];
-                bytes[3] = buffer[currentByte++];
-                time = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-                // Read the diff
-                bytes[0] = buffer[currentByte++]; 
-                bytes[1] = buffer[currentByte++]; 
-                bytes[2] = buffer[currentByte++];
-                bytes[3] = buffer[currentByte++];
-                diff = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-                // Read the year
-                bytes[0] = buffer[currentByte++]; 
-                bytes[1] = buffer[currentByte++]; 
-                year = bytes[0] | (bytes[1] << 8);
-
-                // Read the athlete
-                int str_index = 0;
-                while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-                    athlete[str_index++] = buffer[currentByte - 1]; 
-                }
-                athlete[str_index] = '\0';
-
-                // Read the nation
-                str_index = 0;
-                while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-                    nation[str_index++] = buffer[currentByte - 1]; 
-                }
-                nation[str_index] = '\0';
-
-                // Read the fispoints
-                str_index = 0;
-                while (currentByte < buffer_size && buffer[currentByte++] != '\0' && str_index < 256) {
-                    fispoints[str_index++] = buffer[currentByte - 1]; 
-                }
-                fispoints[str_index] = '\0';
-
-                // Create a JSON object that contains all the data for this rank
-                cJSON* json_rank = cJSON_CreateObject();
-                if (json_rank != NULL) 
-                {
-                    // Create JSON objects for all fields 
-                    cJSON* rank_json = cJSON_CreateNumber(rank);
-                    cJSON* bib_json = cJSON_CreateNumber(bib);
-                    cJSON* fiscode_json = cJSON_CreateNumber(fiscode);
-                    cJSON* time_json = cJSON_CreateNumber(time);
-                    cJSON* diff_json = cJSON_CreateNumber(diff);
-                    cJSON* year_json = cJSON_CreateNumber(year);
-                    cJSON* athlete_json = cJSON_CreateString(athlete);
-                    cJSON* nation_json = cJSON_CreateString(nation);
-                    cJSON* fispoints_json = cJSON_CreateString(fispoints);
-                    
-                    if (rank_json == NULL || bib_json == NULL || fiscode_json == NULL || time_json == NULL || diff_json == NULL ||
-                        year_json == NULL || athlete_json == NULL || nation_json == NULL || fispoints_json == NULL) {
-                        cJSON_Delete(json_rank);
-                    }
-                    else 
-                    {
-                        // Add each field to the current rank, then add it to the array of all ranks
-                        cJSON_AddItemToObject(json_rank, "rank", rank_json);
-                        cJSON_AddItemToObject(json_rank, "bib", bib_json);
-                        cJSON_AddItemToObject(json_rank, "fiscode", fiscode_json);
-                        cJSON_AddItemToObject(json_rank, "time", time_json);
-                        cJSON_AddItemToObject(json_rank, "diff", diff_json);
-                        cJSON_AddItemToObject(json_rank, "year", year_json);
-                        cJSON_AddItemToObject(json_rank, "athlete", athlete_json);
-                        cJSON_AddItemToObject(json_rank, "nation", nation_json);
-                        cJSON_AddItemToObject(json_rank, "fispoints", fispoints_json);
-                        cJSON_AddItemReferenceToArray(json_resultsarray, json_rank);
-                    }
-                }
+                // Add each field to the current rank, then add it to the array of all ranks
+                cJSON_AddItemToObject(json_rank, "rank", rank_json);
+                cJSON_AddItemToObject(json_rank, "bib", bib_json);
+                cJSON_AddItemToObject(json_rank, "fiscode", fiscode_json);
+                cJSON_AddItemToObject(json_rank, "time", time_json);
+                cJSON_AddItemToObject(json_rank, "diff", diff_json);
+                cJSON_AddItemToObject(json_rank, "year", year_json);
+                cJSON_AddItemToObject(json_rank, "athlete", athlete_json);
+                cJSON_AddItemToObject(json_rank, "nation", nation_json);
+                cJSON_AddItemToObject(json_rank, "fispoints", fispoints_json);
+                cJSON_AddItemToArray(json_resultsarray, json_rank);
             }
-            foundRace = true;
-            break;
         }
     }
 
     // Convert the JSON object to a string and free up allocated memory
     char* race_str = cJSON_Print(json_race);
     cJSON_Delete(json_race);
-    if (buffer != 0) 
-        free(buffer);
 
 
     // ------------------------------------------------------------
     // Check if the requested race was found
     // ------------------------------------------------------------
     if (!foundRace) {
-        fprintf(stderr, "[%ld] HTTP 404: Could not find the requested race\n", (long)getpid());
-        SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "404 Not Found: Could not find the requested race");
+        fprintf(stderr, "[%ld] HTTP 404: Could not find the requested race\n", GetLogId());
+        SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "404 Not Found: Could not find the requested race");
         if (race_str != 0) free(race_str);
         return -1;
     }
@@ -615,12 +357,12 @@ int api_getRaceResult(int socket, char* raceid)
     //strcat(response, "\n");  // strcar also adds '\0' at the end
     if (race_str != 0) free(race_str);
 
-    if (SendHttpResponse(socket, 200, CONNECTION_CLOSE, TYPE_JSON, response) == -1) {
+    if (SendHttpResponse(socket, 200, CONNECTION_ALIVE, TYPE_JSON, response) == -1) {
         if (response != 0) free(response);
         return -1;
     }
 
-    fprintf(stderr, "[%ld] HTTP 200: Found and sent back the results for the requested race!\n", (long)getpid());
+    fprintf(stderr, "[%ld] HTTP 200: Found and sent back the results for the requested race!\n", GetLogId());
     if (response != 0) free(response);
     
     return 0;
@@ -0,0 +1,117 @@
+#include "Database.h"
+
+#include <pthread.h>
+#include <string.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#define CRC32C_POLYNOMIAL 0x82F63B78u  // The reflected Castagnoli polynomial
+
+// The tables of the software implementation, for 8 bytes at a time. Table k is the CRC of a byte followed by k zero bytes
+static unsigned int crc_tables[8][256];
+static pthread_once_t crc_tables_once = PTHREAD_ONCE_INIT;
+
+static void BuildTables();
+static unsigned int Crc32cSoftware(unsigned int crc, const unsigned char* bytes, int size);
+#if defined(__x86_64__)
+static unsigned int Crc32cSse42(unsigned int crc, const unsigned char* bytes, int size) __attribute__((target("sse4.2")));
+#endif
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Calculates the CRC32C checksum of a section of a database file (see DB_FORMAT_CHECKSUM_VERSION in Database.h)
+ * The crc32 instruction is used if the CPU has it, which checks several gigabytes per second, so all files can be
+ * checked every time they are loaded. Otherwise the checksum is calculated with tables, 8 bytes at a time
+ *
+ * data: The bytes to check
+ * size: The number of bytes
+ *
+ * Returns the checksum
+ * --------------------------------------------------------------------------------------------------
+ */
+unsigned int Database_Crc32c(const char* data, int size)
+{
+    const unsigned char* bytes = (const unsigned char*) data;
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) {
+        return ~Crc32cSse42(~0u, bytes, size);
+    }
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+    unsigned int crc = ~0u;
+    for (; size >= 8; bytes += 8, size -= 8) {
+        unsigned long long word;
+        memcpy(&word, bytes, 8);
+        crc = __crc32cd(crc, word);
+    }
+    for (; size > 0; bytes++, size--) {
+        crc = __crc32cb(crc, *bytes);
+    }
+    return ~crc;
+#endif
+    pthread_once(&crc_tables_once, BuildTables);
+    return ~Crc32cSoftware(~0u, bytes, size);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Calculates the checksum 8 bytes at a time with the crc32 instruction of SSE 4.2. The bytes are read in little-endian order
+ * --------------------------------------------------------------------------------------------------
+ */
+#if defined(__x86_64__)
+static unsigned int Crc32cSse42(unsigned int crc, const unsigned char* bytes, int size)
+{
+    unsigned long long crc64 = crc;
+    for (; size >= 8; bytes += 8, size -= 8) {
+        unsigned long long word;
+        memcpy(&word, bytes, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (unsigned int) crc64;
+    for (; size > 0; bytes++, size--) {
+        crc = _mm_crc32_u8(crc, *bytes);
+    }
+    return crc;
+}
+#endif
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Calculates the checksum with the tables, one 8-byte word at a time (slicing-by-8)
+ * --------------------------------------------------------------------------------------------------
+ */
+static unsigned int Crc32cSoftware(unsigned int crc, const unsigned char* bytes, int size)
+{
+    for (; size >= 8; bytes += 8, size -= 8)
+    {
+        unsigned int low = crc ^ (bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int) bytes[3] << 24));
+        crc = crc_tables[7][low & 0xFF] ^ crc_tables[6][(low >> 8) & 0xFF] ^ crc_tables[5][(low >> 16) & 0xFF] ^ crc_tables[4][low >> 24] ^
+              crc_tables[3][bytes[4]] ^ crc_tables[2][bytes[5]] ^ crc_tables[1][bytes[6]] ^ crc_tables[0][bytes[7]];
+    }
+    for (; size > 0; bytes++, size--) {
+        crc = crc_tables[0][(crc ^ *bytes) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void BuildTables()
+{
+    for (unsigned int i = 0; i < 256; i++)
+    {
+        unsigned int crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+        }
+        crc_tables[0][i] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++) {
+            crc_tables[k][i] = crc_tables[0][crc_tables[k - 1][i] & 0xFF] ^ (crc_tables[k - 1][i] >> 8);
+        }
+    }
+}
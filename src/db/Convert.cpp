@@ -0,0 +1,232 @@
+#include "Database.h"
+
+#include "../util/Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int ConvertFile(const char* path, int type);
+static int ConvertAthletes(DatabaseBuffer* sections);
+static int ConvertRaceIds(DatabaseBuffer* sections);
+static int ConvertRaceInfo(DatabaseBuffer* sections);
+static int ConvertRaceResults(ResultsWriter* writer);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Converts all database files from the old format or an older version of the v2 format, to the current version
+ * of the format (see DB_FORMAT_MAGIC in Database.h). The files have to be preloaded with "Database_Preload" first.
+ * Every converted file replaces the old file, and files that are already in the current version are left as they are.
+ * The index files next to the database files are rebuilt the next time the database is loaded
+ * If the delta was loaded, it is compacted: the records of the delta are folded into every file, and the delta is removed
+ * once all files have been written. The exclusive lock of the delta has to be held from before the database was loaded
+ *
+ * Returns 0 if all files were converted, and -1 if any file failed. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_ConvertFormat()
+{
+    const char* paths[] = { DB_ATHLETES, DB_ATHLETE_RACES, DB_RACE_INFO, DB_RACE_RESULTS };
+    int types[] = { DB_TYPE_ATHLETES, DB_TYPE_ATHLETE_RACES, DB_TYPE_RACE_INFO, DB_TYPE_RACE_RESULTS };
+
+    int result = 0;
+    for (int i = 0; i < 4; i++) {
+        if (ConvertFile(paths[i], types[i]) == -1) {
+            fprintf(stderr, "[%ld] Failed to convert %s to version %d of the format\n", GetLogId(), paths[i], DB_FORMAT_VERSION);
+            result = -1;
+        }
+    }
+
+    // The delta is kept if any file failed, so no appended race is lost
+    if (result == 0 && Database_HasDelta())
+    {
+        if (Database_RemoveDelta() == -1) {
+            return -1;
+        }
+        fprintf(stderr, "[%ld] Folded the delta in %s into the database\n", GetLogId(), DB_DELTA_DIR);
+    }
+    return result;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Converts one database file. The records are read through the loaded database, so the old format is only decoded in one place
+ * Returns 0 on success, and -1 on failure
+ * --------------------------------------------------------------------------------------------------
+ */
+static int ConvertFile(const char* path, int type)
+{
+    char* buffer = 0;
+    int size = 0;
+    DatabaseLayout layout;
+    if (Database_GetPreloadedFile(path, &buffer, &size) != 0 || Database_ReadLayout(path, buffer, size, type, &layout) == -1) {
+        return -1;
+    }
+    if (layout.version == DB_FORMAT_VERSION && !Database_HasDelta()) {
+        fprintf(stderr, "[%ld] %s is already in version %d of the format\n", GetLogId(), path, DB_FORMAT_VERSION);
+        return 0;
+    }
+
+    DatabaseBuffer sections[DB_MAX_SECTIONS];
+    memset(sections, 0, sizeof(sections));
+
+    int res = -1;
+    if (type == DB_TYPE_ATHLETES) {
+        int row_sizes[] = { DB_ROW_ATHLETE, 1 };
+        res = (ConvertAthletes(sections) == 0) ? Database_WriteFile(path, type, sections, row_sizes, 2) : -1;
+    }
+    else if (type == DB_TYPE_ATHLETE_RACES) {
+        int row_sizes[] = { DB_ROW_LIST, DB_ROW_RACEID, DB_ROW_ATHLETE_RESULT, 1 };
+        res = (ConvertRaceIds(sections) == 0) ? Database_WriteFile(path, type, sections, row_sizes, 4) : -1;
+    }
+    else if (type == DB_TYPE_RACE_INFO) {
+        int row_sizes[] = { DB_ROW_RACE_INFO, DB_ROW_DICTIONARY, 1 };
+        res = (ConvertRaceInfo(sections) == 0) ? Database_WriteFile(path, type, sections, row_sizes, 3) : -1;
+    }
+    else if (type == DB_TYPE_RACE_RESULTS) {
+        ResultsWriter writer;
+        memset(&writer, 0, sizeof(writer));
+        res = (ConvertRaceResults(&writer) == 0) ? Database_WriteRaceResults(path, &writer) : -1;
+        Database_FreeResultsWriter(&writer);
+    }
+
+    for (int i = 0; i < DB_MAX_SECTIONS; i++) {
+        free(sections[i].data);
+    }
+    return res;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Builds the sections of each file type, in the same order as the records are stored in the old file
+ * Returns 0 on success, and -1 on failure
+ * --------------------------------------------------------------------------------------------------
+ */
+static int ConvertAthletes(DatabaseBuffer* sections)
+{
+    DatabaseBuffer* athletes = &(sections[0]);
+    DatabaseBuffer* strings = &(sections[1]);
+
+    int offset = 0;
+    AthleteRecord athlete;
+    int res;
+    while ((res = Database_NextAthlete(&offset, &athlete)) == 0)
+    {
+        const char* columns[] = { athlete.firstname, athlete.lastname, athlete.nation, athlete.birthdate, athlete.gender, athlete.club };
+        if (Database_AppendU32(athletes, athlete.fiscode) == -1 || Database_AppendU32(athletes, athlete.compid) == -1) {
+            return -1;
+        }
+        for (int i = 0; i < 6; i++) {
+            unsigned int string_offset = 0;
+            if (Database_AppendString(strings, columns[i], &string_offset) == -1 || Database_AppendU32(athletes, string_offset) == -1) {
+                return -1;
+            }
+        }
+    }
+    return (res == -1) ? -1 : 0;
+}
+
+static int ConvertRaceIds(DatabaseBuffer* sections)
+{
+    DatabaseBuffer* athletes = &(sections[0]);
+    DatabaseBuffer* raceids = &(sections[1]);
+    DatabaseBuffer* results = &(sections[2]);
+    DatabaseBuffer* strings = &(sections[3]);
+
+    // The results are copied from the race lists, or found in the result lists of the races if the file has no results
+    int offset = 0;
+    RaceIdsRecord race_ids;
+    int res;
+    while ((res = Database_NextRaceIds(&offset, &race_ids)) == 0)
+    {
+        if (Database_AppendU32(athletes, race_ids.fiscode) == -1 || Database_AppendU32(athletes, raceids->size / DB_ROW_RACEID) == -1 ||
+            Database_AppendU32(athletes, race_ids.raceids_size) == -1) {
+            return -1;
+        }
+        for (int i = 0; i < race_ids.raceids_size; i++)
+        {
+            AthleteResultRecord result;
+            if (Database_GetAthleteResult(&race_ids, i, &result) != 0) {
+                memset(&result, 0, sizeof(result));
+                result.raceid = Database_GetRaceId(&race_ids, i);
+                result.name = "";
+                result.fispoints = "";
+            }
+            if (Database_AppendU32(raceids, result.raceid) == -1 || Database_AppendAthleteResult(results, strings, &result) == -1) {
+                return -1;
+            }
+        }
+    }
+    return (res == -1) ? -1 : 0;
+}
+
+static int ConvertRaceInfo(DatabaseBuffer* sections)
+{
+    DatabaseBuffer* races = &(sections[0]);
+    DatabaseBuffer* dictionary = &(sections[1]);
+    DatabaseBuffer* strings = &(sections[2]);
+
+    // The dictionary is written as it is, so the codes of the races stay the same
+    for (int code = 0; code < Database_GetDictionarySize(); code++) {
+        unsigned int string_offset = 0;
+        if (Database_AppendString(strings, Database_GetDictionaryString((DictionaryCode) code), &string_offset) == -1 ||
+            Database_AppendU32(dictionary, string_offset) == -1) {
+            return -1;
+        }
+    }
+
+    int offset = 0;
+    RaceInfoRecord race_info;
+    int res;
+    while ((res = Database_NextRaceInfo(&offset, &race_info)) == 0)
+    {
+        unsigned int columns[] = { race_info.raceid, race_info.codex, 0, race_info.nation, 0, race_info.category,
+                                   race_info.discipline, race_info.type, race_info.gender };
+        if (Database_AppendString(strings, race_info.date, &(columns[2])) == -1 || Database_AppendString(strings, race_info.location, &(columns[4])) == -1) {
+            return -1;
+        }
+        for (int c = 0; c < 9; c++) {
+            if (Database_AppendU32(races, columns[c]) == -1) {
+                return -1;
+            }
+        }
+    }
+    return (res == -1) ? -1 : 0;
+}
+
+static int ConvertRaceResults(ResultsWriter* writer)
+{
+    ResultRecord* results = 0;
+    int results_capacity = 0;
+
+    int offset = 0;
+    RaceResultsRecord race_results;
+    int res;
+    while ((res = Database_NextRaceResults(&offset, &race_results)) == 0)
+    {
+        if (race_results.results_size > results_capacity)
+        {
+            ResultRecord* new_results = (ResultRecord*) realloc(results, race_results.results_size * sizeof(ResultRecord));
+            if (new_results == 0) {
+                free(results);
+                return -1;
+            }
+            results = new_results;
+            results_capacity = race_results.results_size;
+        }
+
+        int result_offset = 0;
+        int count = 0;
+        while (count < race_results.results_size && Database_NextResult(&race_results, &result_offset, &(results[count])) == 0) {
+            count++;
+        }
+        if (Database_AppendRaceResults(writer, race_results.raceid, results, count) == -1) {
+            free(results);
+            return -1;
+        }
+    }
+    free(results);
+    return (res == -1) ? -1 : 0;
+}
@@ -1,11 +1,106 @@
 
 #pragma once
 
+#define DB_DIR           "./db"
 #define DB_ATHLETES      "./db/athletes.bin"
 #define DB_ATHLETE_RACES "./db/athletes-races.bin"
 #define DB_RACE_INFO     "./db/races-info.bin"
 #define DB_RACE_RESULTS  "./db/races-results.bin"
 
+// The delta segment, where new races are appended without rewriting the database files above (see "dbcompile -a").
+// The files have the same formats as the database files, and every record in them replaces the record with the same
+// fiscode or raceid in the database. The race list of an athlete in the delta is the whole list, including the races
+// in the database. The dictionary of the race info in the delta starts with every code of the database, so the codes are shared.
+// The delta is folded into the database files by the converter (see "Database_ConvertFormat"), which then removes it.
+// Writers hold the lock file exclusively while they read and replace the delta (see "Database_LockDelta")
+#define DB_DELTA_DIR           "./db/delta"
+#define DB_DELTA_ATHLETES      "./db/delta/athletes.bin"
+#define DB_DELTA_ATHLETE_RACES "./db/delta/athletes-races.bin"
+#define DB_DELTA_RACE_INFO     "./db/delta/races-info.bin"
+#define DB_DELTA_RACE_RESULTS  "./db/delta/races-results.bin"
+#define DB_DELTA_LOCK          "./db/delta.lock"
+
+#define DB_LOCK_SHARED    1  // Readers, that load the database and the delta
+#define DB_LOCK_EXCLUSIVE 2  // Writers, that replace the delta or fold it into the database
+
+// The offset to start at to only read the records of the delta with "Database_NextAthlete" and the other "Next" functions
+#define DB_DELTA_OFFSET -1
+
+#define DB_ADVICE_SEQUENTIAL 1  // The mapped file is about to be scanned from start to end
+#define DB_ADVICE_WILLNEED   2  // The mapped file is about to be looked up in at random
+
+// The v2 format of the database files. The files start with a header, followed by a table of the sections in the file:
+//   Header (16 bytes): magic "XCDB", version (4 bytes), file type (4 bytes), and the number of sections (4 bytes)
+//   Section table: offset (4 bytes), size (4 bytes), number of rows (4 bytes), row size (4 bytes) and checksum (4 bytes) of every section
+// Every section is either a table of fixed-width rows of 4-byte little-endian columns, or a heap of null-terminated strings
+// that the string columns point into. Files without the header are read in the old format, where every record has a variable size.
+// Version 3 stores the low-cardinality columns of the race info as codes into a dictionary, instead of as strings (see "DictionaryCode").
+// Version 4 also stores the result of the athlete in every race of the race lists, so the races of an athlete can be shown
+// without searching the result list of every race. Version 5 packs the ranks of the race results into a few bits per column
+// (see "DB_PACKED_COLUMNS"). Version 6 adds a CRC32C checksum of every section to the section table, which is checked when
+// the file is loaded, so a file that is truncated or corrupt is never used. Files in versions 2 to 5 are still read, and are upgraded by the converter
+#define DB_FORMAT_MAGIC       "XCDB"
+#define DB_FORMAT_VERSION     6
+#define DB_FORMAT_MIN_VERSION 2
+#define DB_FORMAT_DICTIONARY_VERSION 3  // The first version with the dictionary
+#define DB_FORMAT_RESULTS_VERSION    4  // The first version with the results in the race lists of the athletes
+#define DB_FORMAT_PACKED_VERSION     5  // The first version with the packed ranks
+#define DB_FORMAT_CHECKSUM_VERSION   6  // The first version with the checksums in the section table
+#define DB_FORMAT_HEADER_SIZE 16
+#define DB_SECTION_ENTRY_SIZE 20     // Offset, size, number of rows, row size and checksum
+#define DB_SECTION_ENTRY_SIZE_V2 16  // The section table before the checksum version has no checksums
+#define DB_MAX_SECTIONS       4
+
+// The file types of the v2 format, and their sections:
+//   Athletes:      athletes (fiscode, compid, firstname, lastname, nation, birthdate, gender, club), strings
+//   Athlete races: athletes (fiscode, first race, number of races), raceids (raceid),
+//                  results (rank, time, diff, participants, name, fispoints), strings
+//                  Row i of the results is the result of the athlete in the race of row i of the raceids, copied from the result
+//                  list of the race. A result with no participants means that the athlete is not in the results of the race.
+//                  Version 2 and 3 only have the athletes and the raceids
+//   Race info:     races (raceid, codex, date, nation, location, category, discipline, type, gender), dictionary (string), strings
+//                  Nation, category, discipline, type and gender are codes into the dictionary. Version 2 has no dictionary,
+//                  and stores them as strings
+//   Race results:  races (raceid, first rank, number of ranks), ranks (rank, bib, fiscode, time, diff, year, name, nation, fispoints), strings
+//                  Since version 5: races (raceid, offset of the packed ranks, number of ranks), packed ranks (bytes),
+//                  entrants (fiscode, year, name, nation), strings. See "DB_PACKED_COLUMNS" for how the ranks are packed
+#define DB_TYPE_ATHLETES      1
+#define DB_TYPE_ATHLETE_RACES 2
+#define DB_TYPE_RACE_INFO     3
+#define DB_TYPE_RACE_RESULTS  4
+
+// The row sizes of the tables in the v2 format
+#define DB_ROW_ATHLETE    32
+#define DB_ROW_LIST       12  // A fiscode or raceid, the first row of its list in the next table, and the number of rows in the list
+#define DB_ROW_RACEID     4
+#define DB_ROW_RACE_INFO  36
+#define DB_ROW_RANK       36
+#define DB_ROW_DICTIONARY 4  // The string of a code, where the code is the number of the row
+#define DB_ROW_ATHLETE_RESULT 24
+#define DB_ROW_ENTRANT    16  // An athlete as it is written in the result lists. Every distinct entrant is stored once
+
+// The packed ranks of a race start with a header: the time of the first rank (varint), and for every column the smallest
+// value in the race (varint) and the number of bits of a value (1 byte). Then every rank is stored in row_bits bits,
+// where every column is stored as the difference to the smallest value. The columns are:
+//   0: the rank, as 0 if the athlete has no rank, or else as 1 + the zigzag encoded difference to the position in the list,
+//      so the ranks of a race without ties take no bits at all
+//   1: the bib
+//   2: the entrant, as the row in the entrants table
+//   3: the diff
+//   4: the time, as the zigzag encoded difference to the time of the first rank plus the diff, so it takes no bits
+//      when the times are consistent with the diffs
+//   5: the fispoints, as the offset of the string in the string heap
+// The packed ranks section ends with 8 zero bytes, so that a column can always be read with one 64-bit load
+#define DB_PACKED_COLUMNS     6
+#define DB_PACKED_MAX_BITS    57
+#define DB_PACKED_PADDING     8
+
+
+// The code of a string in a low-cardinality column of the race info (nation, category, discipline, type and gender)
+// Every distinct string is stored once in the dictionary, and code 0 is always the empty string.
+// Use "Database_GetDictionaryString" to get the string of a code. Codes can be compared instead of the strings
+typedef unsigned short DictionaryCode;
+
 
 typedef struct {
     unsigned int fiscode;
@@ -21,14 +116,155 @@ typedef struct {
 typedef struct {
     unsigned int codex;
     char date[256];
-    char nation[256];
+    DictionaryCode nation;
     char location[256];
-    char category[256];
-    char discipline[256];
-    char type[256];
-    char gender[8];
+    DictionaryCode category;
+    DictionaryCode discipline;
+    DictionaryCode type;
+    DictionaryCode gender;
 } RaceInfo;
 
+// One rank in a result list, kept small so that a whole result list stays in a few cache lines.
+// The strings point directly into the shared mapped database files, so they must never be modified or freed
+typedef struct {
+    unsigned int fiscode;
+    unsigned int time;
+    unsigned int diff;
+    unsigned short rank;
+    unsigned short bib;
+    unsigned short year;
+    const char* name;
+    const char* nation;
+    const char* fispoints;
+} ResultElement;
+
+
+// A sorted index from the key of every record in a database file (fiscode or raceid) to where the record starts in the file,
+// and how many races or ranks the record has. Stored in an index file next to the database file (see "Database_LoadKeyIndex")
+// The keys are also added to a Bloom filter, so that keys that are not in the file are rejected without searching the entries
+typedef struct {
+    int size;                       // The number of entries
+    const unsigned char* entries;   // Key, offset and count (4 bytes each) for every entry, little-endian and sorted by key
+    bool mapped;                    // The entries are mapped from the index file, instead of being built in memory
+    unsigned int* filter;           // Blocks of 8 words, where every key sets one bit in every word of one block. 0 if it could not be built
+    unsigned int filter_blocks;
+} KeyIndex;
+
+// Reads the key and count of the record at "offset" in the file, and moves "offset" to the next record
+// Returns 0 on success, and -1 at the end of the file
+typedef int (*RecordScanner)(const void* file, int* offset, unsigned int* key, unsigned int* count);
+
+// Called by the reloader thread after it has swapped in a new snapshot (see "Database_SetReloadListener")
+typedef void (*ReloadListener)();
+
+typedef struct {
+    const char* data;  // Where the section starts in the mapped file
+    int size;          // The size of the section in bytes
+    int rows;          // The number of rows, or the size of a string heap
+    int row_size;      // The size of a row, or 1 for a string heap
+} DatabaseSection;
+
+// The sections of a database file in the v2 format or later. Files in the old format have version 1, and no sections
+typedef struct {
+    int version;
+    int sections_size;
+    DatabaseSection sections[DB_MAX_SECTIONS];
+} DatabaseLayout;
+
+// A database file or a file of the delta, that is mapped into memory and indexed by the key of its records
+typedef struct {
+    const char* path;
+    int type;            // The file type in the v2 format
+    bool delta;          // A file of the delta, that may not exist
+    bool loaded;         // Mapped and indexed, so that records can be read from it
+    char* buffer;        // The mapped file, or 0 if the file could not be mapped
+    int size;
+    DatabaseLayout layout;
+    KeyIndex keys;
+    unsigned long inode;  // Which file was mapped, so that a file that has been replaced since is noticed. 0 if the file did not exist
+    long modified;        // The modification time of the file in nanoseconds
+} DatabaseFile;
+
+// The strings of the dictionary of the race info, where the code of a string is its position in the array (see "DictionaryCode").
+// The strings point into the mapped database files, and are found by their code in a hash table
+typedef struct {
+    const char** strings;
+    int strings_size;
+    int strings_capacity;
+    int* slots;  // The hash table. Every slot is either -1, or the code of a string
+    int slots_size;
+} DatabaseDictionary;
+
+// The database files and the delta as they were when they were loaded, with their indexes and dictionary.
+// Every request reads from the snapshot that was current when it started, so a new snapshot can be loaded in the background
+// and swapped in while requests are running (see "Database_Reload"). A snapshot is freed once it has been replaced,
+// and the last request that reads from it has finished
+#define DB_FILE_COUNT 8
+#define DB_FILE_ATHLETES      0
+#define DB_FILE_ATHLETE_RACES 1
+#define DB_FILE_RACE_INFO     2
+#define DB_FILE_RACE_RESULTS  3
+#define DB_FILE_DELTA         4  // Added to the files above to get the same file of the delta
+
+typedef struct {
+    DatabaseFile files[DB_FILE_COUNT];
+    DatabaseDictionary dictionary;
+    int references;  // The requests that read from the snapshot, and one more while it is the current snapshot
+} DatabaseSnapshot;
+
+// A growing buffer that the sections of a database file are built in, before they are written with "Database_WriteFile"
+typedef struct {
+    char* data;
+    int size;
+    int capacity;
+} DatabaseBuffer;
+
+// The records below are decoded on demand from the preloaded database files (see "Database_Preload")
+// The strings point directly into the shared mapped files, so they must never be modified or freed.
+// In the server they are only valid until the request that read them releases its snapshot (see "Database_AcquireSnapshot")
+typedef struct {
+    unsigned int fiscode;
+    unsigned int compid;
+    const char* firstname;
+    const char* lastname;
+    const char* nation;
+    const char* birthdate;
+    const char* gender;
+    const char* club;
+} AthleteRecord;
+
+typedef struct {
+    unsigned int fiscode;
+    int raceids_size;
+    const char* raceids;  // 4 bytes per race id, use "Database_GetRaceId" to read them
+    const char* results;  // The result of the athlete in every race, or 0 if the file has no results. Use "Database_GetAthleteResult"
+    const char* strings;  // The string heap that the results point into
+    int strings_size;
+} RaceIdsRecord;
+
+// The result of an athlete in one race of the race list of the athlete
+typedef struct {
+    unsigned int raceid;
+    unsigned int rank;
+    unsigned int time;
+    unsigned int diff;
+    unsigned int participants;  // The number of ranks in the result list of the race
+    const char* name;
+    const char* fispoints;
+} AthleteResultRecord;
+
+typedef struct {
+    unsigned int raceid;
+    unsigned int codex;
+    const char* date;
+    DictionaryCode nation;
+    const char* location;
+    DictionaryCode category;
+    DictionaryCode discipline;
+    DictionaryCode type;
+    DictionaryCode gender;
+} RaceInfoRecord;
+
 typedef struct {
     unsigned int rank;
     unsigned int bib;
@@ -36,10 +272,47 @@ typedef struct {
     unsigned int time;
     unsigned int diff;
     unsigned int year;
-    char name[256];
-    char nation[256];
-    char fispoints[16];
-} ResultElement;
+    const char* name;
+    const char* nation;
+    const char* fispoints;
+} ResultRecord;
+
+// A column of the packed ranks of a race (see "DB_PACKED_COLUMNS")
+typedef struct {
+    unsigned long long min;  // The smallest value in the race
+    int bits;                // The number of bits of a value
+    int shift;               // Where the column starts in a row, in bits
+} PackedColumn;
+
+typedef struct {
+    unsigned int raceid;
+    int results_size;     // The number of ranks
+    const char* results;  // The first rank in the mapped file, use "Database_NextResult" to read the ranks in order
+    int results_bytes;    // The number of bytes from the first rank to the end of the file, or to the end of the ranks of the race
+    const char* strings;  // The string heap that the ranks point into, or 0 if the file is in the old format
+    int strings_size;
+    bool packed;          // The ranks are packed (since version 5). The fields below are only set for packed ranks
+    const char* entrants;
+    int entrants_size;    // The number of entrants in the file
+    unsigned int first_time;
+    int row_bits;
+    PackedColumn columns[DB_PACKED_COLUMNS];
+} RaceResultsRecord;
+
+// The sections of a race results file while it is written with "Database_AppendRaceResults"
+// Every string and every entrant is only written once, and is found again in a hash set of the offsets where they were written
+typedef struct {
+    unsigned int* offsets;  // The offset in the section plus 1, or 0 for an empty slot
+    unsigned int* hashes;
+    int capacity;
+    int size;
+} WriterSet;
+
+typedef struct {
+    DatabaseBuffer sections[4];  // races, packed ranks, entrants and strings
+    WriterSet strings;
+    WriterSet entrants;
+} ResultsWriter;
 
 
 int LoadFromDatabase_Athlete(int fiscode, Athlete* athlete);
@@ -47,12 +320,63 @@ int LoadFromDatabase_RaceIds(int fiscode, unsigned int** raceids, int* raceids_s
 int LoadFromDatabase_RaceInfo(int raceid, RaceInfo* race_info);
 int LoadFromDatabase_RaceResults(int raceid, ResultElement** results, int* results_size);
 
+int Database_Preload();
+int Database_Reload();
+int Database_GetPreloadedFile(const char* path, char** buffer, int* size);
+int Database_StartReloader(bool watch);
+void Database_SetReloadListener(ReloadListener listener);
+void Database_RequestReload();
 
+DatabaseSnapshot* Database_GetSnapshot();
+void Database_AcquireSnapshot();
+void Database_ReleaseSnapshot();
+DatabaseSnapshot* Database_NewSnapshot();
+void Database_PinSnapshot(DatabaseSnapshot* snapshot);
+void Database_SwapSnapshot(DatabaseSnapshot* snapshot);
+void Database_FreeSnapshot(DatabaseSnapshot* snapshot);
+int Database_MapFile(const char* path, int advice, char** buffer, int* size);
+void Database_AdviseFile(char* buffer, int size, int advice);
+void Database_UnmapFile(char* buffer, int size);
 
+int Database_BuildIndexes();
+int Database_NextAthlete(int* offset, AthleteRecord* athlete);
+int Database_NextRaceIds(int* offset, RaceIdsRecord* race_ids);
+int Database_NextRaceInfo(int* offset, RaceInfoRecord* race_info);
+int Database_NextRaceResults(int* offset, RaceResultsRecord* race_results);
+int Database_FindAthlete(unsigned int fiscode, AthleteRecord* athlete);
+int Database_FindRaceIds(unsigned int fiscode, RaceIdsRecord* race_ids);
+unsigned int Database_GetRaceId(const RaceIdsRecord* race_ids, int i);
+int Database_GetAthleteResult(const RaceIdsRecord* race_ids, int i, AthleteResultRecord* result);
+int Database_FindRaceInfo(unsigned int raceid, RaceInfoRecord* race_info);
+int Database_FindRaceResults(unsigned int raceid, RaceResultsRecord* race_results);
+int Database_NextResult(const RaceResultsRecord* race, int* offset, ResultRecord* result);
+int Database_FindResult(const RaceResultsRecord* race, unsigned int fiscode, ResultRecord* result);
+void Database_CopyString(char* dest, int dest_size, const char* src);
 
+int Database_LockDelta(int mode);
+void Database_UnlockDelta();
+bool Database_HasDelta();
+int Database_RemoveDelta();
 
+int Database_ReadLayout(const char* path, const char* buffer, int size, int type, DatabaseLayout* layout);
+unsigned int Database_Crc32c(const char* data, int size);
+int Database_ConvertFormat();
+int Database_WriteFile(const char* path, int type, const DatabaseBuffer* sections, const int* row_sizes, int sections_size);
+int Database_AppendU32(DatabaseBuffer* buffer, unsigned int value);
+int Database_AppendString(DatabaseBuffer* heap, const char* str, unsigned int* offset);
+int Database_AppendBytes(DatabaseBuffer* buffer, const void* data, int size);
+int Database_AppendAthleteResult(DatabaseBuffer* results, DatabaseBuffer* strings, const AthleteResultRecord* result);
+int Database_AppendRaceResults(ResultsWriter* writer, unsigned int raceid, const ResultRecord* results, int results_size);
+int Database_WriteRaceResults(const char* path, ResultsWriter* writer);
+void Database_FreeResultsWriter(ResultsWriter* writer);
 
+int Database_AddDictionaryString(const char* str, DictionaryCode* code);
+int Database_LoadDictionary(const DatabaseSection* dictionary, const DatabaseSection* heap);
+int Database_FindDictionaryCode(const char* str, DictionaryCode* code);
+const char* Database_GetDictionaryString(DictionaryCode code);
+int Database_GetDictionarySize();
+void Database_FreeDictionary(DatabaseDictionary* dictionary);
 
-
-
-
+int Database_LoadKeyIndex(const char* path, int size, RecordScanner scanner, const void* file, KeyIndex* index);
+int Database_FindKey(const KeyIndex* index, unsigned int key, int* offset, int* count);
+void Database_UnloadKeyIndex(KeyIndex* index);
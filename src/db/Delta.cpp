@@ -0,0 +1,91 @@
+#include "Database.h"
+
+#include "../libs/Restart.h"
+#include "../util/Log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+// The lock file that is held while the delta is read or replaced, or -1 if this process does not hold it
+static int lock_fd = -1;
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Locks the delta, so that it is not replaced while it is loaded, and so that only one process writes it at a time
+ * Loading the database takes a shared lock, and "dbcompile" and the converter take an exclusive lock
+ * from before they load the database until they have written the new files. Waits until the lock is free
+ *
+ * mode: DB_LOCK_SHARED or DB_LOCK_EXCLUSIVE
+ *
+ * Returns 0 on success. The lock is held until "Database_UnlockDelta" is called
+ * Returns -1 if the lock file could not be opened or locked. An error message will be printed
+ * Returns -2 if this process already holds the lock
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_LockDelta(int mode)
+{
+    if (lock_fd != -1) {
+        return -2;
+    }
+
+    // A reader that can not create the lock file still loads the database, since no writer has used the directory
+    int fd;
+    if ((fd = r_open3(DB_DELTA_LOCK, O_RDONLY | O_CREAT | O_CLOEXEC, 0644)) == -1) {
+        if (mode == DB_LOCK_EXCLUSIVE || errno != EACCES) {
+            fprintf(stderr, "[%ld] Failed to lock the delta: %s: %s\n", GetLogId(), DB_DELTA_LOCK, strerror(errno));
+        }
+        return -1;
+    }
+
+    int res;
+    while ((res = flock(fd, (mode == DB_LOCK_EXCLUSIVE) ? LOCK_EX : LOCK_SH)) == -1 && errno == EINTR);
+    if (res == -1) {
+        fprintf(stderr, "[%ld] Failed to lock the delta: %s: %s\n", GetLogId(), DB_DELTA_LOCK, strerror(errno));
+        r_close(fd);
+        return -1;
+    }
+    lock_fd = fd;
+    return 0;
+}
+
+
+void Database_UnlockDelta()
+{
+    if (lock_fd != -1) {
+        r_close(lock_fd);  // Closing the file releases the lock
+        lock_fd = -1;
+    }
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Removes the delta files and their index files, once the delta has been folded into the database files
+ * The exclusive lock has to be held, so no other writer reads the delta while it is removed
+ *
+ * Returns 0 on success, and -1 if a file could not be removed. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_RemoveDelta()
+{
+    const char* paths[] = {
+        DB_DELTA_ATHLETES, DB_DELTA_ATHLETES ".idx", DB_DELTA_ATHLETE_RACES, DB_DELTA_ATHLETE_RACES ".idx",
+        DB_DELTA_RACE_INFO, DB_DELTA_RACE_INFO ".idx", DB_DELTA_RACE_RESULTS, DB_DELTA_RACE_RESULTS ".idx"
+    };
+
+    int result = 0;
+    for (int i = 0; i < 8; i++) {
+        if (unlink(paths[i]) == -1 && errno != ENOENT) {
+            fprintf(stderr, "[%ld] Failed to remove %s: %s\n", GetLogId(), paths[i], strerror(errno));
+            result = -1;
+        }
+    }
+    if (result == 0 && rmdir(DB_DELTA_DIR) == -1 && errno != ENOENT) {
+        fprintf(stderr, "[%ld] Failed to remove %s: %s\n", GetLogId(), DB_DELTA_DIR, strerror(errno));
+        result = -1;
+    }
+    return result;
+}
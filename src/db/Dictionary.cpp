@@ -0,0 +1,223 @@
+#include "Database.h"
+
+#include "../util/Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DICTIONARY_MAX_SIZE 65536  // Every code fits in a DictionaryCode
+
+// The strings of the low-cardinality race fields are stored in the dictionary of the snapshot (see "DatabaseDictionary").
+// The dictionary is built when the snapshot is loaded, and is only read from after that
+
+static int Insert(DatabaseDictionary* dictionary, const char* str, DictionaryCode* code);
+static int FindSlot(const DatabaseDictionary* dictionary, const char* str);
+static int Rehash(DatabaseDictionary* dictionary, int new_slots_size);
+static unsigned int Hash(const char* str);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Adds a string to the dictionary while the database is loaded, unless it is already in it
+ * Code 0 is always the empty string
+ *
+ * Returns 0 on success, and sets "code" to the code of the string
+ * Returns -1 if the dictionary is full, or the memory could not be allocated. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_AddDictionaryString(const char* str, DictionaryCode* code)
+{
+    DatabaseDictionary* dictionary = &(Database_GetSnapshot()->dictionary);
+    if (dictionary->strings_size == 0 && Insert(dictionary, "", code) == -1) {
+        return -1;
+    }
+    int slot = FindSlot(dictionary, str);
+    if (dictionary->slots[slot] != -1) {
+        *code = (DictionaryCode) dictionary->slots[slot];
+        return 0;
+    }
+    return Insert(dictionary, str, code);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Loads the dictionary of a database file, where every row is the offset of a string in the string heap of the file
+ * The codes are kept as they are in the file, so the codes in the file can be used as they are
+ * If a dictionary has already been loaded, the dictionary of the file has to start with the same strings,
+ * and only its new strings are added. The delta is written like that, so it shares the codes of the database
+ *
+ * Returns 0 on success
+ * Returns -1 if the dictionary could not be loaded. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_LoadDictionary(const DatabaseSection* section, const DatabaseSection* heap)
+{
+    DatabaseDictionary* dictionary = &(Database_GetSnapshot()->dictionary);
+    for (int i = 0; i < section->rows; i++)
+    {
+        const unsigned char* row = (const unsigned char*) &(section->data[i * section->row_size]);
+        unsigned int offset = row[0] | (row[1] << 8) | (row[2] << 16) | ((unsigned int) row[3] << 24);
+
+        // Strings that start outside of the heap are read as empty strings, in the same way as the other string columns
+        const char* str = (offset < (unsigned int) heap->size) ? &(heap->data[offset]) : "";
+        if (i < dictionary->strings_size) {
+            if (strcmp(dictionary->strings[i], str) != 0) {
+                fprintf(stderr, "[%ld] Failed to load the dictionary: Code %d is already used by another string\n", GetLogId(), i);
+                return -1;
+            }
+            continue;
+        }
+        DictionaryCode code = 0;
+        if (Insert(dictionary, str, &code) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Finds the code of a string, e.g. to filter races by their type without comparing any strings
+ *
+ * Returns 0 on success, and sets "code" to the code of the string
+ * Returns -2 if the string is not in the dictionary, so that no race has it
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_FindDictionaryCode(const char* str, DictionaryCode* code)
+{
+    const DatabaseDictionary* dictionary = &(Database_GetSnapshot()->dictionary);
+    if (dictionary->slots_size == 0) {
+        return -2;
+    }
+    int slot = FindSlot(dictionary, str);
+    if (dictionary->slots[slot] == -1) {
+        return -2;
+    }
+    *code = (DictionaryCode) dictionary->slots[slot];
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets the string of a code. Unknown codes are read as the empty string
+ * --------------------------------------------------------------------------------------------------
+ */
+const char* Database_GetDictionaryString(DictionaryCode code)
+{
+    const DatabaseDictionary* dictionary = &(Database_GetSnapshot()->dictionary);
+    return (code < dictionary->strings_size) ? dictionary->strings[code] : "";
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets the number of strings in the dictionary. The codes are 0 up to the number of strings
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_GetDictionarySize()
+{
+    return Database_GetSnapshot()->dictionary.strings_size;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Frees the dictionary of a snapshot. The strings are in the mapped files, and are not freed
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_FreeDictionary(DatabaseDictionary* dictionary)
+{
+    free(dictionary->strings);
+    free(dictionary->slots);
+    memset(dictionary, 0, sizeof(DatabaseDictionary));
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Adds a string at the next code. A string that is already in the dictionary keeps its first code in the hash table
+ * Returns 0 on success, and -1 on failure
+ * --------------------------------------------------------------------------------------------------
+ */
+static int Insert(DatabaseDictionary* dictionary, const char* str, DictionaryCode* code)
+{
+    if (dictionary->strings_size >= DICTIONARY_MAX_SIZE) {
+        fprintf(stderr, "[%ld] Failed to add to the dictionary: The dictionary is full\n", GetLogId());
+        return -1;
+    }
+    if (dictionary->strings_size >= dictionary->strings_capacity)
+    {
+        int new_capacity = (dictionary->strings_capacity > 0) ? dictionary->strings_capacity * 2 : 256;
+        const char** new_strings = (const char**) realloc(dictionary->strings, new_capacity * sizeof(const char*));
+        if (new_strings == 0) {
+            fprintf(stderr, "[%ld] Failed to add to the dictionary: Failed to allocate memory\n", GetLogId());
+            return -1;
+        }
+        dictionary->strings = new_strings;
+        dictionary->strings_capacity = new_capacity;
+    }
+    // The hash table is kept at most half full
+    if ((dictionary->strings_size + 1) * 2 > dictionary->slots_size && Rehash(dictionary, (dictionary->slots_size > 0) ? dictionary->slots_size * 2 : 512) == -1) {
+        fprintf(stderr, "[%ld] Failed to add to the dictionary: Failed to allocate memory\n", GetLogId());
+        return -1;
+    }
+
+    int slot = FindSlot(dictionary, str);
+    if (dictionary->slots[slot] == -1) {
+        dictionary->slots[slot] = dictionary->strings_size;
+    }
+    dictionary->strings[dictionary->strings_size] = str;
+    *code = (DictionaryCode) dictionary->strings_size;
+    dictionary->strings_size++;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Finds the slot of a string in the hash table, or the empty slot where it would be added
+ * --------------------------------------------------------------------------------------------------
+ */
+static int FindSlot(const DatabaseDictionary* dictionary, const char* str)
+{
+    int mask = dictionary->slots_size - 1;
+    int slot = (int) (Hash(str) & mask);
+    while (dictionary->slots[slot] != -1 && strcmp(dictionary->strings[dictionary->slots[slot]], str) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static int Rehash(DatabaseDictionary* dictionary, int new_slots_size)
+{
+    int* new_slots = (int*) malloc(new_slots_size * sizeof(int));
+    if (new_slots == 0) {
+        return -1;
+    }
+    free(dictionary->slots);
+    dictionary->slots = new_slots;
+    dictionary->slots_size = new_slots_size;
+    memset(dictionary->slots, -1, dictionary->slots_size * sizeof(int));
+
+    for (int i = 0; i < dictionary->strings_size; i++) {
+        int slot = FindSlot(dictionary, dictionary->strings[i]);
+        if (dictionary->slots[slot] == -1) {
+            dictionary->slots[slot] = i;
+        }
+    }
+    return 0;
+}
+
+
+// FNV-1a
+static unsigned int Hash(const char* str)
+{
+    unsigned int hash = 2166136261u;
+    for (; *str != '\0'; str++) {
+        hash = (hash ^ (unsigned char) *str) * 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,1166 @@
+#include "Database.h"
+
+#include "../util/Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RESULT_MIN_SIZE 19  // The fixed part of a rank (18 bytes), and at least one byte of its strings
+
+// All database files are read directly from their mappings, in either the old format or the v2 format.
+// The records are decoded at the offset that is found in the index file of the database file, so nothing has to be
+// parsed at startup once the index files exist. In the v2 format the offset is where the row of the record starts.
+// The files are loaded into a snapshot, and are only read from after that (see "DatabaseSnapshot" in Database.h).
+// The delta is looked up first, since its records replace the records in the database files (see DB_DELTA_DIR in Database.h)
+
+static int LoadIndexedFile(DatabaseFile* file, RecordScanner scanner);
+static int FindRecord(const DatabaseFile* file, unsigned int key, int* offset, int* count);
+static int FindMergedRecord(const DatabaseFile* file, const DatabaseFile* delta, unsigned int key, const DatabaseFile** found, int* offset, int* count);
+static int NextMergedRecord(const DatabaseFile* file, const DatabaseFile* delta, RecordScanner scanner, int* offset, const DatabaseFile** found, int* record_offset);
+static int DecodeAthlete(const DatabaseFile* file, int* offset, AthleteRecord* athlete);
+static int DecodeRaceIds(const DatabaseFile* file, int* offset, RaceIdsRecord* race_ids);
+static int DecodeRaceInfo(const DatabaseFile* file, int* offset, RaceInfoRecord* race_info);
+static int ReadRaceInfo(const DatabaseFile* file, int* offset, RaceInfoRecord* race_info, const char** columns);
+static int LoadDictionary(const DatabaseFile* file);
+static int DecodeRaceResults(const DatabaseFile* file, int* offset, RaceResultsRecord* race_results);
+static int DecodeResult(const char* buffer, int size, int* offset, ResultRecord* result);
+static int DecodePackedRanks(const DatabaseFile* file, unsigned int first, unsigned int count, RaceResultsRecord* race_results);
+static void DecodePackedResult(const RaceResultsRecord* race, int i, ResultRecord* result);
+static unsigned long long GetPackedColumn(const RaceResultsRecord* race, int i, int column);
+static int ScanAthlete(const void* file, int* offset, unsigned int* key, unsigned int* count);
+static int ScanRaceIds(const void* file, int* offset, unsigned int* key, unsigned int* count);
+static int ScanRaceInfo(const void* file, int* offset, unsigned int* key, unsigned int* count);
+static int ScanRaceResults(const void* file, int* offset, unsigned int* key, unsigned int* count);
+static const char* NextRow(const DatabaseFile* file, int section, int* offset);
+static int GetListSize(const DatabaseFile* file, int section, unsigned int first, unsigned int count);
+static unsigned int GetColumn(const char* row, int column);
+static const char* GetString(const char* heap, int heap_size, unsigned int offset);
+static DictionaryCode GetCode(unsigned int code);
+static unsigned int ReadU32(const char* buffer, int* offset);
+static unsigned int ReadU16(const char* buffer, int* offset);
+static int ReadVarint(const char* buffer, int size, int* offset, unsigned long long* value);
+static long long Unzigzag(unsigned long long value);
+static const char* ReadString(const char* buffer, int size, int* offset);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Loads the indexes of the preloaded database files, so that the records can be found by their fiscode or raceid
+ * Called by "Database_Preload" once the files have been loaded. Files that were not loaded are not indexed,
+ * and all lookups in them will fail. If any file of the delta fails, the whole delta is left out,
+ * so that the records of the delta are never mixed with the records they should have replaced
+ *
+ * Returns 0 if all files were indexed, and -1 if any file could not be indexed
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_BuildIndexes()
+{
+    // The race info of the database is loaded before the race info of the delta, whose dictionary extends the dictionary of the database
+    DatabaseFile* files = Database_GetSnapshot()->files;
+    RecordScanner scanners[] = { ScanAthlete, ScanRaceIds, ScanRaceInfo, ScanRaceResults };
+
+    int result = 0;
+    bool delta_failed = false;
+    for (int i = 0; i < DB_FILE_COUNT; i++) {
+        if (LoadIndexedFile(&(files[i]), scanners[i % DB_FILE_DELTA]) == -1) {
+            result = -1;
+            delta_failed = delta_failed || files[i].delta;
+        }
+    }
+    if (delta_failed) {
+        fprintf(stderr, "[%ld] The races in %s are left out, since the delta could not be loaded\n", GetLogId(), DB_DELTA_DIR);
+        for (int i = DB_FILE_DELTA; i < DB_FILE_COUNT; i++) {
+            files[i].loaded = false;
+        }
+    }
+    else if (Database_HasDelta()) {
+        fprintf(stderr, "[%ld] Loaded the delta in %s\n", GetLogId(), DB_DELTA_DIR);
+    }
+    return result;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Checks if the delta has been loaded, so that the database is read together with the races that have been appended to it
+ * --------------------------------------------------------------------------------------------------
+ */
+bool Database_HasDelta()
+{
+    const DatabaseFile* files = Database_GetSnapshot()->files;
+    for (int i = DB_FILE_DELTA; i < DB_FILE_COUNT; i++) {
+        if (files[i].loaded) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads the next athlete in the database, in the same order as they are stored in the file
+ * The athletes of the delta are read after the athletes of the database, and the athletes they replace are skipped
+ *
+ * offset: Where the athlete is stored in the file. Should be set to 0 to read the first athlete, or to DB_DELTA_OFFSET
+ *         to only read the athletes of the delta, and is moved to the next athlete after every call
+ * athlete: Set to the athlete that was read
+ *
+ * Returns 0 on success
+ * Returns -1 if the athletes are not loaded. An error message will be printed
+ * Returns -2 if there are no more athletes
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_NextAthlete(int* offset, AthleteRecord* athlete)
+{
+    // Searching for athletes reads all of them, so without a delta they are decoded directly instead of being scanned first
+    const DatabaseFile* files = Database_GetSnapshot()->files;
+    if (!files[DB_FILE_ATHLETES + DB_FILE_DELTA].loaded && files[DB_FILE_ATHLETES].loaded) {
+        return (DecodeAthlete(&(files[DB_FILE_ATHLETES]), offset, athlete) == 0) ? 0 : -2;
+    }
+    const DatabaseFile* file = 0;
+    int record_offset = 0;
+    int res = NextMergedRecord(&(files[DB_FILE_ATHLETES]), &(files[DB_FILE_ATHLETES + DB_FILE_DELTA]), ScanAthlete, offset, &file, &record_offset);
+    if (res < 0) {
+        return res;
+    }
+    return (DecodeAthlete(file, &record_offset, athlete) == 0) ? 0 : -2;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads the next record in the race ids, race info or race results, in the same order as they are stored in the file
+ * The offset should be set to 0 to read the first record, and is moved to the next record after every call.
+ * In the same way as for the athletes, the records of the delta are read last, and the records they replace are skipped
+ *
+ * Returns 0 on success
+ * Returns -1 if the file is not loaded. An error message will be printed
+ * Returns -2 if there are no more records
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_NextRaceIds(int* offset, RaceIdsRecord* race_ids)
+{
+    const DatabaseFile* files = Database_GetSnapshot()->files;
+    const DatabaseFile* file = 0;
+    int record_offset = 0;
+    int res = NextMergedRecord(&(files[DB_FILE_ATHLETE_RACES]), &(files[DB_FILE_ATHLETE_RACES + DB_FILE_DELTA]), ScanRaceIds, offset, &file, &record_offset);
+    if (res < 0) {
+        return res;
+    }
+    return (DecodeRaceIds(file, &record_offset, race_ids) == 0) ? 0 : -2;
+}
+
+int Database_NextRaceInfo(int* offset, RaceInfoRecord* race_info)
+{
+    const DatabaseFile* files = Database_GetSnapshot()->files;
+    const DatabaseFile* file = 0;
+    int record_offset = 0;
+    int res = NextMergedRecord(&(files[DB_FILE_RACE_INFO]), &(files[DB_FILE_RACE_INFO + DB_FILE_DELTA]), ScanRaceInfo, offset, &file, &record_offset);
+    if (res < 0) {
+        return res;
+    }
+    return (DecodeRaceInfo(file, &record_offset, race_info) == 0) ? 0 : -2;
+}
+
+int Database_NextRaceResults(int* offset, RaceResultsRecord* race_results)
+{
+    const DatabaseFile* files = Database_GetSnapshot()->files;
+    const DatabaseFile* file = 0;
+    int record_offset = 0;
+    int res = NextMergedRecord(&(files[DB_FILE_RACE_RESULTS]), &(files[DB_FILE_RACE_RESULTS + DB_FILE_DELTA]), ScanRaceResults, offset, &file, &record_offset);
+    if (res < 0) {
+        return res;
+    }
+    return (DecodeRaceResults(file, &record_offset, race_results) == 0) ? 0 : -2;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Finds the athlete with the given fiscode
+ *
+ * Returns 0 on success, and sets "athlete" to the athlete
+ * Returns -1 if the athletes are not loaded. An error message will be printed
+ * Returns -2 if the athlete could not be found
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_FindAthlete(unsigned int fiscode, AthleteRecord* athlete)
+{
+    const DatabaseFile* files = Database_GetSnapshot()->files;
+    const DatabaseFile* file = 0;
+    int offset = 0;
+    int res = FindMergedRecord(&(files[DB_FILE_ATHLETES]), &(files[DB_FILE_ATHLETES + DB_FILE_DELTA]), fiscode, &file, &offset, 0);
+    if (res < 0) {
+        return res;
+    }
+    return (DecodeAthlete(file, &offset, athlete) == 0) ? 0 : -2;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Finds the list of races for the athlete with the given fiscode
+ *
+ * Returns 0 on success, and sets "race_ids" to the list of races
+ * Returns -1 if the race ids are not loaded. An error message will be printed
+ * Returns -2 if the athlete could not be found
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_FindRaceIds(unsigned int fiscode, RaceIdsRecord* race_ids)
+{
+    const DatabaseFile* files = Database_GetSnapshot()->files;
+    const DatabaseFile* file = 0;
+    int offset = 0;
+    int res = FindMergedRecord(&(files[DB_FILE_ATHLETE_RACES]), &(files[DB_FILE_ATHLETE_RACES + DB_FILE_DELTA]), fiscode, &file, &offset, 0);
+    if (res < 0) {
+        return res;
+    }
+    return (DecodeRaceIds(file, &offset, race_ids) == 0) ? 0 : -2;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets a race id from a list of races. The race ids are read directly from the mapped file, where they may not be aligned
+ * --------------------------------------------------------------------------------------------------
+ */
+unsigned int Database_GetRaceId(const RaceIdsRecord* race_ids, int i)
+{
+    int offset = i * 4;
+    return ReadU32(race_ids->raceids, &offset);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets the result of the athlete in a race of the race list of the athlete
+ * The result is read from the race list, where it was copied to when the database was built, so the result list
+ * of the race is not searched. Files without the results (before version 4) find it in the result list instead
+ *
+ * race_ids: The race list of the athlete
+ * i: The position of the race in the list
+ * result: Set to the result of the athlete in the race
+ *
+ * Returns 0 on success
+ * Returns -2 if the athlete is not in the result list of the race
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_GetAthleteResult(const RaceIdsRecord* race_ids, int i, AthleteResultRecord* result)
+{
+    result->raceid = Database_GetRaceId(race_ids, i);
+    if (race_ids->results != 0)
+    {
+        const char* row = &(race_ids->results[i * DB_ROW_ATHLETE_RESULT]);
+        result->rank = GetColumn(row, 0);
+        result->time = GetColumn(row, 1);
+        result->diff = GetColumn(row, 2);
+        result->participants = GetColumn(row, 3);
+        result->name = GetString(race_ids->strings, race_ids->strings_size, GetColumn(row, 4));
+        result->fispoints = GetString(race_ids->strings, race_ids->strings_size, GetColumn(row, 5));
+        return (result->participants > 0) ? 0 : -2;
+    }
+
+    RaceResultsRecord race_results;
+    ResultRecord race_result;
+    if (Database_FindRaceResults(result->raceid, &race_results) != 0 || Database_FindResult(&race_results, race_ids->fiscode, &race_result) != 0) {
+        return -2;
+    }
+    result->rank = race_result.rank;
+    result->time = race_result.time;
+    result->diff = race_result.diff;
+    result->participants = (unsigned int) race_results.results_size;
+    result->name = race_result.name;
+    result->fispoints = race_result.fispoints;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Finds the race info for the given race
+ *
+ * Returns 0 on success, and sets "race_info" to the race info
+ * Returns -1 if the race info is not loaded. An error message will be printed
+ * Returns -2 if the race could not be found
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_FindRaceInfo(unsigned int raceid, RaceInfoRecord* race_info)
+{
+    const DatabaseFile* files = Database_GetSnapshot()->files;
+    const DatabaseFile* file = 0;
+    int offset = 0;
+    int res = FindMergedRecord(&(files[DB_FILE_RACE_INFO]), &(files[DB_FILE_RACE_INFO + DB_FILE_DELTA]), raceid, &file, &offset, 0);
+    if (res < 0) {
+        return res;
+    }
+    return (DecodeRaceInfo(file, &offset, race_info) == 0) ? 0 : -2;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Finds the result list for the given race
+ * The number of ranks is stored in the index, so the result list is found without reading any of the ranks
+ *
+ * Returns 0 on success, and sets "race_results" to the result list. Use "Database_NextResult" to read the ranks
+ * Returns -1 if the race results are not loaded. An error message will be printed
+ * Returns -2 if the race could not be found
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_FindRaceResults(unsigned int raceid, RaceResultsRecord* race_results)
+{
+    const DatabaseFile* files = Database_GetSnapshot()->files;
+    const DatabaseFile* file = 0;
+    int offset = 0;
+    int count = 0;
+    int res = FindMergedRecord(&(files[DB_FILE_RACE_RESULTS]), &(files[DB_FILE_RACE_RESULTS + DB_FILE_DELTA]), raceid, &file, &offset, &count);
+    if (res < 0) {
+        return res;
+    }
+    if (file->layout.version != 1) {
+        return (DecodeRaceResults(file, &offset, race_results) == 0) ? 0 : -2;
+    }
+    if (offset < 0 || offset + 6 > file->size) {
+        return -2;
+    }
+
+    race_results->raceid = ReadU32(file->buffer, &offset);
+    offset += 2;  // The number of ranks in the file, which may include ranks that were cut off at the end of the file
+    race_results->results_size = count;
+    race_results->results = &(file->buffer[offset]);
+    race_results->results_bytes = file->size - offset;
+    race_results->strings = 0;
+    race_results->strings_size = 0;
+    race_results->packed = false;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads the next rank in a result list. The ranks are read in order, and there are "results_size" of them
+ *
+ * offset: Where the rank is stored in the result list. Should be set to 0 to read the first rank,
+ *         and is moved to the next rank after every call. For packed ranks it is the position of the rank in the list
+ * result: Set to the rank that was read
+ *
+ * Returns 0 on success, and -2 if there are no more ranks
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_NextResult(const RaceResultsRecord* race, int* offset, ResultRecord* result)
+{
+    if (race->packed) {
+        if (*offset < 0 || *offset >= race->results_size) {
+            return -2;
+        }
+        DecodePackedResult(race, *offset, result);
+        (*offset)++;
+        return 0;
+    }
+    if (race->strings == 0) {
+        return (DecodeResult(race->results, race->results_bytes, offset, result) == 0) ? 0 : -2;
+    }
+
+    if (*offset < 0 || *offset + DB_ROW_RANK > race->results_bytes) {
+        return -2;
+    }
+    const char* row = &(race->results[*offset]);
+    *offset += DB_ROW_RANK;
+    result->rank = GetColumn(row, 0);
+    result->bib = GetColumn(row, 1);
+    result->fiscode = GetColumn(row, 2);
+    result->time = GetColumn(row, 3);
+    result->diff = GetColumn(row, 4);
+    result->year = GetColumn(row, 5);
+    result->name = GetString(race->strings, race->strings_size, GetColumn(row, 6));
+    result->nation = GetString(race->strings, race->strings_size, GetColumn(row, 7));
+    result->fispoints = GetString(race->strings, race->strings_size, GetColumn(row, 8));
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Finds the result of the athlete with the given fiscode in a result list
+ *
+ * Returns 0 on success, and sets "result" to the result
+ * Returns -2 if the athlete has no result in the race
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_FindResult(const RaceResultsRecord* race, unsigned int fiscode, ResultRecord* result)
+{
+    // Only the entrant column is read from the packed ranks, until the athlete is found
+    if (race->packed) {
+        for (int i = 0; i < race->results_size; i++) {
+            unsigned long long entrant = GetPackedColumn(race, i, 2);
+            if (entrant < (unsigned long long) race->entrants_size && GetColumn(&(race->entrants[entrant * DB_ROW_ENTRANT]), 0) == fiscode) {
+                DecodePackedResult(race, i, result);
+                return 0;
+            }
+        }
+        return -2;
+    }
+
+    int offset = 0;
+    for (int i = 0; i < race->results_size && Database_NextResult(race, &offset, result) == 0; i++) {
+        if (result->fiscode == fiscode) {
+            return 0;
+        }
+    }
+    return -2;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Copies a string from a record into a fixed size buffer, and cuts it off if it does not fit
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_CopyString(char* dest, int dest_size, const char* src)
+{
+    int size = strnlen(src, dest_size - 1);
+    memcpy(dest, src, size);
+    dest[size] = '\0';
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Loads the index of a database file that is read directly from its mapping
+ * Returns 0 on success, and -1 on failure
+ * --------------------------------------------------------------------------------------------------
+ */
+static int LoadIndexedFile(DatabaseFile* file, RecordScanner scanner)
+{
+    if (file->loaded) {
+        return 0;
+    }
+
+    char* buffer = 0;
+    int size = 0;
+    if (Database_GetPreloadedFile(file->path, &buffer, &size) != 0) {
+        return file->delta ? 0 : -1;  // Database_Preload has already printed why the file is missing, and the delta is optional
+    }
+    if (Database_ReadLayout(file->path, buffer, size, file->type, &(file->layout)) == -1) {
+        return -1;  // The Database_ReadLayout function will print the error message
+    }
+    file->buffer = buffer;
+    file->size = size;
+    if (file->type == DB_TYPE_RACE_INFO && LoadDictionary(file) == -1) {
+        return -1;  // The LoadDictionary function will print the error message
+    }
+    if (Database_LoadKeyIndex(file->path, size, scanner, file, &(file->keys)) == -1) {
+        return -1;  // The Database_LoadKeyIndex function will print the error message
+    }
+    file->loaded = true;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Looks up where the record with the given key is stored in a database file
+ *
+ * offset: Set to where the record starts in the file
+ * count: Set to the number of races or ranks of the record, if it is not 0
+ *
+ * Returns 0 on success
+ * Returns -1 if the file is not loaded. An error message will be printed
+ * Returns -2 if the key could not be found
+ * --------------------------------------------------------------------------------------------------
+ */
+static int FindRecord(const DatabaseFile* file, unsigned int key, int* offset, int* count)
+{
+    if (!file->loaded) {
+        fprintf(stderr, "[%ld] Failed to query the database: %s is not loaded\n", GetLogId(), file->path);
+        return -1;
+    }
+    int record_count = 0;
+    if (Database_FindKey(&(file->keys), key, offset, &record_count) != 0) {
+        return -2;
+    }
+    if (count != 0) {
+        *count = record_count;
+    }
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Looks up a record in the delta first, and then in the database file, since the records of the delta replace the others
+ *
+ * found: Set to the file that the record was found in
+ * offset: Set to where the record starts in that file
+ * count: Set to the number of races or ranks of the record, if it is not 0
+ *
+ * Returns 0 on success
+ * Returns -1 if the database file is not loaded. An error message will be printed
+ * Returns -2 if the key could not be found
+ * --------------------------------------------------------------------------------------------------
+ */
+static int FindMergedRecord(const DatabaseFile* file, const DatabaseFile* delta, unsigned int key, const DatabaseFile** found, int* offset, int* count)
+{
+    if (file->loaded && delta->loaded && FindRecord(delta, key, offset, count) == 0) {
+        *found = delta;
+        return 0;
+    }
+    *found = file;
+    return FindRecord(file, key, offset, count);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Finds the next record when the records of the database file and the delta are read in order
+ * The records of the database file are read first, and are skipped if the delta has a record with the same key.
+ * The records of the delta are then read at negative offsets, starting at DB_DELTA_OFFSET for the first record of the delta
+ *
+ * offset: The offset of the next record, that is moved past the record
+ * found: Set to the file of the record
+ * record_offset: Set to where the record starts in that file
+ *
+ * Returns 0 on success
+ * Returns -1 if the database file is not loaded. An error message will be printed
+ * Returns -2 if there are no more records
+ * --------------------------------------------------------------------------------------------------
+ */
+static int NextMergedRecord(const DatabaseFile* file, const DatabaseFile* delta, RecordScanner scanner, int* offset, const DatabaseFile** found, int* record_offset)
+{
+    if (!file->loaded) {
+        fprintf(stderr, "[%ld] Failed to query the database: %s is not loaded\n", GetLogId(), file->path);
+        return -1;
+    }
+
+    unsigned int key = 0;
+    unsigned int count = 0;
+    int delta_offset = 0;
+    int delta_count = 0;
+    while (*offset >= 0)
+    {
+        int start = *offset;
+        if (scanner(file, offset, &key, &count) != 0) {
+            *offset = DB_DELTA_OFFSET;
+            break;
+        }
+        if (!delta->loaded || Database_FindKey(&(delta->keys), key, &delta_offset, &delta_count) != 0) {
+            *found = file;
+            *record_offset = start;
+            return 0;
+        }
+    }
+
+    if (!delta->loaded) {
+        return -2;
+    }
+    int position = DB_DELTA_OFFSET - *offset;
+    int start = position;
+    if (scanner(delta, &position, &key, &count) != 0) {
+        return -2;
+    }
+    *offset = DB_DELTA_OFFSET - position;
+    *found = delta;
+    *record_offset = start;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Decodes the athlete at the offset. In the old format: fiscode (4 bytes), compid (4 bytes), and 6 null-terminated strings
+ * Returns 0 on success, and moves the offset to the next athlete. Returns -1 if there is no athlete at the offset
+ * --------------------------------------------------------------------------------------------------
+ */
+static int DecodeAthlete(const DatabaseFile* file, int* offset, AthleteRecord* athlete)
+{
+    if (file->layout.version != 1)
+    {
+        const char* row = NextRow(file, 0, offset);
+        if (row == 0) {
+            return -1;
+        }
+        const DatabaseSection* strings = &(file->layout.sections[1]);
+        athlete->fiscode = GetColumn(row, 0);
+        athlete->compid = GetColumn(row, 1);
+        athlete->firstname = GetString(strings->data, strings->size, GetColumn(row, 2));
+        athlete->lastname = GetString(strings->data, strings->size, GetColumn(row, 3));
+        athlete->nation = GetString(strings->data, strings->size, GetColumn(row, 4));
+        athlete->birthdate = GetString(strings->data, strings->size, GetColumn(row, 5));
+        athlete->gender = GetString(strings->data, strings->size, GetColumn(row, 6));
+        athlete->club = GetString(strings->data, strings->size, GetColumn(row, 7));
+        return 0;
+    }
+
+    const char* buffer = file->buffer;
+    int size = file->size;
+    if (*offset < 0 || *offset + 8 > size) {
+        return -1;
+    }
+    athlete->fiscode = ReadU32(buffer, offset);
+    athlete->compid = ReadU32(buffer, offset);
+    athlete->firstname = ReadString(buffer, size, offset);
+    athlete->lastname = ReadString(buffer, size, offset);
+    athlete->nation = ReadString(buffer, size, offset);
+    athlete->birthdate = ReadString(buffer, size, offset);
+    athlete->gender = ReadString(buffer, size, offset);
+    athlete->club = ReadString(buffer, size, offset);
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Decodes the races of the athlete at the offset. In the old format: fiscode (4 bytes), the number of races (4 bytes),
+ * and a raceid (4 bytes) for each race
+ * Returns 0 on success, and moves the offset to the next athlete. Returns -1 if there is no athlete at the offset
+ * --------------------------------------------------------------------------------------------------
+ */
+static int DecodeRaceIds(const DatabaseFile* file, int* offset, RaceIdsRecord* race_ids)
+{
+    if (file->layout.version != 1)
+    {
+        const char* row = NextRow(file, 0, offset);
+        if (row == 0) {
+            return -1;
+        }
+        unsigned int first = GetColumn(row, 1);
+        race_ids->fiscode = GetColumn(row, 0);
+        race_ids->raceids_size = GetListSize(file, 1, first, GetColumn(row, 2));
+        race_ids->raceids = (race_ids->raceids_size > 0) ? &(file->layout.sections[1].data[first * DB_ROW_RACEID]) : file->buffer;
+        race_ids->results = 0;
+        race_ids->strings = 0;
+        race_ids->strings_size = 0;
+
+        // The results are only used if there is one for every race
+        if (file->layout.version >= DB_FORMAT_RESULTS_VERSION && file->layout.sections[2].rows == file->layout.sections[1].rows)
+        {
+            race_ids->results = (race_ids->raceids_size > 0) ? &(file->layout.sections[2].data[first * DB_ROW_ATHLETE_RESULT]) : file->buffer;
+            race_ids->strings = file->layout.sections[3].data;
+            race_ids->strings_size = file->layout.sections[3].size;
+        }
+        return 0;
+    }
+
+    const char* buffer = file->buffer;
+    int size = file->size;
+    if (*offset < 0 || *offset + 8 > size) {
+        return -1;
+    }
+    race_ids->fiscode = ReadU32(buffer, offset);
+    unsigned int count = ReadU32(buffer, offset);
+
+    // The list is cut off if the file ends before all race ids
+    int available = (size - *offset) / 4;
+    race_ids->raceids_size = (count < (unsigned int) available) ? (int) count : available;
+    race_ids->raceids = &(buffer[*offset]);
+    race_ids->results = 0;
+    race_ids->strings = 0;
+    race_ids->strings_size = 0;
+    *offset = (count < (unsigned int) available) ? *offset + (int) count * 4 : size;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Decodes the race info at the offset. Nation, category, discipline, type and gender are decoded as dictionary codes.
+ * They are stored as codes since the dictionary version of the format, and are looked up in the dictionary in older files
+ * Returns 0 on success, and moves the offset to the next race. Returns -1 if there is no race at the offset
+ * --------------------------------------------------------------------------------------------------
+ */
+static int DecodeRaceInfo(const DatabaseFile* file, int* offset, RaceInfoRecord* race_info)
+{
+    if (file->layout.version >= DB_FORMAT_DICTIONARY_VERSION)
+    {
+        const char* row = NextRow(file, 0, offset);
+        if (row == 0) {
+            return -1;
+        }
+        const DatabaseSection* strings = &(file->layout.sections[2]);
+        race_info->raceid = GetColumn(row, 0);
+        race_info->codex = GetColumn(row, 1);
+        race_info->date = GetString(strings->data, strings->size, GetColumn(row, 2));
+        race_info->nation = GetCode(GetColumn(row, 3));
+        race_info->location = GetString(strings->data, strings->size, GetColumn(row, 4));
+        race_info->category = GetCode(GetColumn(row, 5));
+        race_info->discipline = GetCode(GetColumn(row, 6));
+        race_info->type = GetCode(GetColumn(row, 7));
+        race_info->gender = GetCode(GetColumn(row, 8));
+        return 0;
+    }
+
+    const char* columns[5];
+    if (ReadRaceInfo(file, offset, race_info, columns) != 0) {
+        return -1;
+    }
+    // Every string was added to the dictionary when the file was loaded, so they are always found
+    DictionaryCode* codes[] = { &(race_info->nation), &(race_info->category), &(race_info->discipline), &(race_info->type), &(race_info->gender) };
+    for (int i = 0; i < 5; i++) {
+        *(codes[i]) = 0;
+        Database_FindDictionaryCode(columns[i], codes[i]);
+    }
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads the race info at the offset in a file without the dictionary, where all columns are strings
+ * In the old format: raceid (4 bytes), codex (4 bytes), and 7 null-terminated strings
+ *
+ * columns: Set to the strings of the nation, category, discipline, type and gender
+ *
+ * Returns 0 on success, and moves the offset to the next race. Returns -1 if there is no race at the offset
+ * --------------------------------------------------------------------------------------------------
+ */
+static int ReadRaceInfo(const DatabaseFile* file, int* offset, RaceInfoRecord* race_info, const char** columns)
+{
+    if (file->layout.version != 1)
+    {
+        const char* row = NextRow(file, 0, offset);
+        if (row == 0) {
+            return -1;
+        }
+        const DatabaseSection* strings = &(file->layout.sections[1]);
+        race_info->raceid = GetColumn(row, 0);
+        race_info->codex = GetColumn(row, 1);
+        race_info->date = GetString(strings->data, strings->size, GetColumn(row, 2));
+        columns[0] = GetString(strings->data, strings->size, GetColumn(row, 3));
+        race_info->location = GetString(strings->data, strings->size, GetColumn(row, 4));
+        columns[1] = GetString(strings->data, strings->size, GetColumn(row, 5));
+        columns[2] = GetString(strings->data, strings->size, GetColumn(row, 6));
+        columns[3] = GetString(strings->data, strings->size, GetColumn(row, 7));
+        columns[4] = GetString(strings->data, strings->size, GetColumn(row, 8));
+        return 0;
+    }
+
+    const char* buffer = file->buffer;
+    int size = file->size;
+    if (*offset < 0 || *offset + 8 > size) {
+        return -1;
+    }
+    race_info->raceid = ReadU32(buffer, offset);
+    race_info->codex = ReadU32(buffer, offset);
+    race_info->date = ReadString(buffer, size, offset);
+    columns[0] = ReadString(buffer, size, offset);
+    race_info->location = ReadString(buffer, size, offset);
+    columns[1] = ReadString(buffer, size, offset);
+    columns[2] = ReadString(buffer, size, offset);
+    columns[3] = ReadString(buffer, size, offset);
+    columns[4] = ReadString(buffer, size, offset);
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Loads the dictionary of the race info. Files with the dictionary are loaded as they are.
+ * In older files every race is read once, and its strings are added to the dictionary
+ * Returns 0 on success, and -1 on failure. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+static int LoadDictionary(const DatabaseFile* file)
+{
+    if (file->layout.version >= DB_FORMAT_DICTIONARY_VERSION) {
+        return Database_LoadDictionary(&(file->layout.sections[1]), &(file->layout.sections[2]));
+    }
+
+    int offset = 0;
+    RaceInfoRecord race_info;
+    const char* columns[5];
+    while (ReadRaceInfo(file, &offset, &race_info, columns) == 0)
+    {
+        for (int i = 0; i < 5; i++) {
+            DictionaryCode code = 0;
+            if (Database_AddDictionaryString(columns[i], &code) == -1) {
+                fprintf(stderr, "[%ld] Failed to build the dictionary of %s\n", GetLogId(), file->path);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Decodes the result list of the race at the offset. In the old format: raceid (4 bytes), the number of ranks (2 bytes),
+ * and the ranks. All ranks are read in the old format to find where the next race starts, and to count the ranks
+ * that are stored before the end of the file
+ * Returns 0 on success, and moves the offset to the next race. Returns -1 if there is no race at the offset
+ * --------------------------------------------------------------------------------------------------
+ */
+static int DecodeRaceResults(const DatabaseFile* file, int* offset, RaceResultsRecord* race_results)
+{
+    if (file->layout.version != 1)
+    {
+        const char* row = NextRow(file, 0, offset);
+        if (row == 0) {
+            return -1;
+        }
+        unsigned int first = GetColumn(row, 1);
+        race_results->raceid = GetColumn(row, 0);
+        if (file->layout.version >= DB_FORMAT_PACKED_VERSION) {
+            return DecodePackedRanks(file, first, GetColumn(row, 2), race_results);
+        }
+        race_results->packed = false;
+        race_results->results_size = GetListSize(file, 1, first, GetColumn(row, 2));
+        race_results->results = (race_results->results_size > 0) ? &(file->layout.sections[1].data[first * DB_ROW_RANK]) : file->buffer;
+        race_results->results_bytes = race_results->results_size * DB_ROW_RANK;
+        race_results->strings = file->layout.sections[2].data;
+        race_results->strings_size = file->layout.sections[2].size;
+        return 0;
+    }
+
+    const char* buffer = file->buffer;
+    int size = file->size;
+    if (*offset < 0 || *offset + 6 > size) {
+        return -1;
+    }
+    race_results->raceid = ReadU32(buffer, offset);
+    unsigned int ranks = ReadU16(buffer, offset);
+    race_results->results = &(buffer[*offset]);
+    race_results->results_size = 0;
+    race_results->strings = 0;
+    race_results->strings_size = 0;
+    race_results->packed = false;
+
+    int start = *offset;
+    ResultRecord result;
+    while ((unsigned int) race_results->results_size < ranks && DecodeResult(buffer, size, offset, &result) == 0) {
+        race_results->results_size++;
+    }
+    race_results->results_bytes = *offset - start;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Decodes the rank at the offset: rank (2 bytes), bib (2 bytes), fiscode (4 bytes), time (4 bytes), diff (4 bytes),
+ * year (2 bytes), and 3 null-terminated strings
+ * Returns 0 on success, and moves the offset to the next rank. Returns -1 if there is no rank at the offset
+ * --------------------------------------------------------------------------------------------------
+ */
+static int DecodeResult(const char* buffer, int size, int* offset, ResultRecord* result)
+{
+    if (*offset < 0 || *offset + RESULT_MIN_SIZE > size) {
+        return -1;
+    }
+    result->rank = ReadU16(buffer, offset);
+    result->bib = ReadU16(buffer, offset);
+    result->fiscode = ReadU32(buffer, offset);
+    result->time = ReadU32(buffer, offset);
+    result->diff = ReadU32(buffer, offset);
+    result->year = ReadU16(buffer, offset);
+    result->name = ReadString(buffer, size, offset);
+    result->nation = ReadString(buffer, size, offset);
+    result->fispoints = ReadString(buffer, size, offset);
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Decodes the header of the packed ranks of a race (see "DB_PACKED_COLUMNS" in Database.h)
+ * A race whose ranks do not fit in the section is read as a race without ranks
+ *
+ * first: The offset of the packed ranks of the race in the packed ranks section
+ * count: The number of ranks
+ *
+ * Returns 0
+ * --------------------------------------------------------------------------------------------------
+ */
+static int DecodePackedRanks(const DatabaseFile* file, unsigned int first, unsigned int count, RaceResultsRecord* race_results)
+{
+    const DatabaseSection* ranks = &(file->layout.sections[1]);
+    race_results->packed = true;
+    race_results->results_size = 0;
+    race_results->results = file->buffer;
+    race_results->results_bytes = 0;
+    race_results->entrants = file->layout.sections[2].data;
+    race_results->entrants_size = file->layout.sections[2].rows;
+    race_results->strings = file->layout.sections[3].data;
+    race_results->strings_size = file->layout.sections[3].size;
+    race_results->first_time = 0;
+    race_results->row_bits = 0;
+    memset(race_results->columns, 0, sizeof(race_results->columns));
+    if (first >= (unsigned int) ranks->size) {
+        return 0;
+    }
+
+    int offset = (int) first;
+    unsigned long long first_time = 0;
+    if (ReadVarint(ranks->data, ranks->size, &offset, &first_time) == -1) {
+        return 0;
+    }
+    int row_bits = 0;
+    PackedColumn columns[DB_PACKED_COLUMNS];
+    for (int c = 0; c < DB_PACKED_COLUMNS; c++)
+    {
+        if (ReadVarint(ranks->data, ranks->size, &offset, &(columns[c].min)) == -1 || offset >= ranks->size) {
+            return 0;
+        }
+        columns[c].bits = (unsigned char) ranks->data[offset++];
+        columns[c].shift = row_bits;
+        if (columns[c].bits > DB_PACKED_MAX_BITS) {
+            return 0;
+        }
+        row_bits += columns[c].bits;
+    }
+
+    // Every column is read with a 64-bit load, so the padding after the last rank has to be in the section
+    long long bytes = ((long long) count * row_bits + 7) / 8;
+    if (bytes + DB_PACKED_PADDING > ranks->size - offset) {
+        return 0;
+    }
+    race_results->results_size = (int) count;
+    race_results->results = &(ranks->data[offset]);
+    race_results->results_bytes = (int) bytes;
+    race_results->first_time = (unsigned int) first_time;
+    race_results->row_bits = row_bits;
+    memcpy(race_results->columns, columns, sizeof(columns));
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Decodes the packed rank at position i of a race. The position has to be less than the number of ranks
+ * An entrant that is not in the entrants table is read as an athlete without fiscode and name
+ * --------------------------------------------------------------------------------------------------
+ */
+static void DecodePackedResult(const RaceResultsRecord* race, int i, ResultRecord* result)
+{
+    unsigned long long rank = GetPackedColumn(race, i, 0);
+    unsigned long long entrant = GetPackedColumn(race, i, 2);
+    result->rank = (rank == 0) ? 0 : (unsigned int) ((long long) i + 1 - Unzigzag(rank - 1));
+    result->bib = (unsigned int) GetPackedColumn(race, i, 1);
+    result->diff = (unsigned int) GetPackedColumn(race, i, 3);
+    result->time = (unsigned int) ((long long) race->first_time + result->diff + Unzigzag(GetPackedColumn(race, i, 4)));
+    result->fispoints = GetString(race->strings, race->strings_size, (unsigned int) GetPackedColumn(race, i, 5));
+
+    if (entrant < (unsigned long long) race->entrants_size) {
+        const char* row = &(race->entrants[entrant * DB_ROW_ENTRANT]);
+        result->fiscode = GetColumn(row, 0);
+        result->year = GetColumn(row, 1);
+        result->name = GetString(race->strings, race->strings_size, GetColumn(row, 2));
+        result->nation = GetString(race->strings, race->strings_size, GetColumn(row, 3));
+    } else {
+        result->fiscode = 0;
+        result->year = 0;
+        result->name = "";
+        result->nation = "";
+    }
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads a column of the packed rank at position i of a race, with one 64-bit load
+ * A column has at most DB_PACKED_MAX_BITS bits, so it always fits in the load after it is shifted to its first bit
+ * --------------------------------------------------------------------------------------------------
+ */
+static unsigned long long GetPackedColumn(const RaceResultsRecord* race, int i, int column)
+{
+    const PackedColumn* packed = &(race->columns[column]);
+    if (packed->bits == 0) {
+        return packed->min;
+    }
+    unsigned long long bit = (unsigned long long) i * race->row_bits + packed->shift;
+    const unsigned char* bytes = (const unsigned char*) &(race->results[bit / 8]);
+    unsigned long long word = 0;
+    for (int b = 0; b < 8; b++) {
+        word |= (unsigned long long) bytes[b] << (b * 8);
+    }
+    return packed->min + ((word >> (bit % 8)) & ((1ULL << packed->bits) - 1));
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads the key of the record at the offset while the index of a database file is built, and moves the offset to the next record
+ * The count is the number of races of an athlete, or the number of ranks of a race that are stored before the end of the file
+ * Returns 0 on success, and -1 at the end of the file
+ * --------------------------------------------------------------------------------------------------
+ */
+static int ScanAthlete(const void* file, int* offset, unsigned int* key, unsigned int* count)
+{
+    AthleteRecord athlete;
+    if (DecodeAthlete((const DatabaseFile*) file, offset, &athlete) != 0) {
+        return -1;
+    }
+    *key = athlete.fiscode;
+    *count = 0;
+    return 0;
+}
+
+static int ScanRaceIds(const void* file, int* offset, unsigned int* key, unsigned int* count)
+{
+    RaceIdsRecord race_ids;
+    if (DecodeRaceIds((const DatabaseFile*) file, offset, &race_ids) != 0) {
+        return -1;
+    }
+    *key = race_ids.fiscode;
+    *count = (unsigned int) race_ids.raceids_size;
+    return 0;
+}
+
+static int ScanRaceInfo(const void* file, int* offset, unsigned int* key, unsigned int* count)
+{
+    RaceInfoRecord race_info;
+    if (DecodeRaceInfo((const DatabaseFile*) file, offset, &race_info) != 0) {
+        return -1;
+    }
+    *key = race_info.raceid;
+    *count = 0;
+    return 0;
+}
+
+static int ScanRaceResults(const void* file, int* offset, unsigned int* key, unsigned int* count)
+{
+    RaceResultsRecord race_results;
+    if (DecodeRaceResults((const DatabaseFile*) file, offset, &race_results) != 0) {
+        return -1;
+    }
+    *key = race_results.raceid;
+    *count = (unsigned int) race_results.results_size;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets the row at the offset in a table of a file in the v2 format, and moves the offset to the next row
+ * The offset is where the row starts in the file, and offset 0 is the first row of the table
+ * Returns 0 if there is no row at the offset
+ * --------------------------------------------------------------------------------------------------
+ */
+static const char* NextRow(const DatabaseFile* file, int section, int* offset)
+{
+    const DatabaseSection* table = &(file->layout.sections[section]);
+    int start = (int) (table->data - file->buffer);
+    if (*offset == 0) {
+        *offset = start;
+    }
+
+    int position = *offset - start;
+    if (position < 0 || position % table->row_size != 0 || position + table->row_size > table->size) {
+        return 0;
+    }
+    *offset += table->row_size;
+    return &(table->data[position]);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets the number of rows in a list of rows in a table of a file in the v2 format
+ * A list that goes past the end of the table is cut off
+ * --------------------------------------------------------------------------------------------------
+ */
+static int GetListSize(const DatabaseFile* file, int section, unsigned int first, unsigned int count)
+{
+    unsigned int rows = (unsigned int) file->layout.sections[section].rows;
+    if (first >= rows) {
+        return 0;
+    }
+    return (int) ((count < rows - first) ? count : rows - first);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads a column of a row in the v2 format, and gets a string from a string heap
+ * The heap always ends with a terminated string, so a string that starts inside the heap ends inside it.
+ * A string that starts outside of the heap is read as an empty string
+ * --------------------------------------------------------------------------------------------------
+ */
+static unsigned int GetColumn(const char* row, int column)
+{
+    int offset = column * 4;
+    return ReadU32(row, &offset);
+}
+
+static const char* GetString(const char* heap, int heap_size, unsigned int offset)
+{
+    return (offset < (unsigned int) heap_size) ? &(heap[offset]) : "";
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads a dictionary code from a column. A code that is not in the dictionary is read as the empty string (code 0)
+ * --------------------------------------------------------------------------------------------------
+ */
+static DictionaryCode GetCode(unsigned int code)
+{
+    return (code < (unsigned int) Database_GetDictionarySize()) ? (DictionaryCode) code : 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads little-endian integers from the buffer, and moves the offset past them
+ * The caller has to make sure that the bytes can be read
+ * --------------------------------------------------------------------------------------------------
+ */
+static unsigned int ReadU32(const char* buffer, int* offset)
+{
+    const unsigned char* bytes = (const unsigned char*) &(buffer[*offset]);
+    *offset += 4;
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int) bytes[3] << 24);
+}
+
+static unsigned int ReadU16(const char* buffer, int* offset)
+{
+    const unsigned char* bytes = (const unsigned char*) &(buffer[*offset]);
+    *offset += 2;
+    return bytes[0] | (bytes[1] << 8);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads an unsigned integer in 7 bits per byte, where the highest bit is set in every byte but the last, and moves the offset past it
+ * Returns 0 on success, and -1 if the integer does not end before the end of the buffer, or is longer than 64 bits
+ * --------------------------------------------------------------------------------------------------
+ */
+static int ReadVarint(const char* buffer, int size, int* offset, unsigned long long* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && *offset < size; shift += 7)
+    {
+        unsigned char byte = (unsigned char) buffer[(*offset)++];
+        *value |= (unsigned long long) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static long long Unzigzag(unsigned long long value)
+{
+    return (long long) (value >> 1) ^ -(long long) (value & 1);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets the null-terminated string at the offset, and moves the offset past it
+ * The files are mapped directly, so nothing can be read after the last byte of the file.
+ * A string that is not terminated before the end of the file, or starts after it, is read as an empty string
+ * --------------------------------------------------------------------------------------------------
+ */
+static const char* ReadString(const char* buffer, int size, int* offset)
+{
+    if (*offset >= size) {
+        return "";
+    }
+    const char* str = &(buffer[*offset]);
+    int length = strnlen(str, size - *offset);
+    *offset += length + 1;
+    return (*offset <= size) ? str : "";
+}
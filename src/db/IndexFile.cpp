@@ -0,0 +1,402 @@
+#include "Database.h"
+
+#include "../libs/Restart.h"
+#include "../util/Log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define INDEX_FILE_MAGIC "XCIX"
+#define INDEX_FILE_VERSION 3
+#define INDEX_FILE_HEADER_SIZE 32  // Magic (4 bytes), version (4 bytes), number of entries (4 bytes), and the size (4 bytes),
+                                   // inode (8 bytes) and modification time in nanoseconds (8 bytes) of the indexed file
+#define INDEX_ENTRY_SIZE 12        // Key (4 bytes), the offset of the record (4 bytes), and the number of races or ranks of the record (4 bytes)
+#define INDEX_PATH_MAX_SIZE 256
+#define FILTER_BITS_PER_KEY 16  // About 1 in 1000 keys that are not in the file passes the filter
+#define FILTER_BLOCK_WORDS 8
+
+typedef struct {
+    unsigned int key;
+    unsigned int offset;
+    unsigned int count;
+} IndexEntry;
+
+static int ReadIndexFile(const char* index_path, const struct stat* data_info, KeyIndex* index);
+static int BuildIndex(const struct stat* data_info, RecordScanner scanner, const void* file, KeyIndex* index);
+static void WriteIndexFile(const char* index_path, const KeyIndex* index);
+static int CompareEntries(const void* a, const void* b);
+static bool IsSorted(const KeyIndex* index);
+static int BuildFilter(KeyIndex* index);
+static void GetFilterBits(const KeyIndex* index, unsigned int key, unsigned int* block, unsigned int* bits);
+static unsigned int GetU32(const unsigned char* bytes);
+static void PutU32(unsigned char* bytes, unsigned int value);
+static unsigned long long GetU64(const unsigned char* bytes);
+static void PutU64(unsigned char* bytes, unsigned long long value);
+static long GetModified(const struct stat* info);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Loads the index of a database file, that maps the key of every record (fiscode or raceid) to where the record starts,
+ * and to the number of races or ranks of the record
+ * The index is stored next to the database file, with ".idx" added to the name. If that file is missing, or was written
+ * for another version of the database file, the index is built by scanning the database file and is then written to the
+ * index file, so that the next start of the server can map it directly. If it can not be written, the index is only kept in memory.
+ *
+ * path: The path to the database file
+ * size: The size of the database file
+ * scanner: Reads the key and count of the record at an offset in the database file, and moves the offset to the next record.
+ *          The first record is read at offset 0
+ * file: The loaded database file, that is passed to the scanner
+ * index: Set to the loaded index
+ *
+ * Returns 0 on success
+ * Returns -1 on failure. An error message will be printed to describe the error
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_LoadKeyIndex(const char* path, int size, RecordScanner scanner, const void* file, KeyIndex* index)
+{
+    char index_path[INDEX_PATH_MAX_SIZE];
+    if (snprintf(index_path, sizeof(index_path), "%s.idx", path) >= (int) sizeof(index_path)) {
+        fprintf(stderr, "[%ld] Failed to load the index of %s: The path is too long\n", GetLogId(), path);
+        return -1;
+    }
+
+    struct stat data_info;
+    if (stat(path, &data_info) != 0 || (int) data_info.st_size != size || ReadIndexFile(index_path, &data_info, index) != 0)
+    {
+        data_info.st_size = size;
+        if (BuildIndex(&data_info, scanner, file, index) == -1) {
+            fprintf(stderr, "[%ld] Failed to build the index of %s: Failed to allocate memory\n", GetLogId(), path);
+            return -1;
+        }
+        WriteIndexFile(index_path, index);
+    }
+
+    // The filter is only used to reject keys faster, so the keys are still found without it
+    if (BuildFilter(index) == -1) {
+        fprintf(stderr, "[%ld] Failed to build the filter of the index of %s: Failed to allocate memory\n", GetLogId(), path);
+    }
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Binary searches the index for the first record with the given key, if the key passes the filter of the index
+ *
+ * Returns 0 on success, and sets "offset" to where the record starts in the database file, and "count" to the number of races or ranks
+ * Returns -2 if the key could not be found
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_FindKey(const KeyIndex* index, unsigned int key, int* offset, int* count)
+{
+    // Most keys that are not in the file are rejected by the filter, with one cache line read instead of a binary search
+    if (index->filter != 0)
+    {
+        unsigned int block = 0;
+        unsigned int bits[FILTER_BLOCK_WORDS];
+        GetFilterBits(index, key, &block, bits);
+        const unsigned int* words = &(index->filter[block * FILTER_BLOCK_WORDS]);
+        for (int i = 0; i < FILTER_BLOCK_WORDS; i++) {
+            if ((words[i] & bits[i]) == 0) {
+                return -2;
+            }
+        }
+    }
+
+    int low = 0;
+    int high = index->size;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (GetU32(&(index->entries[middle * INDEX_ENTRY_SIZE])) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low < index->size && GetU32(&(index->entries[low * INDEX_ENTRY_SIZE])) == key) {
+        *offset = (int) GetU32(&(index->entries[low * INDEX_ENTRY_SIZE + 4]));
+        *count = (int) GetU32(&(index->entries[low * INDEX_ENTRY_SIZE + 8]));
+        return 0;
+    }
+    return -2;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Unmaps or frees an index that has been loaded, once no lookups are made in it anymore
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_UnloadKeyIndex(KeyIndex* index)
+{
+    if (index->entries != 0)
+    {
+        unsigned char* file = (unsigned char*) index->entries - INDEX_FILE_HEADER_SIZE;
+        if (index->mapped) {
+            Database_UnmapFile((char*) file, INDEX_FILE_HEADER_SIZE + index->size * INDEX_ENTRY_SIZE);
+        } else {
+            free(file);
+        }
+    }
+    free(index->filter);
+    index->entries = 0;
+    index->size = 0;
+    index->mapped = false;
+    index->filter = 0;
+    index->filter_blocks = 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Maps the index file, if it exists and belongs to the current version of the database file
+ * The index stores the inode, size and modification time of the database file it was built from. Comparing the times of the
+ * two files is not enough, since a copy that keeps the times of an older file ("cp -p", "rsync -t", "tar x") would reuse the index
+ * Returns 0 on success, and -1 if the index has to be built again
+ * --------------------------------------------------------------------------------------------------
+ */
+static int ReadIndexFile(const char* index_path, const struct stat* data_info, KeyIndex* index)
+{
+    struct stat index_info;
+    if (stat(index_path, &index_info) == -1 || index_info.st_size < INDEX_FILE_HEADER_SIZE) {
+        return -1;
+    }
+
+    char* file = 0;
+    int file_size = 0;
+    if (Database_MapFile(index_path, DB_ADVICE_WILLNEED, &file, &file_size) < 0) {
+        return -1;
+    }
+
+    const unsigned char* header = (const unsigned char*) file;
+    int count = (int) GetU32(&(header[8]));
+    bool valid = file_size >= INDEX_FILE_HEADER_SIZE &&
+                 memcmp(header, INDEX_FILE_MAGIC, 4) == 0 &&
+                 GetU32(&(header[4])) == INDEX_FILE_VERSION &&
+                 count >= 0 && (long) file_size == INDEX_FILE_HEADER_SIZE + (long) count * INDEX_ENTRY_SIZE &&
+                 GetU32(&(header[12])) == (unsigned int) data_info->st_size &&
+                 GetU64(&(header[16])) == (unsigned long long) data_info->st_ino &&
+                 GetU64(&(header[24])) == (unsigned long long) GetModified(data_info);
+
+    index->entries = &(header[INDEX_FILE_HEADER_SIZE]);
+    index->size = valid ? count : 0;
+    if (!valid || !IsSorted(index)) {
+        Database_UnmapFile(file, file_size);
+        index->entries = 0;
+        index->size = 0;
+        return -1;
+    }
+    index->mapped = true;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Builds the index by scanning all records in the database file
+ * The index is built in the same format as the index file, so it can be written to the file as it is
+ * data_info: The size, inode and modification time of the database file, that are stored in the header
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int BuildIndex(const struct stat* data_info, RecordScanner scanner, const void* file, KeyIndex* index)
+{
+    int size = (int) data_info->st_size;
+    // Every record is at least 6 bytes, so this is always enough entries
+    int capacity = size / 6 + 1;
+    IndexEntry* entries = (IndexEntry*) malloc(capacity * sizeof(IndexEntry));
+    if (entries == 0) {
+        return -1;
+    }
+
+    int count = 0;
+    int offset = 0;
+    while (count < capacity)
+    {
+        int record_offset = offset;
+        unsigned int key = 0;
+        unsigned int record_count = 0;
+        if (scanner(file, &offset, &key, &record_count) != 0) {
+            break;
+        }
+        entries[count].key = key;
+        entries[count].offset = (unsigned int) record_offset;
+        entries[count].count = record_count;
+        count++;
+    }
+
+    // Records with the same key stays in the same order as in the file, so the first one is always found
+    qsort(entries, count, sizeof(IndexEntry), CompareEntries);
+
+    unsigned char* index_file = (unsigned char*) malloc(INDEX_FILE_HEADER_SIZE + count * INDEX_ENTRY_SIZE);
+    if (index_file == 0) {
+        free(entries);
+        return -1;
+    }
+    memcpy(index_file, INDEX_FILE_MAGIC, 4);
+    PutU32(&(index_file[4]), INDEX_FILE_VERSION);
+    PutU32(&(index_file[8]), (unsigned int) count);
+    PutU32(&(index_file[12]), (unsigned int) size);
+    PutU64(&(index_file[16]), (unsigned long long) data_info->st_ino);
+    PutU64(&(index_file[24]), (unsigned long long) GetModified(data_info));
+    for (int i = 0; i < count; i++) {
+        PutU32(&(index_file[INDEX_FILE_HEADER_SIZE + i * INDEX_ENTRY_SIZE]), entries[i].key);
+        PutU32(&(index_file[INDEX_FILE_HEADER_SIZE + i * INDEX_ENTRY_SIZE + 4]), entries[i].offset);
+        PutU32(&(index_file[INDEX_FILE_HEADER_SIZE + i * INDEX_ENTRY_SIZE + 8]), entries[i].count);
+    }
+    free(entries);
+
+    index->entries = &(index_file[INDEX_FILE_HEADER_SIZE]);
+    index->size = count;
+    index->mapped = false;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Writes the index to the index file, so it does not have to be built again the next time
+ * The file is written to a temporary file first, and then renamed, so a partly written index file is never read.
+ * Failing to write it is not an error, since the index is still kept in memory
+ * --------------------------------------------------------------------------------------------------
+ */
+static void WriteIndexFile(const char* index_path, const KeyIndex* index)
+{
+    char temp_path[INDEX_PATH_MAX_SIZE + 16];
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld", index_path, (long) getpid());
+
+    int fd;
+    if ((fd = r_open3(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+        fprintf(stderr, "[%ld] Could not write the index file %s: %s\n", GetLogId(), index_path, strerror(errno));
+        return;
+    }
+
+    const unsigned char* file = index->entries - INDEX_FILE_HEADER_SIZE;
+    int file_size = INDEX_FILE_HEADER_SIZE + index->size * INDEX_ENTRY_SIZE;
+    bool written = (r_write(fd, (void*) file, file_size) == file_size);
+    if (r_close(fd) == -1) {
+        written = false;
+    }
+
+    if (!written || rename(temp_path, index_path) == -1) {
+        fprintf(stderr, "[%ld] Could not write the index file %s: %s\n", GetLogId(), index_path, strerror(errno));
+        unlink(temp_path);
+    }
+}
+
+
+static int CompareEntries(const void* a, const void* b)
+{
+    const IndexEntry* entry_a = (const IndexEntry*) a;
+    const IndexEntry* entry_b = (const IndexEntry*) b;
+    if (entry_a->key != entry_b->key) {
+        return (entry_a->key < entry_b->key) ? -1 : 1;
+    }
+    if (entry_a->offset != entry_b->offset) {
+        return (entry_a->offset < entry_b->offset) ? -1 : 1;
+    }
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Checks that the entries of an index file are sorted, since a binary search would silently fail otherwise
+ * --------------------------------------------------------------------------------------------------
+ */
+static bool IsSorted(const KeyIndex* index)
+{
+    for (int i = 1; i < index->size; i++) {
+        if (GetU32(&(index->entries[(i - 1) * INDEX_ENTRY_SIZE])) > GetU32(&(index->entries[i * INDEX_ENTRY_SIZE]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Builds the Bloom filter of the keys of an index. The filter is split into blocks of 8 words, and every key sets
+ * one bit in every word of one block, so a key is checked by reading a single cache line
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int BuildFilter(KeyIndex* index)
+{
+    unsigned int blocks = (unsigned int) (((long) index->size * FILTER_BITS_PER_KEY) / (FILTER_BLOCK_WORDS * 32)) + 1;
+    unsigned int* filter = (unsigned int*) calloc((size_t) blocks * FILTER_BLOCK_WORDS, sizeof(unsigned int));
+    if (filter == 0) {
+        return -1;
+    }
+    index->filter = filter;
+    index->filter_blocks = blocks;
+
+    for (int i = 0; i < index->size; i++)
+    {
+        unsigned int block = 0;
+        unsigned int bits[FILTER_BLOCK_WORDS];
+        GetFilterBits(index, GetU32(&(index->entries[i * INDEX_ENTRY_SIZE])), &block, bits);
+        for (int w = 0; w < FILTER_BLOCK_WORDS; w++) {
+            filter[block * FILTER_BLOCK_WORDS + w] |= bits[w];
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets the block of a key in the filter, and the bit of the key in every word of the block
+ * The key is hashed to 64 bits. The high half picks the block, and the low half is multiplied with a different odd constant
+ * for every word, where the top 5 bits of the product pick the bit
+ * --------------------------------------------------------------------------------------------------
+ */
+static void GetFilterBits(const KeyIndex* index, unsigned int key, unsigned int* block, unsigned int* bits)
+{
+    static const unsigned int salts[FILTER_BLOCK_WORDS] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+    };
+    unsigned long long hash = ((unsigned long long) key + 0x9E3779B97F4A7C15ULL) * 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 31;
+    *block = (unsigned int) (((hash >> 32) * index->filter_blocks) >> 32);
+    unsigned int low = (unsigned int) hash;
+    for (int i = 0; i < FILTER_BLOCK_WORDS; i++) {
+        bits[i] = 1U << ((low * salts[i]) >> 27);
+    }
+}
+
+
+static unsigned int GetU32(const unsigned char* bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int) bytes[3] << 24);
+}
+
+static void PutU32(unsigned char* bytes, unsigned int value)
+{
+    bytes[0] = value & 0xFF;
+    bytes[1] = (value >> 8) & 0xFF;
+    bytes[2] = (value >> 16) & 0xFF;
+    bytes[3] = (value >> 24) & 0xFF;
+}
+
+static unsigned long long GetU64(const unsigned char* bytes)
+{
+    return GetU32(bytes) | ((unsigned long long) GetU32(&(bytes[4])) << 32);
+}
+
+static void PutU64(unsigned char* bytes, unsigned long long value)
+{
+    PutU32(bytes, (unsigned int) value);
+    PutU32(&(bytes[4]), (unsigned int) (value >> 32));
+}
+
+static long GetModified(const struct stat* info)
+{
+    return (long) info->st_mtim.tv_sec * 1000000000L + info->st_mtim.tv_nsec;
+}
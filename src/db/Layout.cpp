@@ -0,0 +1,116 @@
+#include "Database.h"
+
+#include "../util/Log.h"
+#include <stdio.h>
+#include <string.h>
+
+#define HEAP 1  // The row size of a string heap
+
+typedef struct {
+    int type;
+    int version;  // The first version with these sections. A file type keeps its sections in later versions, until it is listed again
+    int sections_size;
+    int row_sizes[DB_MAX_SECTIONS];
+} FileType;
+
+static const FileType file_types[] = {
+    { DB_TYPE_ATHLETES, 2, 2, { DB_ROW_ATHLETE, HEAP } },
+    { DB_TYPE_ATHLETE_RACES, 2, 2, { DB_ROW_LIST, DB_ROW_RACEID } },
+    { DB_TYPE_ATHLETE_RACES, 4, 4, { DB_ROW_LIST, DB_ROW_RACEID, DB_ROW_ATHLETE_RESULT, HEAP } },
+    { DB_TYPE_RACE_INFO, 2, 2, { DB_ROW_RACE_INFO, HEAP } },
+    { DB_TYPE_RACE_INFO, 3, 3, { DB_ROW_RACE_INFO, DB_ROW_DICTIONARY, HEAP } },
+    { DB_TYPE_RACE_RESULTS, 2, 3, { DB_ROW_LIST, DB_ROW_RANK, HEAP } },
+    { DB_TYPE_RACE_RESULTS, 5, 4, { DB_ROW_LIST, HEAP, DB_ROW_ENTRANT, HEAP } },  // The packed ranks end with zero bytes, like a heap
+};
+
+static unsigned int GetU32(const char* bytes);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads the header and the section table of a database file, and checks that every section is inside the file
+ * and has the expected row size. Since the checksum version, the checksum of every section is checked as well.
+ * Files that do not start with the v2 header are in the old format
+ *
+ * path: The path to the database file, used in the error messages
+ * buffer: The mapped content of the database file
+ * size: The size of the database file
+ * type: The expected file type, one of the DB_TYPE_* values
+ * layout: Set to the version and the sections of the file. The version is set to 1 if the file is in the old format
+ *
+ * Returns 0 on success
+ * Returns -1 if the file has the v2 header but is invalid or corrupt. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_ReadLayout(const char* path, const char* buffer, int size, int type, DatabaseLayout* layout)
+{
+    layout->version = 1;
+    layout->sections_size = 0;
+    if (size < DB_FORMAT_HEADER_SIZE || memcmp(buffer, DB_FORMAT_MAGIC, 4) != 0) {
+        return 0;
+    }
+
+    unsigned int version = GetU32(&(buffer[4]));
+    if (version < DB_FORMAT_MIN_VERSION || version > DB_FORMAT_VERSION) {
+        fprintf(stderr, "[%ld] Failed to read %s: Unsupported version: %u\n", GetLogId(), path, version);
+        return -1;
+    }
+
+    const FileType* file_type = 0;
+    for (int i = 0; i < (int) (sizeof(file_types) / sizeof(file_types[0])); i++) {
+        if (file_types[i].type == type && (unsigned int) file_types[i].version <= version) {
+            file_type = &(file_types[i]);
+        }
+    }
+    if (file_type == 0 || GetU32(&(buffer[8])) != (unsigned int) type) {
+        fprintf(stderr, "[%ld] Failed to read %s: The file has the wrong file type\n", GetLogId(), path);
+        return -1;
+    }
+    int entry_size = (version >= DB_FORMAT_CHECKSUM_VERSION) ? DB_SECTION_ENTRY_SIZE : DB_SECTION_ENTRY_SIZE_V2;
+    if (GetU32(&(buffer[12])) != (unsigned int) file_type->sections_size ||
+        DB_FORMAT_HEADER_SIZE + file_type->sections_size * entry_size > size) {
+        fprintf(stderr, "[%ld] Failed to read %s: The section table is invalid\n", GetLogId(), path);
+        return -1;
+    }
+
+    for (int i = 0; i < file_type->sections_size; i++)
+    {
+        const char* entry = &(buffer[DB_FORMAT_HEADER_SIZE + i * entry_size]);
+        unsigned int offset = GetU32(&(entry[0]));
+        unsigned int section_size = GetU32(&(entry[4]));
+        unsigned int rows = GetU32(&(entry[8]));
+        unsigned int row_size = GetU32(&(entry[12]));
+
+        bool valid = offset <= (unsigned int) size && section_size <= (unsigned int) size - offset &&
+                     row_size == (unsigned int) file_type->row_sizes[i] &&
+                     (unsigned long) rows * row_size == section_size;
+        // The last string in a heap has to be terminated, so that no string can be read past the end of the heap
+        if (valid && row_size == HEAP && section_size > 0 && buffer[offset + section_size - 1] != '\0') {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "[%ld] Failed to read %s: Section %d is invalid\n", GetLogId(), path, i);
+            return -1;
+        }
+        // A section that was changed or cut off after it was written is never read, instead of reading only a part of it
+        if (version >= DB_FORMAT_CHECKSUM_VERSION && Database_Crc32c(&(buffer[offset]), (int) section_size) != GetU32(&(entry[16]))) {
+            fprintf(stderr, "[%ld] Failed to read %s: Section %d is corrupt, the checksum does not match\n", GetLogId(), path, i);
+            return -1;
+        }
+
+        layout->sections[i].data = &(buffer[offset]);
+        layout->sections[i].size = (int) section_size;
+        layout->sections[i].rows = (int) rows;
+        layout->sections[i].row_size = (int) row_size;
+    }
+    layout->version = (int) version;
+    layout->sections_size = file_type->sections_size;
+    return 0;
+}
+
+
+static unsigned int GetU32(const char* bytes)
+{
+    const unsigned char* b = (const unsigned char*) bytes;
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int) b[3] << 24);
+}
@@ -0,0 +1,110 @@
+#include "Database.h"
+
+#include "../libs/Restart.h"
+#include "../util/Log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static char empty_file[1] = { '\0' };  // Used for empty files, since a mapping can not be empty
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Maps a database file into memory, read-only
+ * No bytes are copied. The pages are read from the page cache when they are first used,
+ * and are shared by all processes that have the file mapped
+ *
+ * path: The path to the database file
+ * advice: How the file is about to be read. Either DB_ADVICE_SEQUENTIAL or DB_ADVICE_WILLNEED
+ * buffer: Set to the mapped content of the file. Must not be modified
+ * size: Set to the size of the file
+ *
+ * Returns 0 on success
+ * Returns -1 on internal errors
+ * Returns -2 if the file could not be opened
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_MapFile(const char* path, int advice, char** buffer, int* size)
+{
+    int fd;
+    if ((fd = r_open2(path, O_RDONLY)) == -1) {
+        fprintf(stderr, "[%ld] Failed to open %s: %s\n", GetLogId(), path, strerror(errno));
+        return -2;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        fprintf(stderr, "[%ld] Failed to get the size of %s: %s\n", GetLogId(), path, strerror(errno));
+        r_close(fd);
+        return -1;
+    }
+
+    if (info.st_size == 0) {
+        r_close(fd);
+        *buffer = empty_file;
+        *size = 0;
+        return 0;
+    }
+
+    void* mapping = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "[%ld] Failed to map %s: %s\n", GetLogId(), path, strerror(errno));
+        r_close(fd);
+        return -1;
+    }
+
+    // The mapping stays valid after the file is closed
+    if (r_close(fd) == -1) {
+        fprintf(stderr, "[%ld] Failed to close: %s: %s\n", GetLogId(), path, strerror(errno));
+    }
+
+    *buffer = (char*) mapping;
+    *size = (int) info.st_size;
+    Database_AdviseFile(*buffer, *size, advice);
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Tells the kernel how a mapped database file is about to be read, so it can read ahead or keep the right pages
+ * DB_ADVICE_SEQUENTIAL: The file is scanned once from start to end. Pages are read ahead, and can be dropped after being read
+ * DB_ADVICE_WILLNEED: The file is looked up in at random from now on, so all of it is read in and kept in memory
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_AdviseFile(char* buffer, int size, int advice)
+{
+    if (buffer == empty_file || size <= 0) {
+        return;
+    }
+    // The sequential advice is kept until it is replaced, so it has to be reset before the file is read at random
+    int result = 0;
+    if (advice == DB_ADVICE_SEQUENTIAL) {
+        result = madvise(buffer, size, MADV_SEQUENTIAL);
+    } else {
+        result = madvise(buffer, size, MADV_NORMAL);
+        if (result == 0) {
+            result = madvise(buffer, size, MADV_WILLNEED);
+        }
+    }
+    if (result == -1) {
+        fprintf(stderr, "[%ld] Warning: madvise failed on a database file: %s\n", GetLogId(), strerror(errno));
+    }
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Releases a file that was mapped with "Database_MapFile"
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_UnmapFile(char* buffer, int size)
+{
+    if (buffer == 0 || buffer == empty_file || size <= 0) {
+        return;
+    }
+    munmap(buffer, size);
+}
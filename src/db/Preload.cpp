@@ -0,0 +1,184 @@
+#include "Database.h"
+
+#include "../util/Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static int LoadSnapshot(DatabaseSnapshot* snapshot);
+static bool HasChanged(const DatabaseSnapshot* snapshot);
+static void GetFileVersion(const char* path, unsigned long* inode, long* modified);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Maps all database files into memory, and parses them into the indexed records that all lookups are made in
+ * The files are mapped read-only, so the pages are shared with the page cache instead of being copied into every process
+ * This should be called once at startup, before any threads or worker processes are started,
+ * so that the records are shared by all of them instead of being parsed again for every request.
+ * Lookups in files that fail to load will fail as well. The delta is loaded as well if it exists,
+ * while the delta is locked so that a writer can not replace it halfway through.
+ * The loaded files become the current snapshot. Files that are replaced later are loaded with "Database_Reload"
+ *
+ * Returns 0 if all files were loaded, and -1 if any file failed to load
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_Preload()
+{
+    DatabaseSnapshot* snapshot = Database_NewSnapshot();
+    if (snapshot == 0) {
+        return -1;
+    }
+    int result = LoadSnapshot(snapshot);
+    Database_SwapSnapshot(snapshot);
+    return result;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Loads the database files and the delta again if any of them have been replaced, and swaps the new snapshot in
+ * for the requests that start after that. Requests that are running keep reading from the snapshot they started with.
+ * The new files are only used if all of them could be loaded, so a database that is broken, or has only been replaced
+ * halfway, never replaces the database that is used. The files have to be replaced by renaming new files over them,
+ * as "dbcompile" does, since the files that are mapped must never change
+ *
+ * Returns 0 if the new snapshot was swapped in
+ * Returns -1 if the new files could not be loaded, and the old snapshot is still used. An error message will be printed
+ * Returns -2 if no file has been replaced since the current snapshot was loaded
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_Reload()
+{
+    if (!HasChanged(Database_GetSnapshot())) {
+        return -2;
+    }
+
+    DatabaseSnapshot* snapshot = Database_NewSnapshot();
+    if (snapshot == 0) {
+        return -1;
+    }
+    if (LoadSnapshot(snapshot) == -1) {
+        fprintf(stderr, "[%ld] Failed to reload the database: The database that was loaded before is still used\n", GetLogId());
+        Database_FreeSnapshot(snapshot);
+        return -1;
+    }
+    Database_SwapSnapshot(snapshot);
+    fprintf(stderr, "[%ld] Reloaded the database\n", GetLogId());
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets the shared in-memory copy of a database file, if it has been preloaded
+ * The buffer is shared and must not be modified or freed
+ *
+ * path: The path to the database file
+ * buffer: Set to the content of the file
+ * size: Set to the size of the file
+ *
+ * Returns 0 on success
+ * Returns -2 if the file has not been preloaded
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_GetPreloadedFile(const char* path, char** buffer, int* size)
+{
+    DatabaseSnapshot* snapshot = Database_GetSnapshot();
+    for (int i = 0; i < DB_FILE_COUNT; i++)
+    {
+        const DatabaseFile* file = &(snapshot->files[i]);
+        if (file->buffer != 0 && strcmp(file->path, path) == 0) {
+            *buffer = file->buffer;
+            if (size) {
+                *size = file->size;
+            }
+            return 0;
+        }
+    }
+    return -2;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Maps and indexes all files of a snapshot. The files of the delta are skipped if they do not exist
+ * Returns 0 if all files were loaded, and -1 if any file failed to load
+ * --------------------------------------------------------------------------------------------------
+ */
+static int LoadSnapshot(DatabaseSnapshot* snapshot)
+{
+    // A writer that loads the database already holds the lock
+    bool locked = (Database_LockDelta(DB_LOCK_SHARED) == 0);
+
+    // The snapshot is pinned while it is loaded, so that the files and the dictionary are loaded into it
+    Database_PinSnapshot(snapshot);
+    int result = 0;
+    for (int i = 0; i < DB_FILE_COUNT; i++)
+    {
+        // The version is read before the file is mapped, so a file that is replaced in between is loaded again the next time
+        DatabaseFile* file = &(snapshot->files[i]);
+        GetFileVersion(file->path, &(file->inode), &(file->modified));
+        if (file->delta && file->inode == 0) {
+            continue;
+        }
+        if (Database_MapFile(file->path, DB_ADVICE_SEQUENTIAL, &(file->buffer), &(file->size)) < 0) {
+            fprintf(stderr, "[%ld] Failed to preload database file: %s\n", GetLogId(), file->path);
+            file->buffer = 0;
+            file->size = 0;
+            result = -1;
+        }
+    }
+
+    // The files are only scanned once while they are indexed. After that the records are looked up at random
+    if (Database_BuildIndexes() == -1) {
+        result = -1;
+    }
+    Database_PinSnapshot(0);
+    if (locked) {
+        Database_UnlockDelta();
+    }
+    for (int i = 0; i < DB_FILE_COUNT; i++) {
+        Database_AdviseFile(snapshot->files[i].buffer, snapshot->files[i].size, DB_ADVICE_WILLNEED);
+    }
+    return result;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Checks if any file of a snapshot has been replaced, created or removed since the snapshot was loaded
+ * --------------------------------------------------------------------------------------------------
+ */
+static bool HasChanged(const DatabaseSnapshot* snapshot)
+{
+    for (int i = 0; i < DB_FILE_COUNT; i++)
+    {
+        unsigned long inode = 0;
+        long modified = 0;
+        GetFileVersion(snapshot->files[i].path, &inode, &modified);
+        if (inode != snapshot->files[i].inode || modified != snapshot->files[i].modified) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets the inode and the modification time of a file, or 0 if the file does not exist
+ * --------------------------------------------------------------------------------------------------
+ */
+static void GetFileVersion(const char* path, unsigned long* inode, long* modified)
+{
+    struct stat info;
+    if (stat(path, &info) == -1) {
+        *inode = 0;
+        *modified = 0;
+        return;
+    }
+    *inode = (unsigned long) info.st_ino;
+    *modified = (long) info.st_mtim.tv_sec * 1000000000L + info.st_mtim.tv_nsec;
+}
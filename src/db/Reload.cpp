@@ -0,0 +1,267 @@
+#include "Database.h"
+
+#include "../libs/Restart.h"
+#include "../util/Log.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define RELOAD_SETTLE_TIME 200  // Milliseconds without changes before the files are loaded, so a writer can replace all of them first
+#define RELOAD_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM | IN_CLOSE_WRITE)
+
+// Every process that serves requests starts its own thread, since every process has its own copy of the snapshots
+static pid_t reloader_pid = 0;
+static int fd_wakeup[2] = { -1, -1 };  // Written to by "Database_RequestReload"
+static int fd_notify = -1;
+static int watch_delta = -1;
+static ReloadListener reload_listener = 0;
+
+static void* RunReloader(void* arg);
+static int WaitForChange(int timeout, bool* requested);
+static bool ReadChanges();
+static void WatchDelta();
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Starts a thread that reloads the database in the background (see "Database_Reload"), when a file in the database
+ * directory or the delta is replaced, and when a reload is requested with "Database_RequestReload"
+ * The files are loaded once no more changes have been seen for a short while, so that a writer that replaces all files
+ * is done before they are loaded. A forked process has no copy of the thread, and has to start its own
+ *
+ * watch: Watch the files for changes. Worker processes only reload when they are asked to, after the process that
+ *        watches the files has checked the new files and written their indexes, so the files are only checked and
+ *        indexed once instead of once in every process
+ *
+ * Returns 0 on success
+ * Returns -1 if the thread could not be started. An error message will be printed
+ * Returns -2 if the thread has already been started in this process
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_StartReloader(bool watch)
+{
+    if (reloader_pid == getpid()) {
+        return -2;
+    }
+
+    // The process was forked from a process with its own thread. Its descriptors are only read by that thread
+    if (reloader_pid != 0)
+    {
+        r_close(fd_wakeup[0]);
+        r_close(fd_wakeup[1]);
+        if (fd_notify != -1) {
+            r_close(fd_notify);
+        }
+        fd_wakeup[0] = fd_wakeup[1] = fd_notify = -1;
+        watch_delta = -1;
+        reloader_pid = 0;
+        reload_listener = 0;
+    }
+
+    if (pipe2(fd_wakeup, O_CLOEXEC | O_NONBLOCK) == -1) {
+        fprintf(stderr, "[%ld] Failed to start the database reloader: %s\n", GetLogId(), strerror(errno));
+        return -1;
+    }
+
+    // Without inotify the database is still reloaded when it is requested
+    if (!watch) {
+        fd_notify = -1;
+    }
+    else if ((fd_notify = inotify_init1(IN_CLOEXEC | IN_NONBLOCK)) == -1 || inotify_add_watch(fd_notify, DB_DIR, RELOAD_EVENTS) == -1) {
+        fprintf(stderr, "[%ld] Could not watch the database files for changes: %s\n", GetLogId(), strerror(errno));
+        if (fd_notify != -1) {
+            r_close(fd_notify);
+            fd_notify = -1;
+        }
+    }
+    WatchDelta();
+
+    // The signals are handled by the threads that serve the requests, so that no signal interrupts the loading
+    sigset_t all_signals, old_signals;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
+    pthread_t thread;
+    int res = pthread_create(&thread, NULL, RunReloader, 0);
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    if (res != 0) {
+        fprintf(stderr, "[%ld] Failed to start the database reloader: %s\n", GetLogId(), strerror(res));
+        r_close(fd_wakeup[0]);
+        r_close(fd_wakeup[1]);
+        fd_wakeup[0] = fd_wakeup[1] = -1;
+        return -1;
+    }
+    pthread_detach(thread);
+    reloader_pid = getpid();
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Sets the function that the reloader thread calls every time it has swapped in a new snapshot
+ * This is used by the supervisor of the worker processes, to tell the workers to load the files that it has just checked.
+ * It must be set before the thread is started, since the thread reads it without a lock. It is not kept in forked processes
+ *
+ * listener: The function to call, or 0 to stop calling it
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_SetReloadListener(ReloadListener listener)
+{
+    reload_listener = listener;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Wakes up the reloader thread, so that the database is reloaded if any file has been replaced
+ * This is safe to call from a signal handler
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_RequestReload()
+{
+    int saved_errno = errno;
+    if (fd_wakeup[1] != -1) {
+        char byte = 1;
+        ssize_t res = write(fd_wakeup[1], &byte, 1);  // A full pipe already has a request in it
+        (void) res;
+    }
+    errno = saved_errno;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Runs the thread that reloads the database. It waits for a change or a request, then waits until nothing has changed
+ * for RELOAD_SETTLE_TIME, so that a writer that replaces several files is done, and reloads the database
+ * --------------------------------------------------------------------------------------------------
+ */
+static void* RunReloader(void* arg)
+{
+    (void) arg;
+    while (true)
+    {
+        bool requested = false;
+        if (WaitForChange(-1, &requested) == -1) {
+            return 0;
+        }
+        while (WaitForChange(RELOAD_SETTLE_TIME, &requested) == 1);
+
+        int result = Database_Reload();
+        if (result == 0 && reload_listener != 0) {
+            reload_listener();
+        }
+        if (result == -2 && requested) {
+            fprintf(stderr, "[%ld] Reload requested: No database file has been replaced\n", GetLogId());
+        }
+    }
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Waits until a file of the database has changed, or a reload has been requested
+ *
+ * timeout: The max time to wait in milliseconds, or -1 to wait forever
+ * requested: Set to true if a reload was requested
+ *
+ * Returns 1 if anything has changed, 0 on timeout, and -1 if the descriptors can not be polled
+ * --------------------------------------------------------------------------------------------------
+ */
+static int WaitForChange(int timeout, bool* requested)
+{
+    struct pollfd fds[2];
+    fds[0].fd = fd_wakeup[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = fd_notify;  // Ignored by poll when it is -1
+    fds[1].events = POLLIN;
+
+    while (true)
+    {
+        int res = poll(fds, 2, timeout);
+        if (res == -1 && errno == EINTR) {
+            continue;
+        }
+        if (res == -1) {
+            fprintf(stderr, "[%ld] The database reloader stopped: %s\n", GetLogId(), strerror(errno));
+            return -1;
+        }
+        if (res == 0) {
+            return 0;
+        }
+
+        bool changed = false;
+        if (fds[0].revents & POLLIN)
+        {
+            char bytes[64];
+            while (read(fd_wakeup[0], bytes, sizeof(bytes)) > 0);
+            *requested = true;
+            changed = true;
+        }
+        if ((fds[1].revents & POLLIN) && ReadChanges()) {
+            changed = true;
+        }
+        // Changes to other files, like the index files, do not restart the wait
+        if (changed) {
+            return 1;
+        }
+    }
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads the pending inotify events
+ * Returns true if a database file or the delta directory has changed
+ * --------------------------------------------------------------------------------------------------
+ */
+static bool ReadChanges()
+{
+    bool changed = false;
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    while ((length = read(fd_notify, buffer, sizeof(buffer))) > 0)
+    {
+        for (char* next = buffer; next < buffer + length; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*) next;
+            next += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                changed = true;
+                continue;
+            }
+            if (event->wd == watch_delta && (event->mask & IN_IGNORED)) {
+                watch_delta = -1;  // The delta directory has been removed
+            }
+            if (event->len == 0) {
+                continue;
+            }
+
+            const char* name = event->name;
+            int name_length = (int) strlen(name);
+            if (strcmp(name, "delta") == 0 && event->wd != watch_delta) {
+                WatchDelta();
+                changed = true;
+            }
+            else if (name_length > 4 && strcmp(&(name[name_length - 4]), ".bin") == 0) {
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+
+// The delta directory is watched while it exists, since it is created and removed by the writers
+static void WatchDelta()
+{
+    if (fd_notify != -1 && watch_delta == -1) {
+        watch_delta = inotify_add_watch(fd_notify, DB_DELTA_DIR, RELOAD_EVENTS | IN_ONLYDIR);
+    }
+}
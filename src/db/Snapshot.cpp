@@ -0,0 +1,211 @@
+#include "Database.h"
+
+#include "../util/Log.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The files of every snapshot, in the order of the DB_FILE_* values
+typedef struct {
+    const char* path;
+    int type;
+    bool delta;
+} SnapshotFile;
+
+static const SnapshotFile snapshot_files[DB_FILE_COUNT] = {
+    { DB_ATHLETES, DB_TYPE_ATHLETES, false },
+    { DB_ATHLETE_RACES, DB_TYPE_ATHLETE_RACES, false },
+    { DB_RACE_INFO, DB_TYPE_RACE_INFO, false },
+    { DB_RACE_RESULTS, DB_TYPE_RACE_RESULTS, false },
+    { DB_DELTA_ATHLETES, DB_TYPE_ATHLETES, true },
+    { DB_DELTA_ATHLETE_RACES, DB_TYPE_ATHLETE_RACES, true },
+    { DB_DELTA_RACE_INFO, DB_TYPE_RACE_INFO, true },
+    { DB_DELTA_RACE_RESULTS, DB_TYPE_RACE_RESULTS, true },
+};
+
+static DatabaseSnapshot MakeEmptySnapshot();
+
+// The files of a snapshot before anything has been loaded. Every new snapshot starts as a copy of it.
+// It is the current snapshot until the database has been loaded, so lookups fail in the same way as when the files are missing
+static DatabaseSnapshot empty_snapshot = MakeEmptySnapshot();
+
+// The snapshot that new requests read from. It is swapped, and the references are counted, while the lock is held
+static DatabaseSnapshot* current = &empty_snapshot;
+static pthread_mutex_t snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t fork_handlers_once = PTHREAD_ONCE_INIT;
+
+// The snapshot that the calling thread reads from while it serves a request, or while it loads a new snapshot
+static thread_local DatabaseSnapshot* pinned = 0;
+
+static void InstallForkHandlers();
+static void LockBeforeFork();
+static void UnlockAfterFork();
+static void UnlockInChild();
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Gets the snapshot that all lookups in the database are made in
+ * This is the snapshot that the calling thread has acquired or pinned, or else the current snapshot.
+ * Only the threads that load snapshots swap them, so the current snapshot can be read without acquiring it by every
+ * program that does not reload the database, and by the thread that reloads it
+ * --------------------------------------------------------------------------------------------------
+ */
+DatabaseSnapshot* Database_GetSnapshot()
+{
+    return (pinned != 0) ? pinned : current;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Acquires the current snapshot for the calling thread, so that it is not freed while a request reads from it,
+ * even if a new snapshot is swapped in. Every request should acquire the snapshot before it reads from the database,
+ * and release it with "Database_ReleaseSnapshot" once the response has been sent, so that all lookups of a request
+ * are made in the same version of the database
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_AcquireSnapshot()
+{
+    pthread_mutex_lock(&snapshot_lock);
+    pinned = current;
+    pinned->references++;
+    pthread_mutex_unlock(&snapshot_lock);
+}
+
+void Database_ReleaseSnapshot()
+{
+    DatabaseSnapshot* snapshot = pinned;
+    if (snapshot == 0) {
+        return;
+    }
+    pinned = 0;
+
+    pthread_mutex_lock(&snapshot_lock);
+    bool unused = (--snapshot->references == 0);
+    pthread_mutex_unlock(&snapshot_lock);
+    if (unused) {
+        Database_FreeSnapshot(snapshot);
+    }
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Allocates a new snapshot where no files have been loaded yet
+ * Returns the new snapshot, or 0 if the memory could not be allocated. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+DatabaseSnapshot* Database_NewSnapshot()
+{
+    DatabaseSnapshot* snapshot = (DatabaseSnapshot*) malloc(sizeof(DatabaseSnapshot));
+    if (snapshot == 0) {
+        fprintf(stderr, "[%ld] Failed to load the database: Failed to allocate memory\n", GetLogId());
+        return 0;
+    }
+    *snapshot = empty_snapshot;
+    snapshot->references = 0;
+    return snapshot;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Makes the calling thread read from the given snapshot, while the snapshot is loaded. 0 goes back to the current snapshot
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_PinSnapshot(DatabaseSnapshot* snapshot)
+{
+    pinned = snapshot;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Makes a loaded snapshot the current snapshot, so that the requests that start after this read from it
+ * The old snapshot is freed once the last request that reads from it has released it
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_SwapSnapshot(DatabaseSnapshot* snapshot)
+{
+    pthread_once(&fork_handlers_once, InstallForkHandlers);
+
+    pthread_mutex_lock(&snapshot_lock);
+    DatabaseSnapshot* old = current;
+    snapshot->references++;
+    current = snapshot;
+    bool unused = (--old->references == 0);
+    pthread_mutex_unlock(&snapshot_lock);
+    if (unused) {
+        Database_FreeSnapshot(old);
+    }
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Unmaps the files of a snapshot, and frees its indexes and dictionary
+ * --------------------------------------------------------------------------------------------------
+ */
+void Database_FreeSnapshot(DatabaseSnapshot* snapshot)
+{
+    if (snapshot == 0 || snapshot == &empty_snapshot) {
+        return;
+    }
+    for (int i = 0; i < DB_FILE_COUNT; i++) {
+        Database_UnmapFile(snapshot->files[i].buffer, snapshot->files[i].size);
+        Database_UnloadKeyIndex(&(snapshot->files[i].keys));
+    }
+    Database_FreeDictionary(&(snapshot->dictionary));
+    free(snapshot);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Makes the snapshot where no files have been loaded. Everything but the paths and types of the files is zero
+ * --------------------------------------------------------------------------------------------------
+ */
+static DatabaseSnapshot MakeEmptySnapshot()
+{
+    DatabaseSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    for (int i = 0; i < DB_FILE_COUNT; i++) {
+        snapshot.files[i].path = snapshot_files[i].path;
+        snapshot.files[i].type = snapshot_files[i].type;
+        snapshot.files[i].delta = snapshot_files[i].delta;
+    }
+    snapshot.references = 1;
+    return snapshot;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * The server forks new processes while a snapshot may be loaded by another thread (see "Database_StartReloader")
+ * The lock of the snapshots is held while forking, so the child never gets a copy of it that is locked forever.
+ * The child gets its own copy of the lock file of the delta, that the thread in the parent may hold while it loads
+ * a snapshot. The copy is closed, so that the lock is released once the parent is done with it
+ * --------------------------------------------------------------------------------------------------
+ */
+static void InstallForkHandlers()
+{
+    pthread_atfork(LockBeforeFork, UnlockAfterFork, UnlockInChild);
+}
+
+static void LockBeforeFork()
+{
+    pthread_mutex_lock(&snapshot_lock);
+}
+
+static void UnlockAfterFork()
+{
+    pthread_mutex_unlock(&snapshot_lock);
+}
+
+static void UnlockInChild()
+{
+    pthread_mutex_unlock(&snapshot_lock);
+    Database_UnlockDelta();
+}
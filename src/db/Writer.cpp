@@ -0,0 +1,426 @@
+#include "Database.h"
+
+#include "../libs/Restart.h"
+#include "../util/Log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WRITER_PATH_MAX_SIZE 256
+#define WRITER_SET_MIN_CAPACITY 1024
+
+static int AppendUnique(WriterSet* set, DatabaseBuffer* section, const void* data, int size, unsigned int* offset);
+static int GrowSet(WriterSet* set);
+static unsigned int HashBytes(const void* data, int size);
+static int AppendVarint(DatabaseBuffer* buffer, unsigned long long value);
+static unsigned long long Zigzag(long long value);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Writes a database file in the current version of the format: the header, the section table with the checksum of every section,
+ * and every section starting at a 4-byte aligned offset
+ * The file is written to a temporary file first, and then renamed over the old file, so a partly written file is never read
+ *
+ * path: The path to the database file
+ * type: The file type, one of the DB_TYPE_* values
+ * sections: The content of every section, in the order of the file type (see DB_TYPE_ATHLETES in Database.h)
+ * row_sizes: The row size of every section, or 1 for a string heap
+ * sections_size: The number of sections
+ *
+ * Returns 0 on success
+ * Returns -1 on failure. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_WriteFile(const char* path, int type, const DatabaseBuffer* sections, const int* row_sizes, int sections_size)
+{
+    DatabaseBuffer file;
+    memset(&file, 0, sizeof(file));
+    bool failed = Database_AppendBytes(&file, DB_FORMAT_MAGIC, 4) == -1 || Database_AppendU32(&file, DB_FORMAT_VERSION) == -1 ||
+                  Database_AppendU32(&file, type) == -1 || Database_AppendU32(&file, sections_size) == -1;
+
+    int offset = DB_FORMAT_HEADER_SIZE + sections_size * DB_SECTION_ENTRY_SIZE;
+    for (int i = 0; i < sections_size && !failed; i++) {
+        failed = Database_AppendU32(&file, offset) == -1 || Database_AppendU32(&file, sections[i].size) == -1 ||
+                 Database_AppendU32(&file, sections[i].size / row_sizes[i]) == -1 || Database_AppendU32(&file, row_sizes[i]) == -1 ||
+                 Database_AppendU32(&file, Database_Crc32c(sections[i].data, sections[i].size)) == -1;
+        offset += (sections[i].size + 3) & ~3;
+    }
+    for (int i = 0; i < sections_size && !failed; i++) {
+        const char padding[4] = { 0, 0, 0, 0 };
+        failed = Database_AppendBytes(&file, sections[i].data, sections[i].size) == -1 ||
+                 Database_AppendBytes(&file, padding, ((sections[i].size + 3) & ~3) - sections[i].size) == -1;
+    }
+    if (failed) {
+        fprintf(stderr, "[%ld] Failed to write %s: Failed to allocate memory\n", GetLogId(), path);
+        free(file.data);
+        return -1;
+    }
+
+    char temp_path[WRITER_PATH_MAX_SIZE];
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld", path, (long) getpid());
+
+    int fd;
+    if ((fd = r_open3(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+        fprintf(stderr, "[%ld] Failed to write %s: %s\n", GetLogId(), temp_path, strerror(errno));
+        free(file.data);
+        return -1;
+    }
+    bool written = (r_write(fd, file.data, file.size) == file.size);
+    if (r_close(fd) == -1) {
+        written = false;
+    }
+    if (!written || rename(temp_path, path) == -1) {
+        fprintf(stderr, "[%ld] Failed to write %s: %s\n", GetLogId(), path, strerror(errno));
+        unlink(temp_path);
+        free(file.data);
+        return -1;
+    }
+
+    fprintf(stderr, "[%ld] Wrote %s in version %d of the format (%d bytes)\n", GetLogId(), path, DB_FORMAT_VERSION, file.size);
+    free(file.data);
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Appends a little-endian integer, or a null-terminated string to a string heap
+ * The first string in a heap is always the empty string, so all empty strings share offset 0
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_AppendU32(DatabaseBuffer* buffer, unsigned int value)
+{
+    unsigned char bytes[4] = {
+        (unsigned char) (value & 0xFF), (unsigned char) ((value >> 8) & 0xFF),
+        (unsigned char) ((value >> 16) & 0xFF), (unsigned char) ((value >> 24) & 0xFF)
+    };
+    return Database_AppendBytes(buffer, bytes, 4);
+}
+
+int Database_AppendString(DatabaseBuffer* heap, const char* str, unsigned int* offset)
+{
+    if (heap->size == 0 && Database_AppendBytes(heap, "", 1) == -1) {
+        return -1;
+    }
+    if (str[0] == '\0') {
+        *offset = 0;
+        return 0;
+    }
+    *offset = (unsigned int) heap->size;
+    return Database_AppendBytes(heap, str, strlen(str) + 1);
+}
+
+int Database_AppendBytes(DatabaseBuffer* buffer, const void* data, int size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    if (buffer->size + size > buffer->capacity)
+    {
+        int capacity = (buffer->capacity > 0) ? buffer->capacity : 4096;
+        while (buffer->size + size > capacity) {
+            capacity *= 2;
+        }
+        char* new_data = (char*) realloc(buffer->data, capacity);
+        if (new_data == 0) {
+            return -1;
+        }
+        buffer->data = new_data;
+        buffer->capacity = capacity;
+    }
+    memcpy(&(buffer->data[buffer->size]), data, size);
+    buffer->size += size;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Appends a row to the results of the race lists of the athletes (see DB_TYPE_ATHLETE_RACES in Database.h)
+ * The name of an athlete is usually the same in all races, so the name of the row before is used again if it is the same
+ *
+ * results: The results section
+ * strings: The string heap that the results point into
+ * result: The result to append. The raceid is not stored, since it is in the raceids section
+ *
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_AppendAthleteResult(DatabaseBuffer* results, DatabaseBuffer* strings, const AthleteResultRecord* result)
+{
+    unsigned int name = 0;
+    unsigned int fispoints = 0;
+    bool same_name = false;
+    if (results->size >= DB_ROW_ATHLETE_RESULT)
+    {
+        const unsigned char* previous = (const unsigned char*) &(results->data[results->size - DB_ROW_ATHLETE_RESULT + 16]);
+        name = previous[0] | (previous[1] << 8) | (previous[2] << 16) | ((unsigned int) previous[3] << 24);
+        same_name = name < (unsigned int) strings->size && strcmp(&(strings->data[name]), result->name) == 0;
+    }
+    if ((!same_name && Database_AppendString(strings, result->name, &name) == -1) ||
+        Database_AppendString(strings, result->fispoints, &fispoints) == -1) {
+        return -1;
+    }
+
+    unsigned int columns[] = { result->rank, result->time, result->diff, result->participants, name, fispoints };
+    for (int c = 0; c < 6; c++) {
+        if (Database_AppendU32(results, columns[c]) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Appends the result list of a race to a race results file in the packed format (see "DB_PACKED_COLUMNS" in Database.h)
+ * Every column of the race is stored with as many bits as its largest difference to its smallest value needs.
+ * The entrants and the strings that were written for an earlier race are used again, so they are only stored once per file
+ *
+ * writer: The sections of the file, set to 0 before the first race. Write them with "Database_WriteRaceResults"
+ * raceid: The race
+ * results: The ranks of the race, in the order of the result list
+ * results_size: The number of ranks
+ *
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_AppendRaceResults(ResultsWriter* writer, unsigned int raceid, const ResultRecord* results, int results_size)
+{
+    DatabaseBuffer* races = &(writer->sections[0]);
+    DatabaseBuffer* ranks = &(writer->sections[1]);
+    DatabaseBuffer* entrants = &(writer->sections[2]);
+    DatabaseBuffer* strings = &(writer->sections[3]);
+    if (Database_AppendU32(races, raceid) == -1 || Database_AppendU32(races, ranks->size) == -1 ||
+        Database_AppendU32(races, results_size) == -1) {
+        return -1;
+    }
+
+    unsigned long long* values = 0;
+    if (results_size > 0 && (values = (unsigned long long*) malloc((size_t) results_size * DB_PACKED_COLUMNS * sizeof(unsigned long long))) == 0) {
+        return -1;
+    }
+
+    // The columns of every rank, before the smallest value is subtracted
+    long long first_time = (results_size > 0) ? results[0].time : 0;
+    for (int i = 0; i < results_size; i++)
+    {
+        const ResultRecord* result = &(results[i]);
+        unsigned int name = 0;
+        unsigned int nation = 0;
+        unsigned int fispoints = 0;
+        if (strings->size == 0 && Database_AppendBytes(strings, "", 1) == -1) {
+            free(values);
+            return -1;
+        }
+        bool failed = (result->name[0] != '\0' && AppendUnique(&(writer->strings), strings, result->name, strlen(result->name) + 1, &name) == -1) ||
+                      (result->nation[0] != '\0' && AppendUnique(&(writer->strings), strings, result->nation, strlen(result->nation) + 1, &nation) == -1) ||
+                      (result->fispoints[0] != '\0' && AppendUnique(&(writer->strings), strings, result->fispoints, strlen(result->fispoints) + 1, &fispoints) == -1);
+
+        unsigned int entrant_columns[] = { result->fiscode, result->year, name, nation };
+        unsigned char entrant[DB_ROW_ENTRANT];
+        for (int b = 0; b < DB_ROW_ENTRANT; b++) {
+            entrant[b] = (unsigned char) ((entrant_columns[b / 4] >> ((b % 4) * 8)) & 0xFF);
+        }
+        unsigned int entrant_offset = 0;
+        if (failed || AppendUnique(&(writer->entrants), entrants, entrant, DB_ROW_ENTRANT, &entrant_offset) == -1) {
+            free(values);
+            return -1;
+        }
+
+        unsigned long long* columns = &(values[i * DB_PACKED_COLUMNS]);
+        columns[0] = (result->rank == 0) ? 0 : Zigzag((long long) i + 1 - result->rank) + 1;
+        columns[1] = result->bib;
+        columns[2] = entrant_offset / DB_ROW_ENTRANT;
+        columns[3] = result->diff;
+        columns[4] = Zigzag((long long) result->time - first_time - result->diff);
+        columns[5] = fispoints;
+    }
+
+    // The header of the race: the time of the first rank, and the smallest value and the number of bits of every column
+    unsigned long long min[DB_PACKED_COLUMNS];
+    int bits[DB_PACKED_COLUMNS];
+    bool failed = AppendVarint(ranks, (unsigned long long) first_time) == -1;
+    for (int c = 0; c < DB_PACKED_COLUMNS && !failed; c++)
+    {
+        min[c] = (results_size > 0) ? values[c] : 0;
+        unsigned long long max = min[c];
+        for (int i = 1; i < results_size; i++) {
+            unsigned long long value = values[i * DB_PACKED_COLUMNS + c];
+            min[c] = (value < min[c]) ? value : min[c];
+            max = (value > max) ? value : max;
+        }
+        bits[c] = 0;
+        while (bits[c] < 64 && ((max - min[c]) >> bits[c]) != 0) {
+            bits[c]++;
+        }
+        unsigned char byte = (unsigned char) bits[c];
+        failed = AppendVarint(ranks, min[c]) == -1 || Database_AppendBytes(ranks, &byte, 1) == -1;
+    }
+
+    // The ranks, with the bits of every value from the lowest bit up, and the ranks packed directly after each other
+    unsigned long long pending = 0;
+    int pending_bits = 0;
+    for (int i = 0; i < results_size && !failed; i++)
+    {
+        for (int c = 0; c < DB_PACKED_COLUMNS && !failed; c++)
+        {
+            pending |= (values[i * DB_PACKED_COLUMNS + c] - min[c]) << pending_bits;
+            pending_bits += bits[c];
+            while (pending_bits >= 8 && !failed) {
+                unsigned char byte = (unsigned char) (pending & 0xFF);
+                failed = Database_AppendBytes(ranks, &byte, 1) == -1;
+                pending >>= 8;
+                pending_bits -= 8;
+            }
+        }
+    }
+    if (pending_bits > 0 && !failed) {
+        unsigned char byte = (unsigned char) (pending & 0xFF);
+        failed = Database_AppendBytes(ranks, &byte, 1) == -1;
+    }
+    free(values);
+    return failed ? -1 : 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Writes the race results that were appended with "Database_AppendRaceResults" to a file in the current version of the format
+ * The writer has to be freed with "Database_FreeResultsWriter" afterwards
+ *
+ * Returns 0 on success
+ * Returns -1 on failure. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+int Database_WriteRaceResults(const char* path, ResultsWriter* writer)
+{
+    // The padding lets the last column be read with a 64-bit load, and terminates the section like a heap
+    const char padding[DB_PACKED_PADDING] = { 0 };
+    if (Database_AppendBytes(&(writer->sections[1]), padding, DB_PACKED_PADDING) == -1 ||
+        (writer->sections[3].size == 0 && Database_AppendBytes(&(writer->sections[3]), "", 1) == -1)) {
+        fprintf(stderr, "[%ld] Failed to write %s: Failed to allocate memory\n", GetLogId(), path);
+        return -1;
+    }
+    int row_sizes[] = { DB_ROW_LIST, 1, DB_ROW_ENTRANT, 1 };
+    return Database_WriteFile(path, DB_TYPE_RACE_RESULTS, writer->sections, row_sizes, 4);
+}
+
+void Database_FreeResultsWriter(ResultsWriter* writer)
+{
+    for (int i = 0; i < 4; i++) {
+        free(writer->sections[i].data);
+    }
+    free(writer->strings.offsets);
+    free(writer->strings.hashes);
+    free(writer->entrants.offsets);
+    free(writer->entrants.hashes);
+    memset(writer, 0, sizeof(ResultsWriter));
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Appends the bytes to a section, unless the same bytes have been appended before with the same set
+ *
+ * offset: Set to the offset in the section where the bytes are stored
+ *
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int AppendUnique(WriterSet* set, DatabaseBuffer* section, const void* data, int size, unsigned int* offset)
+{
+    if (set->size * 2 >= set->capacity && GrowSet(set) == -1) {
+        return -1;
+    }
+
+    unsigned int hash = HashBytes(data, size);
+    int slot = (int) (hash & (unsigned int) (set->capacity - 1));
+    while (set->offsets[slot] != 0)
+    {
+        unsigned int found = set->offsets[slot] - 1;
+        if (set->hashes[slot] == hash && found + (unsigned int) size <= (unsigned int) section->size &&
+            memcmp(&(section->data[found]), data, size) == 0) {
+            *offset = found;
+            return 0;
+        }
+        slot = (slot + 1) & (set->capacity - 1);
+    }
+
+    *offset = (unsigned int) section->size;
+    if (Database_AppendBytes(section, data, size) == -1) {
+        return -1;
+    }
+    set->offsets[slot] = *offset + 1;
+    set->hashes[slot] = hash;
+    set->size++;
+    return 0;
+}
+
+static int GrowSet(WriterSet* set)
+{
+    int capacity = (set->capacity > 0) ? set->capacity * 2 : WRITER_SET_MIN_CAPACITY;
+    unsigned int* offsets = (unsigned int*) calloc(capacity, sizeof(unsigned int));
+    unsigned int* hashes = (unsigned int*) calloc(capacity, sizeof(unsigned int));
+    if (offsets == 0 || hashes == 0) {
+        free(offsets);
+        free(hashes);
+        return -1;
+    }
+    for (int i = 0; i < set->capacity; i++)
+    {
+        if (set->offsets[i] == 0) {
+            continue;
+        }
+        int slot = (int) (set->hashes[i] & (unsigned int) (capacity - 1));
+        while (offsets[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        offsets[slot] = set->offsets[i];
+        hashes[slot] = set->hashes[i];
+    }
+    free(set->offsets);
+    free(set->hashes);
+    set->offsets = offsets;
+    set->hashes = hashes;
+    set->capacity = capacity;
+    return 0;
+}
+
+static unsigned int HashBytes(const void* data, int size)
+{
+    const unsigned char* bytes = (const unsigned char*) data;
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Appends an unsigned integer in 7 bits per byte, with the highest bit set in every byte but the last
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int AppendVarint(DatabaseBuffer* buffer, unsigned long long value)
+{
+    unsigned char bytes[10];
+    int size = 0;
+    while (value >= 0x80) {
+        bytes[size++] = (unsigned char) ((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    bytes[size++] = (unsigned char) value;
+    return Database_AppendBytes(buffer, bytes, size);
+}
+
+static unsigned long long Zigzag(long long value)
+{
+    return ((unsigned long long) value << 1) ^ (unsigned long long) (value >> 63);
+}
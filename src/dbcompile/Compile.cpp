@@ -0,0 +1,968 @@
+#include "DbCompile.h"
+
+#include "../db/Database.h"
+#include "../util/Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// An entry in the race list of an athlete
+typedef struct {
+    unsigned int fiscode;
+    unsigned int raceid;
+    const char* date;
+    const CompileResult* result;  // The result of the athlete in the race
+    int participants;             // The number of ranks in the result list of the race
+} AthleteRace;
+
+// The dictionary of the race info. When the delta is written, the strings of the loaded database come first with the same codes,
+// and only the new strings are sorted
+typedef struct {
+    const char** strings;
+    int size;
+    int loaded_size;  // The number of strings from the loaded database
+} Dictionary;
+
+// Where the files are written. The delta extends the loaded database, instead of replacing it
+typedef struct {
+    const char* athletes;
+    const char* athlete_races;
+    const char* race_info;
+    const char* race_results;
+    bool delta;
+} CompileTarget;
+
+static const CompileTarget database_target = { DB_ATHLETES, DB_ATHLETE_RACES, DB_RACE_INFO, DB_RACE_RESULTS, false };
+static const CompileTarget delta_target = { DB_DELTA_ATHLETES, DB_DELTA_ATHLETE_RACES, DB_DELTA_RACE_INFO, DB_DELTA_RACE_RESULTS, true };
+
+static int Compile(CompileData* data, const CompileTarget* target);
+static int DedupeAthletes(CompileData* data);
+static int DedupeRaces(CompileData* data);
+static int DedupeResults(CompileData* data);
+static int BuildDictionary(const CompileData* data, bool extend, Dictionary* dictionary);
+static int BuildAthleteRaces(const CompileData* data, AthleteRace** athlete_races, int* athlete_races_size);
+static int WriteAthletes(const CompileData* data, const char* path);
+static int BuildLoadedAthletes(const CompileData* data, unsigned int** loaded_athletes, int* loaded_athletes_size);
+static int WriteAthleteRaces(const CompileData* data, const AthleteRace* athlete_races, int athlete_races_size,
+                             const unsigned int* loaded_athletes, int loaded_athletes_size, const char* path);
+static int AppendAthleteResult(DatabaseBuffer* sections, const AthleteRace* athlete_race);
+static int WriteRaceInfo(const CompileData* data, const Dictionary* dictionary, const char* path);
+static int WriteRaceResults(const CompileData* data, const char* path);
+static int WriteSections(const char* path, int type, DatabaseBuffer* sections, const int* row_sizes, int sections_size, bool failed);
+static int LoadDeltaAthletes(CompileData* data);
+static int LoadDeltaRaces(CompileData* data);
+static int LoadDeltaResults(CompileData* data);
+static const CompileRace* FindRace(const CompileData* data, unsigned int raceid);
+static bool HasResults(const CompileData* data, unsigned int raceid);
+static unsigned int FindCode(const Dictionary* dictionary, const char* str);
+static int CompareAthletes(const void* a, const void* b);
+static int CompareRaces(const void* a, const void* b);
+static int CompareResultsBySource(const void* a, const void* b);
+static int CompareResultsByRank(const void* a, const void* b);
+static int CompareAthleteRaces(const void* a, const void* b);
+static int CompareStrings(const void* a, const void* b);
+static int CompareFiscodes(const void* a, const void* b);
+static void FreeAthlete(CompileAthlete* athlete);
+static void FreeRace(CompileRace* race);
+static void FreeResult(CompileResult* result);
+static const char* Str(const char* str);
+static int Grow(void** array, int* capacity, int size, int element_size);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Adds a record that has been read from an input file. The strings of the record are owned by "data" after this
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+int AddAthlete(CompileData* data, const CompileAthlete* athlete)
+{
+    if (Grow((void**) &(data->athletes), &(data->athletes_capacity), data->athletes_size, sizeof(CompileAthlete)) == -1) {
+        return -1;
+    }
+    data->athletes[data->athletes_size++] = *athlete;
+    return 0;
+}
+
+int AddRace(CompileData* data, const CompileRace* race)
+{
+    if (Grow((void**) &(data->races), &(data->races_capacity), data->races_size, sizeof(CompileRace)) == -1) {
+        return -1;
+    }
+    data->races[data->races_size++] = *race;
+    return 0;
+}
+
+int AddResult(CompileData* data, const CompileResult* result)
+{
+    if (Grow((void**) &(data->results), &(data->results_capacity), data->results_size, sizeof(CompileResult)) == -1) {
+        return -1;
+    }
+    data->results[data->results_size++] = *result;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Moves all records of "src" to the end of "dest", and numbers them in the order they end up in
+ * The input files are merged in the order they were given, so the result does not depend on which thread read which file
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+int MergeCompileData(CompileData* dest, CompileData* src)
+{
+    for (int i = 0; i < src->athletes_size; i++) {
+        src->athletes[i].sequence = dest->athletes_size;
+        if (AddAthlete(dest, &(src->athletes[i])) == -1) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < src->races_size; i++) {
+        src->races[i].sequence = dest->races_size;
+        if (AddRace(dest, &(src->races[i])) == -1) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < src->results_size; i++) {
+        src->results[i].sequence = dest->results_size;
+        if (AddResult(dest, &(src->results[i])) == -1) {
+            return -1;
+        }
+    }
+
+    free(src->athletes);
+    free(src->races);
+    free(src->results);
+    memset(src, 0, sizeof(CompileData));
+    return 0;
+}
+
+
+void FreeCompileData(CompileData* data)
+{
+    for (int i = 0; i < data->athletes_size; i++) {
+        FreeAthlete(&(data->athletes[i]));
+    }
+    for (int i = 0; i < data->races_size; i++) {
+        FreeRace(&(data->races[i]));
+    }
+    for (int i = 0; i < data->results_size; i++) {
+        FreeResult(&(data->results[i]));
+    }
+    free(data->athletes);
+    free(data->races);
+    free(data->results);
+    memset(data, 0, sizeof(CompileData));
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Writes the database files from the merged records
+ *  - Athletes and races are sorted by fiscode and raceid. If a fiscode or raceid is read more than once,
+ *    the record that was read last is kept
+ *  - A race gets its result list from the last input file that has results for it, so a newer export of a race
+ *    replaces the old one. The ranks are sorted by rank, with the athletes without a rank last,
+ *    and an athlete is only kept once in every result list
+ *  - The race list of every athlete is built from the result lists, sorted by the date of the race
+ *  - The files are written in the current version of the format, with the race info dictionary sorted by the strings
+ *
+ * Returns 0 on success, and -1 on failure. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+int CompileDatabase(CompileData* data)
+{
+    return Compile(data, &database_target);
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Writes the delta from the merged records, in the same way as "CompileDatabase" (see DB_DELTA_DIR in Database.h)
+ * The database and the old delta have to be loaded, and the records of the old delta have to be added first (see "LoadDelta"),
+ * so that the new delta replaces the old one. Every record in the delta replaces the record with the same key in the database.
+ *  - The race list of every athlete in the delta is the race list in the database, with the races of the delta added
+ *    at the end, sorted by date. The athletes that were in the loaded result list of a race in the delta also get a race list,
+ *    without the races they are no longer in the results of
+ *  - The dictionary starts with the dictionary of the database, so the codes in the database stay the same
+ *
+ * Returns 0 on success, and -1 on failure. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+int CompileDelta(CompileData* data)
+{
+    return Compile(data, &delta_target);
+}
+
+
+static int Compile(CompileData* data, const CompileTarget* target)
+{
+    if (DedupeAthletes(data) == -1 || DedupeRaces(data) == -1 || DedupeResults(data) == -1) {
+        fprintf(stderr, "[%ld] Failed to compile the database: Failed to allocate memory\n", GetLogId());
+        return -1;
+    }
+
+    Dictionary dictionary;
+    memset(&dictionary, 0, sizeof(dictionary));
+    AthleteRace* athlete_races = 0;
+    int athlete_races_size = 0;
+    unsigned int* loaded_athletes = 0;
+    int loaded_athletes_size = 0;
+    if (BuildDictionary(data, target->delta, &dictionary) == -1 ||
+        BuildAthleteRaces(data, &athlete_races, &athlete_races_size) == -1 ||
+        (target->delta && BuildLoadedAthletes(data, &loaded_athletes, &loaded_athletes_size) == -1)) {
+        fprintf(stderr, "[%ld] Failed to compile the database: Failed to allocate memory\n", GetLogId());
+        free(dictionary.strings);
+        free(athlete_races);
+        free(loaded_athletes);
+        return -1;
+    }
+
+    int result = 0;
+    if (WriteAthletes(data, target->athletes) == -1 ||
+        WriteAthleteRaces(data, athlete_races, athlete_races_size, loaded_athletes, loaded_athletes_size, target->athlete_races) == -1 ||
+        WriteRaceInfo(data, &dictionary, target->race_info) == -1 || WriteRaceResults(data, target->race_results) == -1) {
+        result = -1;
+    }
+    fprintf(stderr, "[%ld] Compiled %d athletes, %d races and %d ranks%s\n", GetLogId(), data->athletes_size, data->races_size,
+            data->results_size, target->delta ? " into the delta" : "");
+
+    free(dictionary.strings);
+    free(athlete_races);
+    free(loaded_athletes);
+    return result;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Adds the records of the loaded delta, before the records of the input files are merged in after them
+ * The results of the delta get source -1, so any input file with results for the same race replaces them
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+int LoadDelta(CompileData* data)
+{
+    if (!Database_HasDelta()) {
+        return 0;
+    }
+    if (LoadDeltaAthletes(data) == -1 || LoadDeltaRaces(data) == -1 || LoadDeltaResults(data) == -1) {
+        return -1;
+    }
+    fprintf(stderr, "[%ld] Loaded %d athletes, %d races and %d ranks from the delta\n", GetLogId(), data->athletes_size, data->races_size, data->results_size);
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Sorts the records by their key, and removes the records that are replaced by a later record with the same key
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int DedupeAthletes(CompileData* data)
+{
+    qsort(data->athletes, data->athletes_size, sizeof(CompileAthlete), CompareAthletes);
+    int size = 0;
+    for (int i = 0; i < data->athletes_size; i++)
+    {
+        if (i + 1 < data->athletes_size && data->athletes[i + 1].fiscode == data->athletes[i].fiscode) {
+            FreeAthlete(&(data->athletes[i]));
+            continue;
+        }
+        data->athletes[size++] = data->athletes[i];
+    }
+    data->athletes_size = size;
+    return 0;
+}
+
+static int DedupeRaces(CompileData* data)
+{
+    qsort(data->races, data->races_size, sizeof(CompileRace), CompareRaces);
+    int size = 0;
+    for (int i = 0; i < data->races_size; i++)
+    {
+        if (i + 1 < data->races_size && data->races[i + 1].raceid == data->races[i].raceid) {
+            FreeRace(&(data->races[i]));
+            continue;
+        }
+        data->races[size++] = data->races[i];
+    }
+    data->races_size = size;
+    return 0;
+}
+
+static int DedupeResults(CompileData* data)
+{
+    // Grouped by race, with the results of the last input file first in every group
+    qsort(data->results, data->results_size, sizeof(CompileResult), CompareResultsBySource);
+
+    int size = 0;
+    int start = 0;
+    while (start < data->results_size)
+    {
+        unsigned int raceid = data->results[start].raceid;
+        int source = data->results[start].source;
+        int end = start;
+        while (end < data->results_size && data->results[end].raceid == raceid) {
+            end++;
+        }
+
+        int group_start = size;
+        for (int i = start; i < end; i++) {
+            if (data->results[i].source == source) {
+                data->results[size++] = data->results[i];
+            } else {
+                FreeResult(&(data->results[i]));
+            }
+        }
+        qsort(&(data->results[group_start]), size - group_start, sizeof(CompileResult), CompareResultsByRank);
+
+        // An athlete that is listed more than once in the same result list keeps the best rank
+        int group_size = group_start;
+        for (int i = group_start; i < size; i++)
+        {
+            bool duplicate = false;
+            for (int j = group_start; j < group_size && !duplicate; j++) {
+                duplicate = (data->results[j].fiscode == data->results[i].fiscode);
+            }
+            if (duplicate) {
+                FreeResult(&(data->results[i]));
+                continue;
+            }
+            data->results[group_size++] = data->results[i];
+        }
+        size = group_size;
+        start = end;
+    }
+    data->results_size = size;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Builds the dictionary of the race info: every distinct nation, category, discipline, type and gender, sorted,
+ * with the empty string first so that it gets code 0
+ * When "extend" is set, the dictionary starts with every string of the loaded database, and only the strings
+ * that are not in it are added after them
+ * Returns 0 on success, and -1 on failure
+ * --------------------------------------------------------------------------------------------------
+ */
+static int BuildDictionary(const CompileData* data, bool extend, Dictionary* dictionary)
+{
+    int loaded_size = extend ? Database_GetDictionarySize() : 0;
+    const char** strings = (const char**) malloc((loaded_size + data->races_size * 5 + 1) * sizeof(const char*));
+    if (strings == 0) {
+        return -1;
+    }
+
+    int size = 0;
+    for (; size < loaded_size; size++) {
+        strings[size] = Database_GetDictionaryString((DictionaryCode) size);
+    }
+    if (loaded_size == 0) {
+        strings[size++] = "";
+    }
+    for (int i = 0; i < data->races_size; i++)
+    {
+        const CompileRace* race = &(data->races[i]);
+        const char* columns[] = { Str(race->nation), Str(race->category), Str(race->discipline), Str(race->type), Str(race->gender) };
+        for (int c = 0; c < 5; c++) {
+            DictionaryCode code = 0;
+            if (loaded_size == 0 || Database_FindDictionaryCode(columns[c], &code) != 0) {
+                strings[size++] = columns[c];
+            }
+        }
+    }
+
+    // Only the new strings are sorted. The empty string is either the first string of the loaded database, or sorted first
+    qsort(&(strings[loaded_size]), size - loaded_size, sizeof(const char*), CompareStrings);
+    int unique = loaded_size;
+    for (int i = loaded_size; i < size; i++) {
+        if (unique == loaded_size || strcmp(strings[unique - 1], strings[i]) != 0) {
+            strings[unique++] = strings[i];
+        }
+    }
+    if (unique > 65536) {
+        fprintf(stderr, "[%ld] Failed to compile the database: The race info has more than 65536 distinct strings\n", GetLogId());
+        free(strings);
+        return -1;
+    }
+    dictionary->strings = strings;
+    dictionary->size = unique;
+    dictionary->loaded_size = loaded_size;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Builds the race list of every athlete from the result lists, sorted by fiscode and then by the date of the race.
+ * Every entry keeps the result of the athlete, and the number of ranks in the race, for the results of the race lists
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int BuildAthleteRaces(const CompileData* data, AthleteRace** athlete_races, int* athlete_races_size)
+{
+    AthleteRace* entries = (AthleteRace*) malloc((data->results_size + 1) * sizeof(AthleteRace));
+    if (entries == 0) {
+        return -1;
+    }
+
+    // Every race is looked up once, since the results are grouped by race
+    const CompileRace* race = 0;
+    int race_start = 0;
+    int race_end = 0;
+    for (int i = 0; i < data->results_size; i++) {
+        if (i == race_end) {
+            race = FindRace(data, data->results[i].raceid);
+            race_start = i;
+            while (race_end < data->results_size && data->results[race_end].raceid == data->results[i].raceid) {
+                race_end++;
+            }
+        }
+        entries[i].fiscode = data->results[i].fiscode;
+        entries[i].raceid = data->results[i].raceid;
+        entries[i].date = (race != 0 && race->raceid == data->results[i].raceid) ? Str(race->date) : "";
+        entries[i].result = &(data->results[i]);
+        entries[i].participants = race_end - race_start;
+    }
+    qsort(entries, data->results_size, sizeof(AthleteRace), CompareAthleteRaces);
+
+    *athlete_races = entries;
+    *athlete_races_size = data->results_size;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Finds the athletes in the loaded result lists of every race that has new results, sorted by fiscode.
+ * Their race lists are written to the delta, since they may have lost a race that they are not in the new results of
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int BuildLoadedAthletes(const CompileData* data, unsigned int** loaded_athletes, int* loaded_athletes_size)
+{
+    DatabaseBuffer fiscodes;
+    memset(&fiscodes, 0, sizeof(fiscodes));
+
+    for (int i = 0; i < data->results_size; i++)
+    {
+        if (i > 0 && data->results[i - 1].raceid == data->results[i].raceid) {
+            continue;
+        }
+        RaceResultsRecord race;
+        if (Database_FindRaceResults(data->results[i].raceid, &race) != 0) {
+            continue;
+        }
+        int offset = 0;
+        ResultRecord result;
+        for (int j = 0; j < race.results_size && Database_NextResult(&race, &offset, &result) == 0; j++) {
+            if (Database_AppendBytes(&fiscodes, &(result.fiscode), sizeof(unsigned int)) == -1) {
+                free(fiscodes.data);
+                return -1;
+            }
+        }
+    }
+
+    // An empty array is still allocated, since no array means that the race lists are not extended
+    int size = fiscodes.size / (int) sizeof(unsigned int);
+    if (size == 0 && Database_AppendBytes(&fiscodes, "\0\0\0", sizeof(unsigned int)) == -1) {
+        return -1;
+    }
+    unsigned int* entries = (unsigned int*) fiscodes.data;
+    qsort(entries, size, sizeof(unsigned int), CompareFiscodes);
+    int unique = 0;
+    for (int i = 0; i < size; i++) {
+        if (unique == 0 || entries[unique - 1] != entries[i]) {
+            entries[unique++] = entries[i];
+        }
+    }
+    *loaded_athletes = entries;
+    *loaded_athletes_size = unique;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Builds the sections of every database file, and writes them (see DB_TYPE_ATHLETES in Database.h)
+ * Returns 0 on success, and -1 on failure. An error message will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+static int WriteAthletes(const CompileData* data, const char* path)
+{
+    DatabaseBuffer sections[2];
+    memset(sections, 0, sizeof(sections));
+
+    bool failed = false;
+    for (int i = 0; i < data->athletes_size && !failed; i++)
+    {
+        const CompileAthlete* athlete = &(data->athletes[i]);
+        const char* columns[] = { athlete->firstname, athlete->lastname, athlete->nation, athlete->birthdate, athlete->gender, athlete->club };
+        failed = Database_AppendU32(&(sections[0]), athlete->fiscode) == -1 || Database_AppendU32(&(sections[0]), athlete->compid) == -1;
+        for (int c = 0; c < 6 && !failed; c++) {
+            unsigned int offset = 0;
+            failed = Database_AppendString(&(sections[1]), Str(columns[c]), &offset) == -1 || Database_AppendU32(&(sections[0]), offset) == -1;
+        }
+    }
+
+    int row_sizes[] = { DB_ROW_ATHLETE, 1 };
+    return WriteSections(path, DB_TYPE_ATHLETES, sections, row_sizes, 2, failed);
+}
+
+static int WriteAthleteRaces(const CompileData* data, const AthleteRace* athlete_races, int athlete_races_size,
+                             const unsigned int* loaded_athletes, int loaded_athletes_size, const char* path)
+{
+    DatabaseBuffer sections[4];
+    memset(sections, 0, sizeof(sections));
+
+    // Every athlete gets a race list, also the athletes without any races, and the athletes that are only in the results
+    // For the delta, the loaded athletes also get a race list, that starts with their race list in the loaded database.
+    // A loaded race that is in the new results is left out if the athlete is not in its new result list
+    // Every race in a list gets the result of the athlete in it. The results of the loaded races are copied from the loaded database
+    bool failed = false;
+    int a = 0;
+    int r = 0;
+    int l = 0;
+    while ((a < data->athletes_size || r < athlete_races_size || l < loaded_athletes_size) && !failed)
+    {
+        unsigned int fiscode = 0xFFFFFFFF;
+        if (a < data->athletes_size && data->athletes[a].fiscode < fiscode) {
+            fiscode = data->athletes[a].fiscode;
+        }
+        if (r < athlete_races_size && athlete_races[r].fiscode < fiscode) {
+            fiscode = athlete_races[r].fiscode;
+        }
+        if (l < loaded_athletes_size && loaded_athletes[l] < fiscode) {
+            fiscode = loaded_athletes[l];
+        }
+        while (a < data->athletes_size && data->athletes[a].fiscode == fiscode) {
+            a++;
+        }
+        while (l < loaded_athletes_size && loaded_athletes[l] == fiscode) {
+            l++;
+        }
+        int races_end = r;
+        while (races_end < athlete_races_size && athlete_races[races_end].fiscode == fiscode) {
+            races_end++;
+        }
+
+        unsigned int first = (unsigned int) (sections[1].size / DB_ROW_RACEID);
+        unsigned int count = 0;
+        RaceIdsRecord loaded;
+        if (loaded_athletes == 0 || Database_FindRaceIds(fiscode, &loaded) != 0) {
+            loaded.raceids_size = 0;
+        }
+        for (int i = 0; i < loaded.raceids_size && !failed; i++)
+        {
+            unsigned int raceid = Database_GetRaceId(&loaded, i);
+            const AthleteRace* new_race = 0;
+            for (int j = r; j < races_end && new_race == 0; j++) {
+                new_race = (athlete_races[j].raceid == raceid) ? &(athlete_races[j]) : 0;
+            }
+            // A race with new results gets the new result of the athlete
+            if (new_race != 0) {
+                failed = Database_AppendU32(&(sections[1]), raceid) == -1 || AppendAthleteResult(sections, new_race) == -1;
+                count++;
+            }
+            else if (!HasResults(data, raceid)) {
+                AthleteResultRecord result;
+                if (Database_GetAthleteResult(&loaded, i, &result) != 0) {
+                    memset(&result, 0, sizeof(result));
+                    result.name = "";
+                    result.fispoints = "";
+                }
+                failed = Database_AppendU32(&(sections[1]), raceid) == -1 || Database_AppendAthleteResult(&(sections[2]), &(sections[3]), &result) == -1;
+                count++;
+            }
+        }
+        for (; r < races_end && !failed; r++)
+        {
+            bool loaded_race = false;
+            for (int i = 0; i < loaded.raceids_size && !loaded_race; i++) {
+                loaded_race = (Database_GetRaceId(&loaded, i) == athlete_races[r].raceid);
+            }
+            if (!loaded_race) {
+                failed = Database_AppendU32(&(sections[1]), athlete_races[r].raceid) == -1 || AppendAthleteResult(sections, &(athlete_races[r])) == -1;
+                count++;
+            }
+        }
+        failed = failed || Database_AppendU32(&(sections[0]), fiscode) == -1 || Database_AppendU32(&(sections[0]), first) == -1 ||
+                 Database_AppendU32(&(sections[0]), count) == -1;
+    }
+
+    int row_sizes[] = { DB_ROW_LIST, DB_ROW_RACEID, DB_ROW_ATHLETE_RESULT, 1 };
+    return WriteSections(path, DB_TYPE_ATHLETE_RACES, sections, row_sizes, 4, failed);
+}
+
+// Appends the result of the athlete in a race to the results and the string heap of the athlete races
+static int AppendAthleteResult(DatabaseBuffer* sections, const AthleteRace* athlete_race)
+{
+    const CompileResult* race_result = athlete_race->result;
+    AthleteResultRecord result = {
+        race_result->raceid, race_result->rank, race_result->time, race_result->diff,
+        (unsigned int) athlete_race->participants, Str(race_result->name), Str(race_result->fispoints)
+    };
+    return Database_AppendAthleteResult(&(sections[2]), &(sections[3]), &result);
+}
+
+static int WriteRaceInfo(const CompileData* data, const Dictionary* dictionary, const char* path)
+{
+    DatabaseBuffer sections[3];
+    memset(sections, 0, sizeof(sections));
+
+    bool failed = false;
+    for (int i = 0; i < dictionary->size && !failed; i++) {
+        unsigned int offset = 0;
+        failed = Database_AppendString(&(sections[2]), dictionary->strings[i], &offset) == -1 || Database_AppendU32(&(sections[1]), offset) == -1;
+    }
+
+    for (int i = 0; i < data->races_size && !failed; i++)
+    {
+        const CompileRace* race = &(data->races[i]);
+        unsigned int columns[] = {
+            race->raceid, race->codex, 0, FindCode(dictionary, race->nation), 0, FindCode(dictionary, race->category),
+            FindCode(dictionary, race->discipline), FindCode(dictionary, race->type), FindCode(dictionary, race->gender)
+        };
+        failed = Database_AppendString(&(sections[2]), Str(race->date), &(columns[2])) == -1 ||
+                 Database_AppendString(&(sections[2]), Str(race->location), &(columns[4])) == -1;
+        for (int c = 0; c < 9 && !failed; c++) {
+            failed = Database_AppendU32(&(sections[0]), columns[c]) == -1;
+        }
+    }
+
+    int row_sizes[] = { DB_ROW_RACE_INFO, DB_ROW_DICTIONARY, 1 };
+    return WriteSections(path, DB_TYPE_RACE_INFO, sections, row_sizes, 3, failed);
+}
+
+static int WriteRaceResults(const CompileData* data, const char* path)
+{
+    ResultsWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    ResultRecord* results = 0;
+    if (data->results_size > 0 && (results = (ResultRecord*) malloc(data->results_size * sizeof(ResultRecord))) == 0) {
+        fprintf(stderr, "[%ld] Failed to write %s: Failed to allocate memory\n", GetLogId(), path);
+        return -1;
+    }
+
+    bool failed = false;
+    int start = 0;
+    while (start < data->results_size && !failed)
+    {
+        unsigned int raceid = data->results[start].raceid;
+        int end = start;
+        for (; end < data->results_size && data->results[end].raceid == raceid; end++)
+        {
+            const CompileResult* result = &(data->results[end]);
+            ResultRecord* record = &(results[end - start]);
+            record->rank = result->rank;
+            record->bib = result->bib;
+            record->fiscode = result->fiscode;
+            record->time = result->time;
+            record->diff = result->diff;
+            record->year = result->year;
+            record->name = Str(result->name);
+            record->nation = Str(result->nation);
+            record->fispoints = Str(result->fispoints);
+        }
+        failed = Database_AppendRaceResults(&writer, raceid, results, end - start) == -1;
+        start = end;
+    }
+    free(results);
+
+    int result = -1;
+    if (failed) {
+        fprintf(stderr, "[%ld] Failed to write %s: Failed to allocate memory\n", GetLogId(), path);
+    } else {
+        result = Database_WriteRaceResults(path, &writer);
+    }
+    Database_FreeResultsWriter(&writer);
+    return result;
+}
+
+static int WriteSections(const char* path, int type, DatabaseBuffer* sections, const int* row_sizes, int sections_size, bool failed)
+{
+    int result = -1;
+    if (failed) {
+        fprintf(stderr, "[%ld] Failed to write %s: Failed to allocate memory\n", GetLogId(), path);
+    } else {
+        result = Database_WriteFile(path, type, sections, row_sizes, sections_size);
+    }
+    for (int i = 0; i < sections_size; i++) {
+        free(sections[i].data);
+    }
+    return result;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Copies the records of the loaded delta into compile records, with their own copies of the strings
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int LoadDeltaAthletes(CompileData* data)
+{
+    int offset = DB_DELTA_OFFSET;
+    AthleteRecord record;
+    while (Database_NextAthlete(&offset, &record) == 0)
+    {
+        CompileAthlete athlete;
+        memset(&athlete, 0, sizeof(athlete));
+        athlete.fiscode = record.fiscode;
+        athlete.compid = record.compid;
+        athlete.sequence = data->athletes_size;
+        char** strings[] = { &(athlete.firstname), &(athlete.lastname), &(athlete.nation), &(athlete.birthdate), &(athlete.gender), &(athlete.club) };
+        const char* columns[] = { record.firstname, record.lastname, record.nation, record.birthdate, record.gender, record.club };
+        bool failed = false;
+        for (int c = 0; c < 6; c++) {
+            failed = ((*(strings[c]) = strdup(columns[c])) == 0) || failed;
+        }
+        if (failed || AddAthlete(data, &athlete) == -1) {
+            FreeAthlete(&athlete);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int LoadDeltaRaces(CompileData* data)
+{
+    int offset = DB_DELTA_OFFSET;
+    RaceInfoRecord record;
+    while (Database_NextRaceInfo(&offset, &record) == 0)
+    {
+        CompileRace race;
+        memset(&race, 0, sizeof(race));
+        race.raceid = record.raceid;
+        race.codex = record.codex;
+        race.sequence = data->races_size;
+        char** strings[] = { &(race.date), &(race.nation), &(race.location), &(race.category), &(race.discipline), &(race.type), &(race.gender) };
+        const char* columns[] = {
+            record.date, Database_GetDictionaryString(record.nation), record.location, Database_GetDictionaryString(record.category),
+            Database_GetDictionaryString(record.discipline), Database_GetDictionaryString(record.type), Database_GetDictionaryString(record.gender)
+        };
+        bool failed = false;
+        for (int c = 0; c < 7; c++) {
+            failed = ((*(strings[c]) = strdup(columns[c])) == 0) || failed;
+        }
+        if (failed || AddRace(data, &race) == -1) {
+            FreeRace(&race);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int LoadDeltaResults(CompileData* data)
+{
+    int offset = DB_DELTA_OFFSET;
+    RaceResultsRecord race;
+    while (Database_NextRaceResults(&offset, &race) == 0)
+    {
+        int result_offset = 0;
+        ResultRecord record;
+        for (int i = 0; i < race.results_size && Database_NextResult(&race, &result_offset, &record) == 0; i++)
+        {
+            CompileResult result;
+            memset(&result, 0, sizeof(result));
+            result.raceid = race.raceid;
+            result.rank = record.rank;
+            result.bib = record.bib;
+            result.fiscode = record.fiscode;
+            result.time = record.time;
+            result.diff = record.diff;
+            result.year = record.year;
+            result.source = -1;
+            result.sequence = data->results_size;
+            result.name = strdup(record.name);
+            result.nation = strdup(record.nation);
+            result.fispoints = strdup(record.fispoints);
+            if (result.name == 0 || result.nation == 0 || result.fispoints == 0 || AddResult(data, &result) == -1) {
+                FreeResult(&result);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static const CompileRace* FindRace(const CompileData* data, unsigned int raceid)
+{
+    int low = 0;
+    int high = data->races_size;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (data->races[middle].raceid < raceid) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return (low < data->races_size && data->races[low].raceid == raceid) ? &(data->races[low]) : 0;
+}
+
+// The results are grouped by race, in the order of the raceids
+static bool HasResults(const CompileData* data, unsigned int raceid)
+{
+    int low = 0;
+    int high = data->results_size;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (data->results[middle].raceid < raceid) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < data->results_size && data->results[low].raceid == raceid;
+}
+
+static unsigned int FindCode(const Dictionary* dictionary, const char* str)
+{
+    const char* key = Str(str);
+    DictionaryCode code = 0;
+    if (dictionary->loaded_size > 0 && Database_FindDictionaryCode(key, &code) == 0) {
+        return code;
+    }
+    const char** sorted = &(dictionary->strings[dictionary->loaded_size]);
+    const char** found = (const char**) bsearch(&key, sorted, dictionary->size - dictionary->loaded_size, sizeof(const char*), CompareStrings);
+    return (found != 0) ? (unsigned int) (found - dictionary->strings) : 0;
+}
+
+
+static int CompareAthletes(const void* a, const void* b)
+{
+    const CompileAthlete* athlete_a = (const CompileAthlete*) a;
+    const CompileAthlete* athlete_b = (const CompileAthlete*) b;
+    if (athlete_a->fiscode != athlete_b->fiscode) {
+        return (athlete_a->fiscode < athlete_b->fiscode) ? -1 : 1;
+    }
+    return athlete_a->sequence - athlete_b->sequence;
+}
+
+static int CompareRaces(const void* a, const void* b)
+{
+    const CompileRace* race_a = (const CompileRace*) a;
+    const CompileRace* race_b = (const CompileRace*) b;
+    if (race_a->raceid != race_b->raceid) {
+        return (race_a->raceid < race_b->raceid) ? -1 : 1;
+    }
+    return race_a->sequence - race_b->sequence;
+}
+
+static int CompareResultsBySource(const void* a, const void* b)
+{
+    const CompileResult* result_a = (const CompileResult*) a;
+    const CompileResult* result_b = (const CompileResult*) b;
+    if (result_a->raceid != result_b->raceid) {
+        return (result_a->raceid < result_b->raceid) ? -1 : 1;
+    }
+    if (result_a->source != result_b->source) {
+        return result_b->source - result_a->source;
+    }
+    return result_a->sequence - result_b->sequence;
+}
+
+static int CompareResultsByRank(const void* a, const void* b)
+{
+    // Athletes without a rank (rank 0) did not finish, and are listed last in the order they were read
+    const CompileResult* result_a = (const CompileResult*) a;
+    const CompileResult* result_b = (const CompileResult*) b;
+    unsigned int rank_a = (result_a->rank != 0) ? result_a->rank : 0xFFFFFFFF;
+    unsigned int rank_b = (result_b->rank != 0) ? result_b->rank : 0xFFFFFFFF;
+    if (rank_a != rank_b) {
+        return (rank_a < rank_b) ? -1 : 1;
+    }
+    return result_a->sequence - result_b->sequence;
+}
+
+static int CompareAthleteRaces(const void* a, const void* b)
+{
+    const AthleteRace* race_a = (const AthleteRace*) a;
+    const AthleteRace* race_b = (const AthleteRace*) b;
+    if (race_a->fiscode != race_b->fiscode) {
+        return (race_a->fiscode < race_b->fiscode) ? -1 : 1;
+    }
+    int date = strcmp(race_a->date, race_b->date);
+    if (date != 0) {
+        return date;
+    }
+    if (race_a->raceid != race_b->raceid) {
+        return (race_a->raceid < race_b->raceid) ? -1 : 1;
+    }
+    return 0;
+}
+
+static int CompareStrings(const void* a, const void* b)
+{
+    return strcmp(*((const char* const*) a), *((const char* const*) b));
+}
+
+static int CompareFiscodes(const void* a, const void* b)
+{
+    unsigned int fiscode_a = *((const unsigned int*) a);
+    unsigned int fiscode_b = *((const unsigned int*) b);
+    return (fiscode_a != fiscode_b) ? ((fiscode_a < fiscode_b) ? -1 : 1) : 0;
+}
+
+
+static void FreeAthlete(CompileAthlete* athlete)
+{
+    char* strings[] = { athlete->firstname, athlete->lastname, athlete->nation, athlete->birthdate, athlete->gender, athlete->club };
+    for (int i = 0; i < 6; i++) {
+        free(strings[i]);
+    }
+    memset(athlete, 0, sizeof(CompileAthlete));
+}
+
+static void FreeRace(CompileRace* race)
+{
+    char* strings[] = { race->date, race->nation, race->location, race->category, race->discipline, race->type, race->gender };
+    for (int i = 0; i < 7; i++) {
+        free(strings[i]);
+    }
+    memset(race, 0, sizeof(CompileRace));
+}
+
+static void FreeResult(CompileResult* result)
+{
+    free(result->name);
+    free(result->nation);
+    free(result->fispoints);
+    memset(result, 0, sizeof(CompileResult));
+}
+
+
+// Fields that were missing in the input are read as empty strings
+static const char* Str(const char* str)
+{
+    return (str != 0) ? str : "";
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Makes room for one more element at the end of an array
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int Grow(void** array, int* capacity, int size, int element_size)
+{
+    if (size < *capacity) {
+        return 0;
+    }
+    int new_capacity = (*capacity > 0) ? *capacity * 2 : 1024;
+    void* new_array = realloc(*array, (size_t) new_capacity * element_size);
+    if (new_array == 0) {
+        return -1;
+    }
+    *array = new_array;
+    *capacity = new_capacity;
+    return 0;
+}
+
@@ -0,0 +1,74 @@
+#pragma once
+
+
+// The records that are read from the raw result data. All strings are normalized UTF-8 (see "NormalizeString"),
+// and are allocated separately for every record
+typedef struct {
+    unsigned int fiscode;
+    unsigned int compid;
+    char* firstname;
+    char* lastname;
+    char* nation;
+    char* birthdate;
+    char* gender;
+    char* club;
+    int sequence;  // The order the record was read in, over all input files. Later records replace earlier ones
+} CompileAthlete;
+
+typedef struct {
+    unsigned int raceid;
+    unsigned int codex;
+    char* date;
+    char* nation;
+    char* location;
+    char* category;
+    char* discipline;
+    char* type;
+    char* gender;
+    int sequence;
+} CompileRace;
+
+typedef struct {
+    unsigned int raceid;
+    unsigned int rank;
+    unsigned int bib;
+    unsigned int fiscode;
+    unsigned int time;  // In milliseconds
+    unsigned int diff;  // In milliseconds
+    unsigned int year;
+    char* name;
+    char* nation;
+    char* fispoints;
+    int source;    // The input file the result was read from, or -1 for the delta. A race gets its result list from the last file that has it
+    int sequence;
+} CompileResult;
+
+// Everything that was read from one input file, or from all input files once they have been merged
+typedef struct {
+    CompileAthlete* athletes;
+    int athletes_size;
+    int athletes_capacity;
+    CompileRace* races;
+    int races_size;
+    int races_capacity;
+    CompileResult* results;
+    int results_size;
+    int results_capacity;
+} CompileData;
+
+
+// Parse.cpp
+int ParseInputFile(const char* path, int source, CompileData* data);
+
+// Normalize.cpp
+char* NormalizeString(const char* str, int size);
+
+// Compile.cpp
+int AddAthlete(CompileData* data, const CompileAthlete* athlete);
+int AddRace(CompileData* data, const CompileRace* race);
+int AddResult(CompileData* data, const CompileResult* result);
+int MergeCompileData(CompileData* dest, CompileData* src);
+void FreeCompileData(CompileData* data);
+int CompileDatabase(CompileData* data);
+int CompileDelta(CompileData* data);
+int LoadDelta(CompileData* data);
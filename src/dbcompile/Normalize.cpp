@@ -0,0 +1,226 @@
+#include "DbCompile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    unsigned int base;
+    unsigned int mark;
+    unsigned int composed;
+} Composition;
+
+// Letters followed by a combining mark, that are written as one precomposed letter (Unicode NFC) instead.
+// Only the Latin-1 and Latin Extended-A letters are listed, which covers the names of the athletes and locations.
+// Sorted by the letter and the mark
+static const Composition compositions[] = {
+    { 0x41, 0x0300, 0x00C0 }, { 0x41, 0x0301, 0x00C1 }, { 0x41, 0x0302, 0x00C2 }, { 0x41, 0x0303, 0x00C3 },
+    { 0x41, 0x0304, 0x0100 }, { 0x41, 0x0306, 0x0102 }, { 0x41, 0x0308, 0x00C4 }, { 0x41, 0x030A, 0x00C5 },
+    { 0x41, 0x0328, 0x0104 }, { 0x43, 0x0301, 0x0106 }, { 0x43, 0x0302, 0x0108 }, { 0x43, 0x0307, 0x010A },
+    { 0x43, 0x030C, 0x010C }, { 0x43, 0x0327, 0x00C7 }, { 0x44, 0x030C, 0x010E }, { 0x45, 0x0300, 0x00C8 },
+    { 0x45, 0x0301, 0x00C9 }, { 0x45, 0x0302, 0x00CA }, { 0x45, 0x0304, 0x0112 }, { 0x45, 0x0306, 0x0114 },
+    { 0x45, 0x0307, 0x0116 }, { 0x45, 0x0308, 0x00CB }, { 0x45, 0x030C, 0x011A }, { 0x45, 0x0328, 0x0118 },
+    { 0x47, 0x0302, 0x011C }, { 0x47, 0x0306, 0x011E }, { 0x47, 0x0307, 0x0120 }, { 0x47, 0x0327, 0x0122 },
+    { 0x48, 0x0302, 0x0124 }, { 0x49, 0x0300, 0x00CC }, { 0x49, 0x0301, 0x00CD }, { 0x49, 0x0302, 0x00CE },
+    { 0x49, 0x0303, 0x0128 }, { 0x49, 0x0304, 0x012A }, { 0x49, 0x0306, 0x012C }, { 0x49, 0x0307, 0x0130 },
+    { 0x49, 0x0308, 0x00CF }, { 0x49, 0x0328, 0x012E }, { 0x4A, 0x0302, 0x0134 }, { 0x4B, 0x0327, 0x0136 },
+    { 0x4C, 0x0301, 0x0139 }, { 0x4C, 0x030C, 0x013D }, { 0x4C, 0x0327, 0x013B }, { 0x4E, 0x0301, 0x0143 },
+    { 0x4E, 0x0303, 0x00D1 }, { 0x4E, 0x030C, 0x0147 }, { 0x4E, 0x0327, 0x0145 }, { 0x4F, 0x0300, 0x00D2 },
+    { 0x4F, 0x0301, 0x00D3 }, { 0x4F, 0x0302, 0x00D4 }, { 0x4F, 0x0303, 0x00D5 }, { 0x4F, 0x0304, 0x014C },
+    { 0x4F, 0x0306, 0x014E }, { 0x4F, 0x0308, 0x00D6 }, { 0x4F, 0x030B, 0x0150 }, { 0x52, 0x0301, 0x0154 },
+    { 0x52, 0x030C, 0x0158 }, { 0x52, 0x0327, 0x0156 }, { 0x53, 0x0301, 0x015A }, { 0x53, 0x0302, 0x015C },
+    { 0x53, 0x030C, 0x0160 }, { 0x53, 0x0327, 0x015E }, { 0x54, 0x030C, 0x0164 }, { 0x54, 0x0327, 0x0162 },
+    { 0x55, 0x0300, 0x00D9 }, { 0x55, 0x0301, 0x00DA }, { 0x55, 0x0302, 0x00DB }, { 0x55, 0x0303, 0x0168 },
+    { 0x55, 0x0304, 0x016A }, { 0x55, 0x0306, 0x016C }, { 0x55, 0x0308, 0x00DC }, { 0x55, 0x030A, 0x016E },
+    { 0x55, 0x030B, 0x0170 }, { 0x55, 0x0328, 0x0172 }, { 0x57, 0x0302, 0x0174 }, { 0x59, 0x0301, 0x00DD },
+    { 0x59, 0x0302, 0x0176 }, { 0x59, 0x0308, 0x0178 }, { 0x5A, 0x0301, 0x0179 }, { 0x5A, 0x0307, 0x017B },
+    { 0x5A, 0x030C, 0x017D }, { 0x61, 0x0300, 0x00E0 }, { 0x61, 0x0301, 0x00E1 }, { 0x61, 0x0302, 0x00E2 },
+    { 0x61, 0x0303, 0x00E3 }, { 0x61, 0x0304, 0x0101 }, { 0x61, 0x0306, 0x0103 }, { 0x61, 0x0308, 0x00E4 },
+    { 0x61, 0x030A, 0x00E5 }, { 0x61, 0x0328, 0x0105 }, { 0x63, 0x0301, 0x0107 }, { 0x63, 0x0302, 0x0109 },
+    { 0x63, 0x0307, 0x010B }, { 0x63, 0x030C, 0x010D }, { 0x63, 0x0327, 0x00E7 }, { 0x64, 0x030C, 0x010F },
+    { 0x65, 0x0300, 0x00E8 }, { 0x65, 0x0301, 0x00E9 }, { 0x65, 0x0302, 0x00EA }, { 0x65, 0x0304, 0x0113 },
+    { 0x65, 0x0306, 0x0115 }, { 0x65, 0x0307, 0x0117 }, { 0x65, 0x0308, 0x00EB }, { 0x65, 0x030C, 0x011B },
+    { 0x65, 0x0328, 0x0119 }, { 0x67, 0x0302, 0x011D }, { 0x67, 0x0306, 0x011F }, { 0x67, 0x0307, 0x0121 },
+    { 0x67, 0x0327, 0x0123 }, { 0x68, 0x0302, 0x0125 }, { 0x69, 0x0300, 0x00EC }, { 0x69, 0x0301, 0x00ED },
+    { 0x69, 0x0302, 0x00EE }, { 0x69, 0x0303, 0x0129 }, { 0x69, 0x0304, 0x012B }, { 0x69, 0x0306, 0x012D },
+    { 0x69, 0x0308, 0x00EF }, { 0x69, 0x0328, 0x012F }, { 0x6A, 0x0302, 0x0135 }, { 0x6B, 0x0327, 0x0137 },
+    { 0x6C, 0x0301, 0x013A }, { 0x6C, 0x030C, 0x013E }, { 0x6C, 0x0327, 0x013C }, { 0x6E, 0x0301, 0x0144 },
+    { 0x6E, 0x0303, 0x00F1 }, { 0x6E, 0x030C, 0x0148 }, { 0x6E, 0x0327, 0x0146 }, { 0x6F, 0x0300, 0x00F2 },
+    { 0x6F, 0x0301, 0x00F3 }, { 0x6F, 0x0302, 0x00F4 }, { 0x6F, 0x0303, 0x00F5 }, { 0x6F, 0x0304, 0x014D },
+    { 0x6F, 0x0306, 0x014F }, { 0x6F, 0x0308, 0x00F6 }, { 0x6F, 0x030B, 0x0151 }, { 0x72, 0x0301, 0x0155 },
+    { 0x72, 0x030C, 0x0159 }, { 0x72, 0x0327, 0x0157 }, { 0x73, 0x0301, 0x015B }, { 0x73, 0x0302, 0x015D },
+    { 0x73, 0x030C, 0x0161 }, { 0x73, 0x0327, 0x015F }, { 0x74, 0x030C, 0x0165 }, { 0x74, 0x0327, 0x0163 },
+    { 0x75, 0x0300, 0x00F9 }, { 0x75, 0x0301, 0x00FA }, { 0x75, 0x0302, 0x00FB }, { 0x75, 0x0303, 0x0169 },
+    { 0x75, 0x0304, 0x016B }, { 0x75, 0x0306, 0x016D }, { 0x75, 0x0308, 0x00FC }, { 0x75, 0x030A, 0x016F },
+    { 0x75, 0x030B, 0x0171 }, { 0x75, 0x0328, 0x0173 }, { 0x77, 0x0302, 0x0175 }, { 0x79, 0x0301, 0x00FD },
+    { 0x79, 0x0302, 0x0177 }, { 0x79, 0x0308, 0x00FF }, { 0x7A, 0x0301, 0x017A }, { 0x7A, 0x0307, 0x017C },
+    { 0x7A, 0x030C, 0x017E },
+};
+
+// The characters of the bytes 0x80 - 0x9F in Windows-1252, which is what most invalid UTF-8 in the raw data is encoded in.
+// The other bytes are the same in Latin-1 and Unicode
+static const unsigned int windows_1252[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+static int DecodeCharacter(const unsigned char* str, int size, int* position);
+static unsigned int Compose(unsigned int base, unsigned int mark);
+static bool IsSpace(unsigned int c);
+static int EncodeCharacter(unsigned int c, char* dest);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Normalizes a string from the raw data, so that the same name is always stored with the same bytes
+ *  - Bytes that are not valid UTF-8 are read as Windows-1252, and converted to UTF-8
+ *  - Letters followed by a combining mark are replaced by the precomposed letter
+ *  - Control characters, non-breaking spaces and runs of whitespace are replaced by a single space,
+ *    and the whitespace at the start and the end is removed
+ *  - Byte order marks and zero-width spaces are removed
+ *
+ * str: The string to normalize. Does not have to be null-terminated
+ * size: The number of bytes in the string
+ *
+ * Returns the normalized null-terminated string, that has to be freed. Returns 0 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+char* NormalizeString(const char* str, int size)
+{
+    // A byte is never more than 3 bytes in UTF-8, and characters are only ever removed or combined
+    char* normalized = (char*) malloc(size * 3 + 1);
+    if (normalized == 0) {
+        return 0;
+    }
+
+    int length = 0;
+    int last_start = -1;        // Where the last character starts in the normalized string
+    unsigned int last = 0;      // The last character
+    bool pending_space = false;
+    int position = 0;
+    while (position < size)
+    {
+        unsigned int c = (unsigned int) DecodeCharacter((const unsigned char*) str, size, &position);
+        if (c == 0xFEFF || c == 0x200B) {
+            continue;
+        }
+        if (IsSpace(c)) {
+            pending_space = (length > 0);
+            continue;
+        }
+        if (!pending_space && last_start >= 0) {
+            unsigned int composed = Compose(last, c);
+            if (composed != 0) {
+                length = last_start + EncodeCharacter(composed, &(normalized[last_start]));
+                last = composed;
+                continue;
+            }
+        }
+        if (pending_space) {
+            normalized[length++] = ' ';
+            pending_space = false;
+        }
+        last_start = length;
+        last = c;
+        length += EncodeCharacter(c, &(normalized[length]));
+    }
+    normalized[length] = '\0';
+    return normalized;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Decodes the character at the position, and moves the position to the next character
+ * A byte that does not start a valid UTF-8 sequence is decoded as one Windows-1252 character
+ * --------------------------------------------------------------------------------------------------
+ */
+static int DecodeCharacter(const unsigned char* str, int size, int* position)
+{
+    unsigned int b = str[*position];
+    int length = 0;
+    unsigned int c = 0;
+    unsigned int min = 0;
+    if (b < 0x80) {
+        (*position)++;
+        return (int) b;
+    }
+    else if ((b & 0xE0) == 0xC0) { length = 2; c = b & 0x1F; min = 0x80; }
+    else if ((b & 0xF0) == 0xE0) { length = 3; c = b & 0x0F; min = 0x800; }
+    else if ((b & 0xF8) == 0xF0) { length = 4; c = b & 0x07; min = 0x10000; }
+
+    bool valid = (length > 0 && *position + length <= size);
+    for (int i = 1; valid && i < length; i++) {
+        unsigned int next = str[*position + i];
+        valid = ((next & 0xC0) == 0x80);
+        c = (c << 6) | (next & 0x3F);
+    }
+    // Overlong sequences, surrogates and characters past the last one in Unicode are not valid either
+    if (valid && c >= min && c <= 0x10FFFF && (c < 0xD800 || c > 0xDFFF)) {
+        *position += length;
+        return (int) c;
+    }
+
+    (*position)++;
+    return (int) ((b < 0xA0) ? windows_1252[b - 0x80] : b);
+}
+
+
+static unsigned int Compose(unsigned int base, unsigned int mark)
+{
+    int low = 0;
+    int high = (int) (sizeof(compositions) / sizeof(compositions[0]));
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        const Composition* entry = &(compositions[middle]);
+        if (entry->base < base || (entry->base == base && entry->mark < mark)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    int size = (int) (sizeof(compositions) / sizeof(compositions[0]));
+    if (low < size && compositions[low].base == base && compositions[low].mark == mark) {
+        return compositions[low].composed;
+    }
+    return 0;
+}
+
+
+static bool IsSpace(unsigned int c)
+{
+    return c < 0x20 || c == ' ' || (c >= 0x7F && c < 0xA0) || c == 0xA0 || (c >= 0x2000 && c <= 0x200A) ||
+           c == 0x2028 || c == 0x2029 || c == 0x202F || c == 0x205F || c == 0x3000;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Writes a character as UTF-8
+ * Returns the number of bytes that were written
+ * --------------------------------------------------------------------------------------------------
+ */
+static int EncodeCharacter(unsigned int c, char* dest)
+{
+    if (c < 0x80) {
+        dest[0] = (char) c;
+        return 1;
+    }
+    if (c < 0x800) {
+        dest[0] = (char) (0xC0 | (c >> 6));
+        dest[1] = (char) (0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        dest[0] = (char) (0xE0 | (c >> 12));
+        dest[1] = (char) (0x80 | ((c >> 6) & 0x3F));
+        dest[2] = (char) (0x80 | (c & 0x3F));
+        return 3;
+    }
+    dest[0] = (char) (0xF0 | (c >> 18));
+    dest[1] = (char) (0x80 | ((c >> 12) & 0x3F));
+    dest[2] = (char) (0x80 | ((c >> 6) & 0x3F));
+    dest[3] = (char) (0x80 | (c & 0x3F));
+    return 4;
+}
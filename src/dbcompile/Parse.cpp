@@ -0,0 +1,464 @@
+#include "DbCompile.h"
+
+#include "../db/Database.h"
+#include "../libs/cJSON.h"
+#include "../util/Log.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FIELD_NUMBER 1
+#define FIELD_STRING 2
+
+#define KIND_ATHLETES 1
+#define KIND_RACES    2
+#define KIND_RESULTS  3
+
+#define MAX_COLUMNS 32
+
+// A field of a record, and where it is stored in the record
+typedef struct {
+    const char* name;
+    int type;
+    size_t offset;
+} Field;
+
+static const Field athlete_fields[] = {
+    { "fiscode", FIELD_NUMBER, offsetof(CompileAthlete, fiscode) },
+    { "competitionid", FIELD_NUMBER, offsetof(CompileAthlete, compid) },
+    { "firstname", FIELD_STRING, offsetof(CompileAthlete, firstname) },
+    { "lastname", FIELD_STRING, offsetof(CompileAthlete, lastname) },
+    { "nation", FIELD_STRING, offsetof(CompileAthlete, nation) },
+    { "birthdate", FIELD_STRING, offsetof(CompileAthlete, birthdate) },
+    { "gender", FIELD_STRING, offsetof(CompileAthlete, gender) },
+    { "club", FIELD_STRING, offsetof(CompileAthlete, club) },
+    { 0, 0, 0 }
+};
+
+static const Field race_fields[] = {
+    { "raceid", FIELD_NUMBER, offsetof(CompileRace, raceid) },
+    { "codex", FIELD_NUMBER, offsetof(CompileRace, codex) },
+    { "date", FIELD_STRING, offsetof(CompileRace, date) },
+    { "nation", FIELD_STRING, offsetof(CompileRace, nation) },
+    { "location", FIELD_STRING, offsetof(CompileRace, location) },
+    { "category", FIELD_STRING, offsetof(CompileRace, category) },
+    { "discipline", FIELD_STRING, offsetof(CompileRace, discipline) },
+    { "type", FIELD_STRING, offsetof(CompileRace, type) },
+    { "gender", FIELD_STRING, offsetof(CompileRace, gender) },
+    { 0, 0, 0 }
+};
+
+static const Field result_fields[] = {
+    { "raceid", FIELD_NUMBER, offsetof(CompileResult, raceid) },
+    { "rank", FIELD_NUMBER, offsetof(CompileResult, rank) },
+    { "bib", FIELD_NUMBER, offsetof(CompileResult, bib) },
+    { "fiscode", FIELD_NUMBER, offsetof(CompileResult, fiscode) },
+    { "time", FIELD_NUMBER, offsetof(CompileResult, time) },
+    { "diff", FIELD_NUMBER, offsetof(CompileResult, diff) },
+    { "year", FIELD_NUMBER, offsetof(CompileResult, year) },
+    { "name", FIELD_STRING, offsetof(CompileResult, name) },
+    { "nation", FIELD_STRING, offsetof(CompileResult, nation) },
+    { "fispoints", FIELD_STRING, offsetof(CompileResult, fispoints) },
+    { 0, 0, 0 }
+};
+
+static int ParseJson(const char* path, const char* buffer, int size, int source, CompileData* data);
+static int ParseJsonRecord(const char* path, const cJSON* json, const Field* fields, void* record);
+static int ParseCsv(const char* path, const char* buffer, int size, int source, CompileData* data);
+static int ReadCsvRow(const char* buffer, int size, int* offset, const char** columns, int* column_sizes, char* unquoted);
+static int SetField(const Field* field, void* record, const char* text, int text_size);
+static int AddRecord(CompileData* data, int kind, void* record, int source);
+static void FreeRecord(const Field* fields, void* record);
+static bool HasSuffix(const char* str, const char* suffix);
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads the athletes, races and results in a file of raw result data. The file is either JSON or CSV, by its extension
+ *
+ * JSON: An object with an "athletes" array and a "races" array. Every race can have a "results" array with its result list
+ * CSV: A header row with the names of the columns, and one record per row. The records are athletes, races,
+ *      or results, depending on the columns: results have a "rank" column, races a "raceid" column, and athletes a "fiscode" column
+ * The names of the fields are the same as in the JSON that the API sends (see README.md)
+ *
+ * path: The path to the file
+ * source: The number of the file in the input, used to tell which file a result list came from
+ * data: The records are added to data
+ *
+ * Returns 0 on success
+ * Returns -1 if the file could not be read. An error message will be printed.
+ *         Records that are invalid are skipped with a warning, and do not fail the file
+ * --------------------------------------------------------------------------------------------------
+ */
+int ParseInputFile(const char* path, int source, CompileData* data)
+{
+    bool json = HasSuffix(path, ".json");
+    if (!json && !HasSuffix(path, ".csv")) {
+        fprintf(stderr, "[%ld] Failed to read %s: Only .json and .csv files can be read\n", GetLogId(), path);
+        return -1;
+    }
+
+    char* buffer = 0;
+    int size = 0;
+    if (Database_MapFile(path, DB_ADVICE_SEQUENTIAL, &buffer, &size) < 0) {
+        return -1;  // The Database_MapFile function will print the error message
+    }
+    int res = json ? ParseJson(path, buffer, size, source, data) : ParseCsv(path, buffer, size, source, data);
+    Database_UnmapFile(buffer, size);
+    return res;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads all records in a JSON file
+ * Returns 0 on success, and -1 on failure
+ * --------------------------------------------------------------------------------------------------
+ */
+static int ParseJson(const char* path, const char* buffer, int size, int source, CompileData* data)
+{
+    // The error position is taken from the parser, since the global error of cJSON is shared by all threads
+    const char* error_position = 0;
+    cJSON* root = cJSON_ParseWithLengthOpts(buffer, size, &error_position, 0);
+    if (root == 0 || !cJSON_IsObject(root)) {
+        fprintf(stderr, "[%ld] Failed to read %s: Invalid JSON at byte %ld\n", GetLogId(), path,
+                (error_position != 0) ? (long) (error_position - buffer) : 0L);
+        cJSON_Delete(root);
+        return -1;
+    }
+
+    const cJSON* json_athlete = 0;
+    cJSON_ArrayForEach(json_athlete, cJSON_GetObjectItemCaseSensitive(root, "athletes"))
+    {
+        CompileAthlete athlete;
+        memset(&athlete, 0, sizeof(athlete));
+        if (ParseJsonRecord(path, json_athlete, athlete_fields, &athlete) == 0 && AddRecord(data, KIND_ATHLETES, &athlete, source) == -1) {
+            cJSON_Delete(root);
+            return -1;
+        }
+    }
+
+    const cJSON* json_race = 0;
+    cJSON_ArrayForEach(json_race, cJSON_GetObjectItemCaseSensitive(root, "races"))
+    {
+        CompileRace race;
+        memset(&race, 0, sizeof(race));
+        if (ParseJsonRecord(path, json_race, race_fields, &race) != 0) {
+            continue;
+        }
+        unsigned int raceid = race.raceid;
+        if (AddRecord(data, KIND_RACES, &race, source) == -1) {
+            cJSON_Delete(root);
+            return -1;
+        }
+
+        // The results of a race are stored inside the race, so they do not need their own raceid
+        const cJSON* json_result = 0;
+        cJSON_ArrayForEach(json_result, cJSON_GetObjectItemCaseSensitive(json_race, "results"))
+        {
+            CompileResult result;
+            memset(&result, 0, sizeof(result));
+            result.raceid = raceid;
+            if (ParseJsonRecord(path, json_result, result_fields, &result) == 0 && AddRecord(data, KIND_RESULTS, &result, source) == -1) {
+                cJSON_Delete(root);
+                return -1;
+            }
+        }
+    }
+
+    cJSON_Delete(root);
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads the fields of a record from a JSON object. Numbers can be written either as JSON numbers or as strings.
+ * Fields that are missing are left as they are
+ * Returns 0 on success, and -1 if the record is invalid. A warning will be printed
+ * --------------------------------------------------------------------------------------------------
+ */
+static int ParseJsonRecord(const char* path, const cJSON* json, const Field* fields, void* record)
+{
+    if (!cJSON_IsObject(json)) {
+        fprintf(stderr, "[%ld] Warning: Skipped a record in %s: The record is not an object\n", GetLogId(), path);
+        return -1;
+    }
+
+    for (int i = 0; fields[i].name != 0; i++)
+    {
+        const cJSON* item = cJSON_GetObjectItemCaseSensitive(json, fields[i].name);
+        if (item == 0) {
+            continue;
+        }
+
+        char number[32];
+        const char* text = 0;
+        if (cJSON_IsString(item)) {
+            text = item->valuestring;
+        }
+        else if (cJSON_IsNumber(item)) {
+            // Whole numbers are written without decimals, and fispoints with two decimals like in the result lists
+            if (item->valuedouble == (double) (long) item->valuedouble) {
+                snprintf(number, sizeof(number), "%ld", (long) item->valuedouble);
+            } else {
+                snprintf(number, sizeof(number), "%.2f", item->valuedouble);
+            }
+            text = number;
+        }
+        if (text == 0 || SetField(&(fields[i]), record, text, strlen(text)) == -1) {
+            fprintf(stderr, "[%ld] Warning: Skipped a record in %s: The field \"%s\" is invalid\n", GetLogId(), path, fields[i].name);
+            FreeRecord(fields, record);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads all records in a CSV file. The columns are separated by commas, and can be quoted with double quotes
+ * Returns 0 on success, and -1 on failure
+ * --------------------------------------------------------------------------------------------------
+ */
+static int ParseCsv(const char* path, const char* buffer, int size, int source, CompileData* data)
+{
+    const char* columns[MAX_COLUMNS];
+    int column_sizes[MAX_COLUMNS];
+    int offset = 0;
+    char* unquoted = (char*) malloc(size + 1);
+    if (unquoted == 0) {
+        fprintf(stderr, "[%ld] Failed to read %s: Failed to allocate memory\n", GetLogId(), path);
+        return -1;
+    }
+
+    // Skip the byte order mark that spreadsheet programs write at the start of UTF-8 files
+    if (size >= 3 && memcmp(buffer, "\xEF\xBB\xBF", 3) == 0) {
+        offset = 3;
+    }
+
+    // Map every column in the header to a field of the record
+    int columns_size = ReadCsvRow(buffer, size, &offset, columns, column_sizes, unquoted);
+    const Field* header[MAX_COLUMNS];
+    bool has_rank = false;
+    bool has_raceid = false;
+    bool has_fiscode = false;
+    for (int c = 0; c < columns_size; c++) {
+        has_rank = has_rank || (column_sizes[c] == 4 && memcmp(columns[c], "rank", 4) == 0);
+        has_raceid = has_raceid || (column_sizes[c] == 6 && memcmp(columns[c], "raceid", 6) == 0);
+        has_fiscode = has_fiscode || (column_sizes[c] == 7 && memcmp(columns[c], "fiscode", 7) == 0);
+    }
+    int kind = has_rank ? KIND_RESULTS : (has_raceid ? KIND_RACES : (has_fiscode ? KIND_ATHLETES : 0));
+    if (kind == 0) {
+        fprintf(stderr, "[%ld] Failed to read %s: The header has no rank, raceid or fiscode column\n", GetLogId(), path);
+        free(unquoted);
+        return -1;
+    }
+
+    const Field* fields = (kind == KIND_RESULTS) ? result_fields : ((kind == KIND_RACES) ? race_fields : athlete_fields);
+    for (int c = 0; c < columns_size; c++) {
+        header[c] = 0;
+        for (int i = 0; fields[i].name != 0; i++) {
+            if ((int) strlen(fields[i].name) == column_sizes[c] && memcmp(fields[i].name, columns[c], column_sizes[c]) == 0) {
+                header[c] = &(fields[i]);
+            }
+        }
+    }
+
+    int row = 1;
+    while (offset < size)
+    {
+        int row_size = ReadCsvRow(buffer, size, &offset, columns, column_sizes, unquoted);
+        row++;
+        if (row_size == 1 && column_sizes[0] == 0) {
+            continue;  // Empty line
+        }
+
+        CompileAthlete athlete;
+        CompileRace race;
+        CompileResult result;
+        void* record = (kind == KIND_RESULTS) ? (void*) &result : ((kind == KIND_RACES) ? (void*) &race : (void*) &athlete);
+        memset(&athlete, 0, sizeof(athlete));
+        memset(&race, 0, sizeof(race));
+        memset(&result, 0, sizeof(result));
+
+        bool valid = true;
+        for (int c = 0; c < row_size && c < columns_size && valid; c++) {
+            if (header[c] != 0 && SetField(header[c], record, columns[c], column_sizes[c]) == -1) {
+                fprintf(stderr, "[%ld] Warning: Skipped row %d in %s: The column \"%s\" is invalid\n", GetLogId(), row, path, header[c]->name);
+                valid = false;
+            }
+        }
+        if (!valid) {
+            FreeRecord(fields, record);
+            continue;
+        }
+        if (AddRecord(data, kind, record, source) == -1) {
+            free(unquoted);
+            return -1;
+        }
+    }
+    free(unquoted);
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Reads one row of a CSV file, and moves the offset to the next row
+ * The columns point into the file, unless they were quoted. Quoted columns are copied to "unquoted" without the quotes,
+ * and are only valid until the next row is read. "unquoted" has to be as large as the file
+ *
+ * Returns the number of columns in the row
+ * --------------------------------------------------------------------------------------------------
+ */
+static int ReadCsvRow(const char* buffer, int size, int* offset, const char** columns, int* column_sizes, char* unquoted)
+{
+    int unquoted_size = 0;
+    int columns_size = 0;
+    while (true)
+    {
+        const char* start = &(buffer[*offset]);
+        int column_size = 0;
+        bool quoted = (*offset < size && buffer[*offset] == '"');
+        if (quoted)
+        {
+            start = &(unquoted[unquoted_size]);
+            (*offset)++;
+            while (*offset < size) {
+                if (buffer[*offset] == '"' && (*offset + 1 >= size || buffer[*offset + 1] != '"')) {
+                    (*offset)++;
+                    break;
+                }
+                if (buffer[*offset] == '"') {
+                    (*offset)++;  // An escaped quote
+                }
+                unquoted[unquoted_size++] = buffer[(*offset)++];
+                column_size++;
+            }
+        }
+        // Anything between the closing quote and the next comma is ignored
+        while (*offset < size && buffer[*offset] != ',' && buffer[*offset] != '\n' && buffer[*offset] != '\r') {
+            (*offset)++;
+            if (!quoted) {
+                column_size++;
+            }
+        }
+
+        if (columns_size < MAX_COLUMNS) {
+            columns[columns_size] = start;
+            column_sizes[columns_size] = column_size;
+            columns_size++;
+        }
+        if (*offset < size && buffer[*offset] == ',') {
+            (*offset)++;
+            continue;
+        }
+        break;
+    }
+
+    if (*offset < size && buffer[*offset] == '\r') {
+        (*offset)++;
+    }
+    if (*offset < size && buffer[*offset] == '\n') {
+        (*offset)++;
+    }
+    return columns_size;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Sets a field of a record from its text. Strings are normalized, and numbers have to be whole non-negative numbers
+ * Returns 0 on success, and -1 if the text is not valid for the field or the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int SetField(const Field* field, void* record, const char* text, int text_size)
+{
+    char* normalized = NormalizeString(text, text_size);
+    if (normalized == 0) {
+        return -1;
+    }
+
+    if (field->type == FIELD_STRING) {
+        char** dest = (char**) ((char*) record + field->offset);
+        free(*dest);
+        *dest = normalized;
+        return 0;
+    }
+
+    // An empty number is read as 0, like a missing field
+    char* end = normalized;
+    unsigned long value = (normalized[0] != '\0') ? strtoul(normalized, &end, 10) : 0;
+    bool valid = (normalized[0] == '\0' || (normalized[0] >= '0' && normalized[0] <= '9' && *end == '\0' && value <= 0xFFFFFFFFUL));
+    free(normalized);
+    if (!valid) {
+        return -1;
+    }
+    *((unsigned int*) ((char*) record + field->offset)) = (unsigned int) value;
+    return 0;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------------
+ * Adds a record that has been read. Records without their key (fiscode or raceid) are skipped
+ * Returns 0 on success, and -1 if the memory could not be allocated
+ * --------------------------------------------------------------------------------------------------
+ */
+static int AddRecord(CompileData* data, int kind, void* record, int source)
+{
+    int res = 0;
+    if (kind == KIND_ATHLETES) {
+        CompileAthlete* athlete = (CompileAthlete*) record;
+        if (athlete->fiscode == 0) {
+            FreeRecord(athlete_fields, record);
+            return 0;
+        }
+        res = AddAthlete(data, athlete);
+    }
+    else if (kind == KIND_RACES) {
+        CompileRace* race = (CompileRace*) record;
+        if (race->raceid == 0) {
+            FreeRecord(race_fields, record);
+            return 0;
+        }
+        res = AddRace(data, race);
+    }
+    else {
+        CompileResult* result = (CompileResult*) record;
+        if (result->raceid == 0 || result->fiscode == 0) {
+            FreeRecord(result_fields, record);
+            return 0;
+        }
+        result->source = source;
+        res = AddResult(data, result);
+    }
+
+    if (res == -1) {
+        fprintf(stderr, "[%ld] Failed to read the input: Failed to allocate memory\n", GetLogId());
+    }
+    return res;
+}
+
+
+static void FreeRecord(const Field* fields, void* record)
+{
+    for (int i = 0; fields[i].name != 0; i++) {
+        if (fields[i].type == FIELD_STRING) {
+            char** str = (char**) ((char*) record + fields[i].offset);
+            free(*str);
+            *str = 0;
+        }
+    }
+}
+
+
+static bool HasSuffix(const char* str, const char* suffix)
+{
+    int str_size = strlen(str);
+    int suffix_size = strlen(suffix);
+    return str_size >= suffix_size && strcmp(&(str[str_size - suffix_size]), suffix) == 0;
+}
@@ -0,0 +1,386 @@
+#include "DbCompile.h"
+
+#include "../db/Database.h"
+#include "../util/Log.h"
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_THREADS 256
+#define INPUT_PATH_MAX_SIZE 512
+#define DELTA_COMPACT_RACES 100  // About a season of World Cup races. The delta is folded into the database when it has more races than this
+
+#define MODE_COMPILE 0  // Compile the whole database from the input
+#define MODE_APPEND  1  // Append the input to the delta
+#define MODE_COMPACT 2  // Fold the delta into the database
+
+// The input files, that are read by all threads. Every thread takes the next file that has not been read yet
+typedef struct {
+    char** paths;
+    int paths_size;
+    CompileData* files;  // The records of every input file, in the same order as the paths
+    int* results;        // The result of reading every input file
+    int next;
+    pthread_mutex_t lock;
+} InputFiles;
+
+static int ParseArguments(int argc, char** argv, int* mode, int* threads, InputFiles* input);
+static int AddInputPath(InputFiles* input, const char* path);
+static int ReadInputFiles(InputFiles* input, int threads);
+static int MergeInputFiles(InputFiles* input, CompileData* data);
+static int Compact();
+static void StartCompaction();
+static void* RunParser(void* arg);
+static int ComparePaths(const void* a, const void* b);
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * DBCOMPILE
+ *
+ * Compiles the database files in ./db from raw result data, so the database can be updated with new races
+ * Run it from the directory the server runs in. The input is any number of JSON and CSV files, or directories
+ * with JSON and CSV files in them (see "ParseInputFile" and README.md). The files are read in parallel by a pool
+ * of threads, and are then merged in the order they were given, so files that are given later replace the records
+ * of files that are given earlier. The database files are written in the current version of the format,
+ * and are then loaded in the same way as the server loads them, which checks them and writes their index files.
+ * Compiling the whole database removes the delta, since all races are in the input.
+ *
+ * With "-a", the input is appended to the delta instead (see DB_DELTA_DIR in Database.h), which only rewrites the delta,
+ * so new races are added in a moment. Once the delta has more than DELTA_COMPACT_RACES races, it is folded into the database
+ * by a compaction in the background. With "-m", the delta is folded into the database right away.
+ *
+ * Usage: dbcompile [-a] [-j threads] input...
+ *        dbcompile -m
+ * ---------------------------------------------------------------------------
+ */
+int main(int argc, char** argv)
+{
+    setvbuf(stderr, NULL, _IOLBF, BUFSIZ);
+
+    int mode = MODE_COMPILE;
+    int threads = 0;
+    InputFiles input;
+    memset(&input, 0, sizeof(input));
+    if (ParseArguments(argc, argv, &mode, &threads, &input) == -1) {
+        fprintf(stderr, "Usage: %s [-a] [-j threads] input...\n       %s -m\n", argv[0], argv[0]);
+        return 1;
+    }
+    if (mode == MODE_COMPACT) {
+        return (Compact() == -1) ? 1 : 0;
+    }
+
+    // ---------------------------------------------------------------
+    // Read all input files in parallel, before the delta is locked
+    // ---------------------------------------------------------------
+    if (ReadInputFiles(&input, threads) == -1) {
+        return 1;
+    }
+
+    // ---------------------------------------------------------------
+    // Append the input to the delta. The delta is locked from before it is loaded until the new delta has been written
+    // ---------------------------------------------------------------
+    CompileData data;
+    memset(&data, 0, sizeof(data));
+    if (mode == MODE_APPEND)
+    {
+        if (Database_LockDelta(DB_LOCK_EXCLUSIVE) == -1) {
+            return 1;
+        }
+        if (Database_Preload() == -1) {
+            fprintf(stderr, "[%ld] Failed to append to the database: The database has to be compiled and loaded first\n", GetLogId());
+            return 1;
+        }
+        if (LoadDelta(&data) == -1 || MergeInputFiles(&input, &data) == -1) {
+            return 1;
+        }
+        mkdir(DB_DELTA_DIR, 0755);
+        int result = CompileDelta(&data);
+        int races = data.races_size;
+        FreeCompileData(&data);
+        Database_UnlockDelta();
+        if (result == -1) {
+            return 1;
+        }
+        fprintf(stderr, "[%ld] The delta has %d races. Running servers load them in the background\n", GetLogId(), races);
+        if (races > DELTA_COMPACT_RACES) {
+            StartCompaction();
+        }
+        return 0;
+    }
+
+    // ---------------------------------------------------------------
+    // Merge the records of all files in the order they were given, and write the database
+    // ---------------------------------------------------------------
+    if (MergeInputFiles(&input, &data) == -1) {
+        return 1;
+    }
+
+    mkdir("./db", 0755);
+    if (Database_LockDelta(DB_LOCK_EXCLUSIVE) == -1) {
+        return 1;
+    }
+    int result = CompileDatabase(&data);
+    FreeCompileData(&data);
+    if (result == -1 || Database_RemoveDelta() == -1) {
+        return 1;
+    }
+
+    // Loading the database checks the new files, and writes their index files
+    if (Database_Preload() == -1) {
+        fprintf(stderr, "[%ld] Failed to load the compiled database\n", GetLogId());
+        return 1;
+    }
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Reads all input files with a pool of parser threads
+ * Returns 0 on success, and -1 on failure. An error message will be printed
+ * ---------------------------------------------------------------------------
+ */
+static int ReadInputFiles(InputFiles* input, int threads)
+{
+    if (threads > input->paths_size) {
+        threads = input->paths_size;
+    }
+    input->files = (CompileData*) calloc(input->paths_size, sizeof(CompileData));
+    input->results = (int*) calloc(input->paths_size, sizeof(int));
+    if (input->files == 0 || input->results == 0) {
+        fprintf(stderr, "[%ld] Failed to compile the database: Failed to allocate memory\n", GetLogId());
+        return -1;
+    }
+    pthread_mutex_init(&(input->lock), NULL);
+
+    pthread_t thread_ids[MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&(thread_ids[i]), NULL, RunParser, input) != 0) {
+            fprintf(stderr, "[%ld] Warning: Failed to start a parser thread\n", GetLogId());
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        RunParser(input);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(thread_ids[i], NULL);
+    }
+
+    for (int i = 0; i < input->paths_size; i++) {
+        if (input->results[i] == -1) {
+            fprintf(stderr, "[%ld] Failed to compile the database: %s could not be read\n", GetLogId(), input->paths[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Merges the records of all input files into "data", in the order the files were given
+ * Returns 0 on success, and -1 on failure. An error message will be printed
+ * ---------------------------------------------------------------------------
+ */
+static int MergeInputFiles(InputFiles* input, CompileData* data)
+{
+    for (int i = 0; i < input->paths_size; i++) {
+        if (MergeCompileData(data, &(input->files[i])) == -1) {
+            fprintf(stderr, "[%ld] Failed to compile the database: Failed to allocate memory\n", GetLogId());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Folds the delta into the database files with the converter, while the delta is locked
+ * Returns 0 on success, and -1 on failure. An error message will be printed
+ * ---------------------------------------------------------------------------
+ */
+static int Compact()
+{
+    if (Database_LockDelta(DB_LOCK_EXCLUSIVE) == -1) {
+        return -1;
+    }
+    int result = Database_Preload();
+    if (result == 0 && !Database_HasDelta()) {
+        fprintf(stderr, "[%ld] There is no delta to fold into the database\n", GetLogId());
+    }
+    else if (result == 0 && Database_ConvertFormat() == -1) {
+        result = -1;
+    }
+    Database_UnlockDelta();
+    return result;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Starts the compaction in a new process in the background, so that appending returns right away
+ * The process runs "dbcompile -m" again, so that it loads the delta that is there once it has the lock,
+ * and not the delta that this process loaded
+ * ---------------------------------------------------------------------------
+ */
+static void StartCompaction()
+{
+    pid_t pid = fork();
+    if (pid == -1) {
+        fprintf(stderr, "[%ld] Failed to start the compaction: %s. Run \"dbcompile -m\" to fold the delta into the database\n", GetLogId(), strerror(errno));
+        return;
+    }
+    if (pid == 0) {
+        setsid();
+        execl("/proc/self/exe", "dbcompile", "-m", (char*) 0);
+        fprintf(stderr, "[%ld] Failed to start the compaction: %s. Run \"dbcompile -m\" to fold the delta into the database\n", GetLogId(), strerror(errno));
+        _exit(1);
+    }
+    fprintf(stderr, "[%ld] Folding the delta into the database in the background (process %ld)\n", GetLogId(), (long) pid);
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Parses the arguments. The input paths are expanded, so every directory is replaced by the JSON and CSV files
+ * in it, sorted by name. "-m" takes no input
+ * Returns 0 on success, and -1 if the arguments are invalid
+ * ---------------------------------------------------------------------------
+ */
+static int ParseArguments(int argc, char** argv, int* mode, int* threads, InputFiles* input)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    *threads = (cores > 0) ? (int) cores : 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "amj:")) != -1)
+    {
+        if (opt == 'a') {
+            *mode = MODE_APPEND;
+        }
+        else if (opt == 'm') {
+            *mode = MODE_COMPACT;
+        }
+        else if (opt == 'j') {
+            char* end = 0;
+            long value = strtol(optarg, &end, 10);
+            if (*end != '\0' || value < 1) {
+                fprintf(stderr, "Invalid number of threads: %s\n", optarg);
+                return -1;
+            }
+            *threads = (int) value;
+        }
+        else {
+            return -1;
+        }
+    }
+    if (*threads > MAX_THREADS) {
+        *threads = MAX_THREADS;
+    }
+    if (*mode == MODE_COMPACT) {
+        return (optind == argc) ? 0 : -1;
+    }
+    if (optind >= argc) {
+        return -1;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        if (AddInputPath(input, argv[i]) == -1) {
+            return -1;
+        }
+    }
+    if (input->paths_size == 0) {
+        fprintf(stderr, "No JSON or CSV files were found in the input\n");
+        return -1;
+    }
+    return 0;
+}
+
+
+static int AddInputPath(InputFiles* input, const char* path)
+{
+    struct stat info;
+    if (stat(path, &info) == -1) {
+        fprintf(stderr, "Could not find the input: %s\n", path);
+        return -1;
+    }
+
+    if (!S_ISDIR(info.st_mode))
+    {
+        char** paths = (char**) realloc(input->paths, (input->paths_size + 1) * sizeof(char*));
+        if (paths == 0 || (paths[input->paths_size] = strdup(path)) == 0) {
+            fprintf(stderr, "Failed to allocate memory\n");
+            if (paths != 0) input->paths = paths;
+            return -1;
+        }
+        input->paths = paths;
+        input->paths_size++;
+        return 0;
+    }
+
+    DIR* dir = opendir(path);
+    if (dir == 0) {
+        fprintf(stderr, "Could not open the directory: %s\n", path);
+        return -1;
+    }
+    int first = input->paths_size;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != 0)
+    {
+        int size = strlen(entry->d_name);
+        bool json = size > 5 && strcmp(&(entry->d_name[size - 5]), ".json") == 0;
+        bool csv = size > 4 && strcmp(&(entry->d_name[size - 4]), ".csv") == 0;
+        if (!json && !csv) {
+            continue;
+        }
+        char file_path[INPUT_PATH_MAX_SIZE];
+        snprintf(file_path, sizeof(file_path), "%s/%s", path, entry->d_name);
+        if (AddInputPath(input, file_path) == -1) {
+            closedir(dir);
+            return -1;
+        }
+    }
+    closedir(dir);
+
+    // The files in a directory are read in the order of their names, e.g. one file per season
+    qsort(&(input->paths[first]), input->paths_size - first, sizeof(char*), ComparePaths);
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Runs in every parser thread. Reads input files until all files have been taken
+ * ---------------------------------------------------------------------------
+ */
+static void* RunParser(void* arg)
+{
+    InputFiles* input = (InputFiles*) arg;
+    while (true)
+    {
+        pthread_mutex_lock(&(input->lock));
+        int i = input->next++;
+        pthread_mutex_unlock(&(input->lock));
+        if (i >= input->paths_size) {
+            break;
+        }
+        input->results[i] = ParseInputFile(input->paths[i], i, &(input->files[i]));
+    }
+    return 0;
+}
+
+
+static int ComparePaths(const void* a, const void* b)
+{
+    return strcmp(*((char* const*) a), *((char* const*) b));
+}
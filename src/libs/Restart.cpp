@@ -98,6 +98,31 @@ ssize_t r_write(int fd, void *buf, size_t size) {
    return totalbytes;
 }
 
+/* The iovec array is modified to skip over the bytes already written */
+ssize_t r_writev(int fd, struct iovec *iov, int iovcnt) {
+   ssize_t byteswritten;
+   size_t totalbytes;
+
+   for (totalbytes = 0; iovcnt > 0; ) {
+      byteswritten = writev(fd, iov, iovcnt);
+      if ((byteswritten) == -1 && (errno != EINTR))
+         return -1;
+      if (byteswritten == -1)
+         byteswritten = 0;
+      totalbytes += byteswritten;
+      while (iovcnt > 0 && (size_t)byteswritten >= iov->iov_len) {
+         byteswritten -= iov->iov_len;
+         iov++;
+         iovcnt--;
+      }
+      if (iovcnt > 0) {
+         iov->iov_base = (char *)iov->iov_base + byteswritten;
+         iov->iov_len -= byteswritten;
+      }
+   }
+   return totalbytes;
+}
+
 /* Utility functions */
 
 struct timeval add2currenttime(double seconds) {
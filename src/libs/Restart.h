@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #ifndef ETIME
 #define ETIME ETIMEDOUT
@@ -20,6 +21,7 @@ ssize_t r_read(int fd, void *buf, size_t size);
 pid_t r_wait(int *stat_loc);
 pid_t r_waitpid(pid_t pid, int *stat_loc, int options);
 ssize_t r_write(int fd, void *buf, size_t size);
+ssize_t r_writev(int fd, struct iovec *iov, int iovcnt);
 ssize_t readblock(int fd, void *buf, size_t size);
 int readline(int fd, char *buf, int nbytes);
 ssize_t readtimed(int fd, void *buf, size_t nbyte, double seconds);
@@ -45,6 +45,23 @@ static int u_ignore_sigpipe() {
  *           -1 on error and sets errno
  */
 int u_open(u_port_t port) {
+   return u_open_listener(port, MAXBACKLOG, 0);
+}
+
+/*
+ *                           u_open_listener
+ * Return a file descriptor, which is bound to the given port and
+ * listening with the given backlog.
+ *
+ * parameters:
+ *        port = number of port to bind to
+ *        backlog = max number of pending connections, MAXBACKLOG if <= 0
+ *        flags = U_REUSEPORT to let several sockets bind to the same port,
+ *                so the kernel load-balances new connections between them
+ * returns:  file descriptor if successful
+ *           -1 on error and sets errno
+ */
+int u_open_listener(u_port_t port, int backlog, int flags) {
    int error;  
    struct sockaddr_in server;
    int sock;
@@ -59,12 +76,30 @@ int u_open(u_port_t port) {
       errno = error;
       return -1;
    }
+
+   if (flags & U_REUSEPORT) {
+#ifdef SO_REUSEPORT
+      if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (char *)&_true, sizeof(_true)) == -1) {
+         error = errno;
+         while ((close(sock) == -1) && (errno == EINTR)); 
+         errno = error;
+         return -1;
+      }
+#else
+      while ((close(sock) == -1) && (errno == EINTR)); 
+      errno = ENOPROTOOPT;
+      return -1;
+#endif
+   }
+
+   if (backlog <= 0)
+      backlog = MAXBACKLOG;
  
    server.sin_family = AF_INET;
    server.sin_addr.s_addr = htonl(INADDR_ANY);
    server.sin_port = htons((short)port);
    if ((bind(sock, (struct sockaddr *)&server, sizeof(server)) == -1) ||
-        (listen(sock, MAXBACKLOG) == -1)) {
+        (listen(sock, backlog) == -1)) {
       error = errno;
       while ((close(sock) == -1) && (errno == EINTR)); 
       errno = error;
@@ -107,6 +142,27 @@ int u_accept(int fd, char *hostn, int hostnsize) {
    return retval;
 }
 
+/*
+ *                           u_accept_numeric
+ * Wait for a connection request from a host on a specified port.
+ * Same as u_accept, except that hostn is filled with the numeric
+ * address of the remote host (e.g. "127.0.0.1") instead of its name.
+ * No name lookup is done, so this never waits for DNS.
+ */
+int u_accept_numeric(int fd, char *hostn, int hostnsize) {
+   int len = sizeof(struct sockaddr);
+   struct sockaddr_in netclient;
+   int retval;
+
+   while (((retval =
+           accept(fd, (struct sockaddr *)(&netclient), (socklen_t *)(&len))) == -1) && (errno == EINTR)) ;  
+   if ((retval == -1) || (hostn == NULL) || (hostnsize <= 0))
+      return retval;
+   if (inet_ntop(AF_INET, &(netclient.sin_addr), hostn, hostnsize) == NULL)
+      hostn[0] = 0;
+   return retval;
+}
+
 /*
  *                           u_connect
  * Initiate communication with a remote server.
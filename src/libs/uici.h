@@ -8,10 +8,13 @@
 #define REENTRANT_MUTEX 2
 #define REENTRANT_POSIX 3
 #define UPORT
+#define U_REUSEPORT 1
 typedef unsigned short u_port_t;
 
 int u_open(u_port_t port);
+int u_open_listener(u_port_t port, int backlog, int flags);
 int u_accept(int fd, char *hostn, int hostnsize);
+int u_accept_numeric(int fd, char *hostn, int hostnsize);
 int u_connect(u_port_t port, char *hostn);
 
 // Handles conversion between address name and byte address
@@ -1,15 +1,21 @@
 
 
 #include "./server/Server.h"
+#include "./StaticFile.h"
+#include "./db/Database.h"
 #include "./libs/Restart.h"
 #include "./libs/uici.h"
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <signal.h>
 #include <string.h>
+#include <sys/socket.h>
 
 #define DEFAULT_PORT 80
-#define BUFFER_SIZE 32768
+
+static int ParseArguments(int argc, char** argv, ServerConfig* config);
+static void HandleReloadSignal(int signo);
 
 
 /**
@@ -17,107 +23,201 @@
  * MAIN
  *
  * This program is an HTTP Server that listens on a given port.
- * All client requests are handled in separate child processes, 
- * while the parent process is used to listen for new connections.
- * --------------------------------------------------------------------------- 
+ * By default, the clients are served by a pool of long-lived worker processes,
+ * while the parent process supervises the workers and restarts any worker that dies.
+ * With "-m event", every worker instead runs a non-blocking event loop that serves many clients at once.
+ * With "-m thread", the clients are instead served by a pool of threads in a single process.
+ * The old behaviour, where every client is handled in a new child process, can be used with "-m fork"
+ * The database is reloaded in the background when its files are replaced, or when the server gets SIGHUP.
+ * Requests that are running finish with the database they started with
+ * With "-c", the database files are converted to the current version of the v2 format, and the delta with the races
+ * that have been appended since the database was compiled is folded into them. The server is not started
+ *
+ * Usage: backend [-m fork|prefork|event|thread] [-w workers] [-b backlog] [-r] [-d] [-c] [port]
+ * ---------------------------------------------------------------------------
  */
 int main(int argc, char** argv)
 {
-    int MAX_CANON = 255;
-    int fd_listen, fd_active;
-    char client[MAX_CANON];
-    pid_t childpid;
-    int bytes;
+    int fd_listen;
+
+    // Make sure every log message is written as a whole line, so that messages from different threads and processes do not interleave
+    setvbuf(stderr, NULL, _IOLBF, BUFSIZ);
+
+    ServerConfig config;
+    config.port = DEFAULT_PORT;
+    if (ParseArguments(argc, argv, &config) == -1) {
+        fprintf(stderr, "Usage: %s [-m fork|prefork|event|thread] [-w workers] [-b backlog] [-r] [-d] [-c] [port]\n", argv[0]);
+        return 1;
+    }
+
+    // Convert the database files, without opening the listening socket
+    // The delta is locked from before it is loaded until it is removed, so no races are appended to it in between
+    if (config.convert_database) {
+        if (Database_LockDelta(DB_LOCK_EXCLUSIVE) == -1) {
+            return 1;
+        }
+        int result = Database_Preload();
+        if (Database_ConvertFormat() == -1) {
+            result = -1;
+        }
+        Database_UnlockDelta();
+        return (result == -1) ? 1 : 0;
+    }
 
     // --------------------------------------------------------
     // Open a file descriptor for listening for connections
     // --------------------------------------------------------
-    u_port_t portnumber = DEFAULT_PORT;
-    if (argc == 2) {
-        portnumber = (u_port_t) atoi(argv[1]); 
-        if (portnumber < 0) portnumber = (u_port_t) DEFAULT_PORT;
-    }
-    
-    if ((fd_listen = u_open(portnumber)) == -1) {
+    int flags = config.reuseport ? U_REUSEPORT : 0;
+    if ((fd_listen = u_open_listener(config.port, config.backlog, flags)) == -1) {
         perror("Failed to create listening endpoint");
         return 1;
     }
-    fprintf(stderr, "[PARENT] Waiting for connection on port: %d\n", (int)portnumber);
-   
-    while (true)
-    {
-        // Accept a new connection and fork a new process used to handle the connected client
-        if ((fd_active = u_accept(fd_listen, client, MAX_CANON)) == -1) {
-            perror("Failed to accept connection");
-            continue;
-        }
-        if ((childpid = fork()) == -1) {
-            perror("Failed to fork child process");
-            continue;
-        }
+    // With SO_REUSEPORT every worker opens its own listening socket.
+    // The socket above only makes sure the port can be used, and is closed so that no connections are queued on it
+    if (config.reuseport) {
+        r_close(fd_listen);
+        fd_listen = -1;
+    }
+    fprintf(stderr, "[PARENT] Waiting for connection on port: %d\n", (int)config.port);
 
-        // -----------------------------------------------------------------------------
-        // Child: 
-        // Read the received messasge and handle the connected client
-        // Close the file descriptor that is used to listen for new connections
-        // -----------------------------------------------------------------------------
-        if (childpid == 0)
-        {
-            fprintf(stderr, "[%ld] Client connected: %s\n", (long)getpid(), client);
-            if (r_close(fd_listen) == -1) {
-                fprintf(stderr, "[%ld] Failed to close fd_listen: %s. Closing connection...\n", (long)getpid(), strerror(errno));
-                fprintf(stderr, "[%ld] %s disconnected\n", (long)getpid(), client);
-                return 1;
-            }
-            
-            
-            // Read and parse the message received from the client over the socket
-            Request request;
-            if (ReadClientRequest(fd_active, &request) == -1) {
-                fprintf(stderr, "[%ld] Failed to read and parse client request: Closing connection...\n", (long)getpid());
-                fprintf(stderr, "[%ld] %s disconnected\n", (long)getpid(), client);
-                return 1;
-            }
+    // Clients are logged by their numeric address, unless their names should be looked up
+    SetClientNameResolution(config.resolve_names);
 
+    // Load and index the database once, so that it is shared by all workers instead of being read for every request
+    if (Database_Preload() == -1) {
+        fprintf(stderr, "[PARENT] Failed to preload the database: Requests for the data in the files that failed will fail\n");
+    }
 
-            if (request.query) {
-                fprintf(stderr, "[%ld] Client request line: %s %s?%s %s\n", (long)getpid(), request.method, request.path, request.query, request.protocol);
-            } else {
-                fprintf(stderr, "[%ld] Client request line: %s %s %s\n", (long)getpid(), request.method, request.path, request.protocol);
-            }
+    // Reload the database when its files are replaced, or on SIGHUP. In the prefork and event modes only this process
+    // watches the files, and the workers load the new files once they have been checked and indexed here
+    if (config.mode == SERVER_MODE_PREFORK || config.mode == SERVER_MODE_EVENT) {
+        Database_SetReloadListener(ReloadWorkers);
+    }
+    struct sigaction act;
+    act.sa_handler = HandleReloadSignal;
+    act.sa_flags = SA_RESTART;
+    sigemptyset(&act.sa_mask);
+    if (sigaction(SIGHUP, &act, NULL) == -1 || Database_StartReloader(true) == -1) {
+        fprintf(stderr, "[PARENT] The database will not be reloaded while the server runs\n");
+    }
 
+    // Open the static files once, so they can be sent directly from the open files by all workers
+    if (StaticFile_OpenAll() == -1) {
+        fprintf(stderr, "[PARENT] Failed to open some of the static files\n");
+    }
 
-            // Handle the client request and respond to it
-            if (HandleClientRequest(fd_active, &request) == -1) {
-                fprintf(stderr, "[%ld] Failed to handle the client request: Closing connection...\n", (long)getpid());
-                fprintf(stderr, "[%ld] %s disconnected\n", (long)getpid(), client);
-                if (request.buffer) { free(request.buffer); }
-                return 1;
-            }
+    if (config.mode == SERVER_MODE_FORK) {
+        return RunServer_Fork(fd_listen) == -1 ? 1 : 0;
+    }
 
-        
-            fprintf(stderr, "[%ld] %s disconnected\n", (long)getpid(), client);
-            if (request.buffer) { free(request.buffer); }
-            return 0;
-        }
-        
-        // -----------------------------------------------------------------------------
-        // Parent: 
-        // Close the file descriptor that the client is connected on
-        // Wait for zombie processes and restart the loop to wait for new connections
-        // -----------------------------------------------------------------------------
-        if (r_close(fd_active) == -1) {
-            fprintf(stderr, "[PARENT] Failed to close fd_active: %s\n", strerror(errno));
-        }
-        while (r_waitpid(-1, NULL, WNOHANG) > 0);  // Clean up zombies (non-blocking)
+    if (config.mode == SERVER_MODE_THREAD) {
+        fprintf(stderr, "[PARENT] Starting %d threads\n", config.workers);
+        return RunServer_Thread(fd_listen, config.workers) == -1 ? 1 : 0;
     }
 
-    return 0;
+    fprintf(stderr, "[PARENT] Starting %d worker processes\n", config.workers);
+    if (config.mode == SERVER_MODE_EVENT) {
+        return RunServer_Event(fd_listen, &config) == -1 ? 1 : 0;
+    }
+    return RunServer_Prefork(fd_listen, &config) == -1 ? 1 : 0;
 }
 
 
+/**
+ * ----------------------------------------------------------------------------
+ * Parses the command line arguments into the server config
+ *
+ * -m: The server mode, either "fork" (one process per connection), "prefork" (a pool of workers)
+ *     "event" (a pool of workers that each run an event loop) or "thread" (a pool of threads)
+ * -w: The number of worker processes, or threads. Defaults to the number of cores
+ * -b: The max number of pending connections on the listening socket. Defaults to SOMAXCONN
+ * -r: Every worker process opens its own listening socket with SO_REUSEPORT. Only used with "prefork" and "event"
+ * -d: Look up the names of the clients in the background, and use them in the logs instead of the numeric addresses
+ * -c: Convert the database files to the current version of the v2 format, fold the delta into them, and exit
+ * The last argument is an optional port number
+ *
+ * Returns 0 on success, and -1 if the arguments are invalid
+ * ----------------------------------------------------------------------------
+ */
+static int ParseArguments(int argc, char** argv, ServerConfig* config)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "m:w:b:rdc")) != -1)
+    {
+        if (opt == 'm') {
+            if (strcmp(optarg, "fork") == 0) {
+                config->mode = SERVER_MODE_FORK;
+            } else if (strcmp(optarg, "prefork") == 0) {
+                config->mode = SERVER_MODE_PREFORK;
+            } else if (strcmp(optarg, "event") == 0) {
+                config->mode = SERVER_MODE_EVENT;
+            } else if (strcmp(optarg, "thread") == 0) {
+                config->mode = SERVER_MODE_THREAD;
+            } else {
+                fprintf(stderr, "Invalid server mode: %s\n", optarg);
+                return -1;
+            }
+        }
+        else if (opt == 'w') {
+            config->workers = atoi(optarg);
+            if (config->workers <= 0) {
+                fprintf(stderr, "Invalid number of workers: %s\n", optarg);
+                return -1;
+            }
+        }
+        else if (opt == 'b') {
+            config->backlog = atoi(optarg);
+            if (config->backlog <= 0) {
+                fprintf(stderr, "Invalid backlog: %s\n", optarg);
+                return -1;
+            }
+        }
+        else if (opt == 'r') {
+            config->reuseport = true;
+        }
+        else if (opt == 'd') {
+            config->resolve_names = true;
+        }
+        else if (opt == 'c') {
+            config->convert_database = true;
+        }
+        else {
+            return -1;
+        }
+    }
 
+    if (config->reuseport && config->mode != SERVER_MODE_PREFORK && config->mode != SERVER_MODE_EVENT) {
+        fprintf(stderr, "SO_REUSEPORT listeners (-r) can only be used with the prefork and event modes\n");
+        return -1;
+    }
+    if (config->backlog == 0) {
+        config->backlog = SOMAXCONN;
+    }
 
+    if (optind < argc) {
+        int port = atoi(argv[optind]);
+        if (port > 0 && port <= 65535) {
+            config->port = (u_port_t) port;
+        }
+    }
 
+    // Use one worker for each core if the number of workers was not given
+    if (config->workers == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        config->workers = (cores > 0) ? (int) cores : 1;
+    }
 
+    return 0;
+}
 
+
+/**
+ * ----------------------------------------------------------------------------
+ * Signal handler for SIGHUP, that reloads the database in the background
+ * ----------------------------------------------------------------------------
+ */
+static void HandleReloadSignal(int signo)
+{
+    (void) signo;
+    Database_RequestReload();
+}
@@ -1,16 +1,17 @@
 
 #include "CreatePages.h"
 
-#include "../LoadFile.h"
+#include "../StaticFile.h"
 #include "../db/Database.h"
 #include "../util/RaceTime.h"
+#include "../util/Log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
-static int GetRaceData_FromRaceInfo(RaceData* raceData, unsigned int raceid, int* start_byte, char* race_info_buffer, int race_info_buffer_size);
-static int GetRaceData_FromRaceResults(RaceData* raceData, unsigned int raceid, int* start_byte, unsigned int fiscode, char* race_results_buffer, int race_results_buffer_size);
+static int GetRaceData_FromRaceInfo(RaceData* raceData, unsigned int raceid);
+static int GetRaceData_FromAthleteResult(RaceData* raceData, const RaceIdsRecord* race_ids, int i);
 
 
 /**
@@ -29,7 +30,7 @@ static int GetRaceData_FromRaceResults(RaceData* raceData, unsigned int raceid,
 int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
 {
     if (*PageBuffer != 0) {
-        fprintf(stderr, "[%ld] Failed to create page for Athlete: the buffer parameter needs to be set to 0\n", (long)getpid());
+        fprintf(stderr, "[%ld] Failed to create page for Athlete: the buffer parameter needs to be set to 0\n", GetLogId());
         return -1;
     }
 
@@ -45,53 +46,30 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
         return res;
     }
 
-    unsigned int* raceids = 0;
-    int number_of_raceids = 0;
-    if ((res = LoadFromDatabase_RaceIds(fiscode, &raceids, &number_of_raceids)) < 0) {
-        // The LoadFromDatabase function will print the error message
-        // If it returned -1, then it is a server error.
+    // The race list also has the result of the athlete in every race, so no result list has to be searched
+    RaceIdsRecord race_ids;
+    if ((res = Database_FindRaceIds(fiscode, &race_ids)) < 0) {
+        // If it returned -1, then it is a server error, and the Database_FindRaceIds function printed the error message
         // If it returned -2, then the raceids/athlete was not found
+        if (res == -2) {
+            fprintf(stderr, "[%ld] Failed to load Race Ids from the database: could not find athlete with fiscode %d in the database\n", GetLogId(), fiscode);
+        }
         return res;
     }
+    int number_of_raceids = race_ids.raceids_size;
 
 
     // -----------------------------------------------------------------------------
-    // Load the race files, and the template file
+    // Load the template file. The races are looked up in the database while the page is created
     // -----------------------------------------------------------------------------
-    char FILE_RACEINFO[] = DB_RACE_INFO;
-    char* race_info_buffer = 0;
-    int race_info_buffer_size = 0;
-
-    if (LoadFile(FILE_RACEINFO, &race_info_buffer, &race_info_buffer_size) < 0) 
-    {
-        if (raceids) { free(raceids); }
-        if (race_info_buffer) { free(race_info_buffer); }
-        return -1;  // The LoadFile function will print the error message
-    }
-
-    char FILE_RESULTS[] = DB_RACE_RESULTS;
-    char* race_results_buffer = 0;
-    int race_results_buffer_size = 0;
-    
-    if (LoadFile(FILE_RESULTS, &race_results_buffer, &race_results_buffer_size) < 0) 
-    {
-        if (raceids) { free(raceids); }
-        if (race_info_buffer) { free(race_info_buffer); }
-        if (race_results_buffer) { free(race_results_buffer); }
-        return -1;  // The LoadFile function will print the error message
-    }
-    
     char FILE_TEMPLATE[] = TEMPLATE_ATHLETE;
     char* template_buffer = 0;
     int template_buffer_size = 0;
     
-    if (LoadFile(FILE_TEMPLATE, &template_buffer, &template_buffer_size) < 0) 
+    if (StaticFile_LoadContent(FILE_TEMPLATE, &template_buffer, &template_buffer_size) < 0) 
     {
         // The LoadFile function will print the error message
-        if (raceids) { free(raceids); }
-        if (race_info_buffer) { free(race_info_buffer); }
-        if (race_results_buffer) { free(race_results_buffer); }
-        if (template_buffer) { free(template_buffer); }
+        StaticFile_FreeContent(template_buffer);
         return -1;
     }
 
@@ -108,11 +86,8 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
 
     if ((*PageBuffer = (char*) malloc(*PageBuffer_size * sizeof(char))) == 0) 
     {
-        fprintf(stderr, "[%ld] Failed to create page for Athlete: failed to allocate memory for the page\n", (long)getpid());
-        if (raceids) { free(raceids); }
-        if (race_info_buffer) { free(race_info_buffer); }
-        if (race_results_buffer) { free(race_results_buffer); }
-        if (template_buffer) { free(template_buffer); }
+        fprintf(stderr, "[%ld] Failed to create page for Athlete: failed to allocate memory for the page\n", GetLogId());
+        StaticFile_FreeContent(template_buffer);
         return -1;
     }
 
@@ -137,15 +112,20 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
         }
 
         // A placeholder was detected
-        // Attempt to create a substring for the placeholder text
+        // Attempt to copy the placeholder text, so that the template itself is never modified
         currentByte += 2;
         char* placeholder = 0;
+        char placeholder_text[PLACEHOLDER_MAX_SIZE];
         int placeholder_start = currentByte;
 
         while (currentByte < template_buffer_size) {
             if (template_buffer[currentByte] == '}') {
-                placeholder = &(template_buffer[placeholder_start]);
-                template_buffer[currentByte] = '\0';
+                int placeholder_size = currentByte - placeholder_start;
+                if (placeholder_size < PLACEHOLDER_MAX_SIZE) {
+                    memcpy(placeholder_text, &(template_buffer[placeholder_start]), placeholder_size);
+                    placeholder_text[placeholder_size] = '\0';
+                    placeholder = &(placeholder_text[0]);
+                }
                 currentByte++;
                 break;
             }
@@ -208,23 +188,20 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
             // --------------------------------------------------------------
             else if (strcmp(placeholder, "ATHLETE_RACES") == 0)
             {
-                int raceinfo_currentByte = 0;     // Tracks the last visited index inside the buffer in order to speed up the next search
-                int raceresults_currentByte = 0;  // Tracks the last visited index inside the buffer in order to speed up the next search
-                
                 for (int i = 0; i < number_of_raceids; i++)
                 {
-                    unsigned int raceid = raceids[i];
+                    unsigned int raceid = Database_GetRaceId(&race_ids, i);
                     RaceData raceData;
 
                     // Find the race info data for the current raceid
-                    if (GetRaceData_FromRaceInfo(&raceData, raceid, &raceinfo_currentByte, race_info_buffer, race_info_buffer_size) == -1) {
-                        fprintf(stderr, "[%ld] Warning: Race skipped while creating javascript array: Failed to find race info for race %u in the database\n", (long)getpid(), raceid);
+                    if (GetRaceData_FromRaceInfo(&raceData, raceid) == -1) {
+                        fprintf(stderr, "[%ld] Warning: Race skipped while creating javascript array: Failed to find race info for race %u in the database\n", GetLogId(), raceid);
                         continue;   
                     }
             
                     // Find the race result data for the current raceid, from the perspective of the given athlete
-                    if (GetRaceData_FromRaceResults(&raceData, raceid, &raceresults_currentByte, fiscode, race_results_buffer, race_results_buffer_size) == -1) {
-                        fprintf(stderr, "[%ld] Warning: Race skipped while creating javascript array: Failed to find race results for race %u in the database\n", (long)getpid(), raceid);
+                    if (GetRaceData_FromAthleteResult(&raceData, &race_ids, i) == -1) {
+                        fprintf(stderr, "[%ld] Warning: Race skipped while creating javascript array: Failed to find race results for race %u in the database\n", GetLogId(), raceid);
                         continue;   
                     }
                     
@@ -270,7 +247,7 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
                     {
                         char start[] = "\"nation\": \"";
                         char end[] = "\",";
-                        char* p = &(raceData.nation[0]);
+                        const char* p = Database_GetDictionaryString(raceData.nation);
 
                         WriteToBuffer(&(start[0]), PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
                         WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
@@ -281,7 +258,7 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
                     {
                         char start[] = "\"category\": \"";
                         char end[] = "\",";
-                        char* p = &(raceData.category[0]);
+                        const char* p = Database_GetDictionaryString(raceData.category);
 
                         WriteToBuffer(&(start[0]), PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
                         WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
@@ -292,7 +269,7 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
                     {
                         char start[] = "\"discipline\": \"";
                         char end[] = "\",";
-                        char* p = &(raceData.discipline[0]);
+                        const char* p = Database_GetDictionaryString(raceData.discipline);
 
                         WriteToBuffer(&(start[0]), PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
                         WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
@@ -303,7 +280,7 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
                     {
                         char start[] = "\"type\": \"";
                         char end[] = "\",";
-                        char* p = &(raceData.type[0]);
+                        const char* p = Database_GetDictionaryString(raceData.type);
 
                         WriteToBuffer(&(start[0]), PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
                         WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
@@ -452,30 +429,31 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
             // -------------------------------------------------------------------------------------------------------
             else if (strcmp(placeholder, "ANALYZED_RACES_SPRINT") == 0)
             {
-                int raceinfo_currentByte = 0;     // Tracks the last visited index inside the buffer in order to speed up the next search
-                int raceresults_currentByte = 0;  // Tracks the last visited index inside the buffer in order to speed up the next search
-                
+                // The races are filtered by the dictionary code of their type, so no strings are compared for every race
+                DictionaryCode sprint_qualification = 0;
+                bool has_sprint_qualifications = (Database_FindDictionaryCode("SQ", &sprint_qualification) == 0);
+
                 int sprint_race_counter = 0;
                 for (int i = 0; i < number_of_raceids; i++)
                 {
-                    unsigned int raceid = raceids[i];
+                    unsigned int raceid = Database_GetRaceId(&race_ids, i);
                     RaceData raceData;
 
                     // Find the race info data for the current raceid
-                    if (GetRaceData_FromRaceInfo(&raceData, raceid, &raceinfo_currentByte, race_info_buffer, race_info_buffer_size) == -1) {
-                        fprintf(stderr, "[%ld] Warning: Race skipped while creating Athlete Page: Failed to find race info for race %u in the database\n", (long)getpid(), raceid);
+                    if (GetRaceData_FromRaceInfo(&raceData, raceid) == -1) {
+                        fprintf(stderr, "[%ld] Warning: Race skipped while creating Athlete Page: Failed to find race info for race %u in the database\n", GetLogId(), raceid);
                         continue;   
                     }
 
                     // Only use races that are of the type: Sprint Qualification
-                    if (strcmp(raceData.type, "SQ") != 0) {
+                    if (!has_sprint_qualifications || raceData.type != sprint_qualification) {
                         continue;
                     }
                     sprint_race_counter++;
             
                     // Find the race result data for the current raceid, from the perspective of the given athlete
-                    if (GetRaceData_FromRaceResults(&raceData, raceid, &raceresults_currentByte, fiscode, race_results_buffer, race_results_buffer_size) == -1) {
-                        fprintf(stderr, "[%ld] Warning: Race skipped while creating Athlete Page: Failed to find race results for race %u in the database\n", (long)getpid(), raceid);
+                    if (GetRaceData_FromAthleteResult(&raceData, &race_ids, i) == -1) {
+                        fprintf(stderr, "[%ld] Warning: Race skipped while creating Athlete Page: Failed to find race results for race %u in the database\n", GetLogId(), raceid);
                         continue;   
                     }
                     
@@ -517,10 +495,7 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
                     {
                         char div_start[] = "<div class='sprint-result-field location-field'>";
                         char location[512];
-                        strcpy(location, raceData.location);
-                        strcat(location, " (");
-                        strcat(location, raceData.nation);
-                        strcat(location, ")");
+                        snprintf(location, sizeof(location), "%s (%s)", raceData.location, Database_GetDictionaryString(raceData.nation));
 
                         WriteToBuffer(&(div_start[0]), PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
                         WriteToBuffer(&(location[0]), PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
@@ -530,7 +505,7 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
                     // CATEGORY
                     {
                         char div_start[] = "<div class='sprint-result-field category-field'>";
-                        char* p = &(raceData.category[0]);
+                        const char* p = Database_GetDictionaryString(raceData.category);
 
                         WriteToBuffer(&(div_start[0]), PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
                         WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
@@ -653,10 +628,7 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
     }
     *PageBuffer_size = PageBuffer_currentByte;
 
-    if (raceids) { free(raceids); }
-    if (race_info_buffer) { free(race_info_buffer); }
-    if (race_results_buffer) { free(race_results_buffer); }
-    if (template_buffer) { free(template_buffer); }
+    StaticFile_FreeContent(template_buffer);
     
     return 0;
 }
@@ -665,298 +637,56 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size)
 /**
  * -------------------------------------------------------------------------------------------------------------------------------
  *  Gets the race info for the given race id
- *  The function will look though the race_info_buffer for the given race id, and the requierd data will then be stored in the RaceData object
+ *  The race is looked up in the database, and the requierd data will then be stored in the RaceData object
  *
  *  raceData: The object that will store the race info data
  *  raceid: The id of the requested race
- *  start_byte: The position in the buffer the search should start from. 
- *              This index should be stored from the last time this function was called, in order to speed up the current search 
- *  race_info_buffer: This buffer should contain the full file from the database that contains all the data related to race info
- *  race_info_buffer_size: The size of the buffer
  *
  *  Returns 0 on success, the race was found and the data was stored inside the RaceData object
  *  Returns -1 if the requested race was not found
  * -------------------------------------------------------------------------------------------------------------------------------
  */
-static int GetRaceData_FromRaceInfo(RaceData* raceData, unsigned int raceid, int* start_byte, char* race_info_buffer, int race_info_buffer_size)
+static int GetRaceData_FromRaceInfo(RaceData* raceData, unsigned int raceid)
 {
-    int currentByte = *start_byte;
-    while (currentByte < race_info_buffer_size)
-    {
-        // Make sure it is possible to read the next 4 bytes
-        if (currentByte + 3 >= race_info_buffer_size) {
-            break;
-        }
-
-        // Read the current raceid
-        unsigned char bytes[4];
-        bytes[0] = race_info_buffer[currentByte++];
-        bytes[1] = race_info_buffer[currentByte++];
-        bytes[2] = race_info_buffer[currentByte++];
-        bytes[3] = race_info_buffer[currentByte++];
-        unsigned int currentRaceid = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-        if (currentRaceid != raceid)
-        {
-            // Skip past all the bytes for the current race
-            currentByte += 4;
-            int string_counter = 0;
-            while (string_counter < 7 && currentByte < race_info_buffer_size) {
-                if (race_info_buffer[currentByte++] == '\0') {
-                    string_counter++;
-                }
-            }
-        }
-        else 
-        {
-            // Skip the codex
-            currentByte += 4;
-
-            // Date
-            int str_index = 0;
-            while (currentByte < race_info_buffer_size && race_info_buffer[currentByte++] != '\0' && str_index < 256) {
-                raceData->date[str_index++] = race_info_buffer[currentByte - 1];
-            }
-            raceData->date[str_index] = '\0';
-
-            // Nation
-            str_index = 0;
-            while (currentByte < race_info_buffer_size && race_info_buffer[currentByte++] != '\0' && str_index < 256) {
-                raceData->nation[str_index++] = race_info_buffer[currentByte - 1];
-            }
-            raceData->nation[str_index] = '\0';
-
-            // Location
-            str_index = 0;
-            while (currentByte < race_info_buffer_size && race_info_buffer[currentByte++] != '\0' && str_index < 256) {
-                raceData->location[str_index++] = race_info_buffer[currentByte - 1];
-            }
-            raceData->location[str_index] = '\0';
-
-            // Category
-            str_index = 0;
-            while (currentByte < race_info_buffer_size && race_info_buffer[currentByte++] != '\0' && str_index < 256) {
-                raceData->category[str_index++] = race_info_buffer[currentByte - 1];
-            }
-            raceData->category[str_index] = '\0';
-
-            // Discipline
-            str_index = 0;
-            while (currentByte < race_info_buffer_size && race_info_buffer[currentByte++] != '\0' && str_index < 256) {
-                raceData->discipline[str_index++] = race_info_buffer[currentByte - 1];
-            }
-            raceData->discipline[str_index] = '\0';
-
-            // Type
-            str_index = 0;
-            while (currentByte < race_info_buffer_size && race_info_buffer[currentByte++] != '\0' && str_index < 256) {
-                raceData->type[str_index++] = race_info_buffer[currentByte - 1];
-            }
-            raceData->type[str_index] = '\0';
-
-            // Skip the last string field
-            while (currentByte < race_info_buffer_size && race_info_buffer[currentByte++] != '\0') {}
-
-            // The requested race was found
-            *start_byte = currentByte;
-            return 0;
-        }
+    RaceInfoRecord race_info;
+    if (Database_FindRaceInfo(raceid, &race_info) != 0) {
+        return -1;
     }
 
-    *start_byte = 0;
-    return -1;
+    Database_CopyString(raceData->date, sizeof(raceData->date), race_info.date);
+    raceData->nation = race_info.nation;
+    Database_CopyString(raceData->location, sizeof(raceData->location), race_info.location);
+    raceData->category = race_info.category;
+    raceData->discipline = race_info.discipline;
+    raceData->type = race_info.type;
+    return 0;
 }
 
 
 /**
  * -------------------------------------------------------------------------------------------------------------------------------
- *  Gets the race result data for the given race id, and from the perspective of the athlete with the given fiscode
- *  The function will look though the race_results_buffer for the given race id, and the requierd result data will then be stored in the RaceData object
+ *  Gets the race result data for a race in the race list of an athlete, from the perspective of that athlete
+ *  The result of the athlete is read from the race list, and the requierd result data will then be stored in the RaceData object
  *
  *  raceData: The object that will store the race results data
- *  raceid: The id of the requested race
- *  fiscode: The fiscode of the requested athlete
- *  start_byte: The position in the buffer the search should start from. 
- *              This index should be stored from the last time this function was called, in order to speed up the current search 
- *  race_results_buffer: This buffer should contain the full file from the database that contains all the data related to race results
- *  race_results_buffer_size: The size of the buffer
+ *  race_ids: The race list of the athlete
+ *  i: The position of the requested race in the race list
  *
  *  Returns 0 on success, the race was found and the data was stored inside the RaceData object
- *  Returns -1 if the requested race was not found
+ *  Returns -1 if the requested race, or the athlete in that race, was not found
  * -------------------------------------------------------------------------------------------------------------------------------
  */
-static int GetRaceData_FromRaceResults(RaceData* raceData, unsigned int raceid, int* start_byte, unsigned int fiscode, char* race_results_buffer, int race_results_buffer_size)
+static int GetRaceData_FromAthleteResult(RaceData* raceData, const RaceIdsRecord* race_ids, int i)
 {
-    int currentByte = *start_byte;
-    while (currentByte < race_results_buffer_size)
-    {
-        // Make sure the following 6 bytes can be read
-        if (currentByte + 5 >= race_results_buffer_size) {
-            break;
-        }
-
-        // Read the current raceid and how many ranks the result list has
-        unsigned char bytes[4];
-        bytes[0] = race_results_buffer[currentByte++];
-        bytes[1] = race_results_buffer[currentByte++];
-        bytes[2] = race_results_buffer[currentByte++];
-        bytes[3] = race_results_buffer[currentByte++];
-        unsigned int currentRaceid = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-        bytes[0] = race_results_buffer[currentByte++];
-        bytes[1] = race_results_buffer[currentByte++];
-        unsigned int numberOfRanks = bytes[0] | (bytes[1] << 8);
-
-        if (currentRaceid != raceid)
-        {
-            // Skip past all the bytes for the current race
-            for (int i = 0; i < numberOfRanks; i++) {
-                currentByte += 18;
-                int stringCounter = 0;
-                while (stringCounter < 3 && currentByte < race_results_buffer_size) {
-                    if (race_results_buffer[currentByte++] == '\0') {
-                        stringCounter++;
-                    }
-                }
-            }
-        }
-        /*
-         * THIS CODE PATH IS PROBABLY UNNECCESSARY
-        else if (numberOfRanks == 0)
-        {
-            // The requested race was found, but it has no results stored
-            *start_byte = -1;
-            return -1;
-        }
-        */
-        else
-        {
-            // The requested race was found, so loop through all ranks in the result list
-            for (int i = 0; i < numberOfRanks; i++)
-            {
-                // Make sure it is possible to read the following 8 bytes
-                if (currentByte + 7 >= race_results_buffer_size) {
-                    break;
-                }
-
-                bytes[0] = race_results_buffer[currentByte++];
-                bytes[1] = race_results_buffer[currentByte++];
-                unsigned int rank = bytes[0] | (bytes[1] << 8);
-
-                bytes[0] = race_results_buffer[currentByte++];
-                bytes[1] = race_results_buffer[currentByte++];
-                unsigned int bib = bytes[0] | (bytes[1] << 8);
-
-                bytes[0] = race_results_buffer[currentByte++];
-                bytes[1] = race_results_buffer[currentByte++];
-                bytes[2] = race_results_buffer[currentByte++];
-                bytes[3] = race_results_buffer[currentByte++];
-                unsigned int currentFiscode = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-                if (currentFiscode != fiscode)
-                {
-                    // Skip past all the bytes for the current rank
-                    currentByte += 10;
-                    int stringCounter = 0;
-                    while (stringCounter < 3 && currentByte < race_results_buffer_size) {
-                        if (race_results_buffer[currentByte++] == '\0') {
-                            stringCounter++;
-                        }
-                    }
-                }
-                else 
-                {
-                    // Make sure it is possible to read the following 10 bytes
-                    if (currentByte + 9 >= race_results_buffer_size) {
-                        break;
-                    }
-                    
-                    bytes[0] = race_results_buffer[currentByte++];
-                    bytes[1] = race_results_buffer[currentByte++];
-                    bytes[2] = race_results_buffer[currentByte++];
-                    bytes[3] = race_results_buffer[currentByte++];
-                    raceData->time = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-                    bytes[0] = race_results_buffer[currentByte++];
-                    bytes[1] = race_results_buffer[currentByte++];
-                    bytes[2] = race_results_buffer[currentByte++];
-                    bytes[3] = race_results_buffer[currentByte++];
-                    raceData->diff = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-
-                    bytes[0] = race_results_buffer[currentByte++];
-                    bytes[1] = race_results_buffer[currentByte++];
-                    unsigned int year = bytes[0] | (bytes[1] << 8);
-
-                    // Skip the name and nation field
-                    int stringCounter = 0;
-                    while (stringCounter < 2 && currentByte < race_results_buffer_size) {
-                        if (race_results_buffer[currentByte++] == '\0') {
-                            stringCounter++;
-                        }
-                    }
-                    
-                    int str_index = 0;
-                    while (currentByte < race_results_buffer_size && race_results_buffer[currentByte++] != '\0' && str_index < 256) {
-                        raceData->fispoints[str_index++] = race_results_buffer[currentByte - 1];
-                    }
-                    raceData->fispoints[str_index] = '\0';
-
-                    raceData->rank = rank;
-                    raceData->participants = numberOfRanks;
-
-
-                    // Since the parameter "start_byte" is used to keep track of the current byte (in order to speed up the search for the next race)
-                    // We need to finish looping though the result list, so that the byte index points to the start of a new race during the next search
-                    i++;
-                    while (i < numberOfRanks)
-                    {
-                        // If the end of the buffer is reached: set the byte index to 0 so the next search start from the beginning
-                        if (currentByte + 17 >= race_results_buffer_size) {
-                            *start_byte = 0;
-                            return 0;
-                        }
-
-                        // Skip past all the bytes for the current rank
-                        i++;
-                        currentByte += 18;
-                        int stringCounter = 0;
-                        while (stringCounter < 3 && currentByte < race_results_buffer_size) {
-                            if (race_results_buffer[currentByte++] == '\0') {
-                                stringCounter++;
-                            }
-                        }
-                    }
-                    
-                    // The requested race and athlete was found, and the data was stored in the RaceData object
-                    *start_byte = currentByte;
-                    return 0;
-                }
-            }
-
-
-            // The requested race was found but not the requested athlete
-            if (currentByte >= race_results_buffer_size) {
-                *start_byte = 0;  // If the end of the buffer is reached: set the byte index to 0 so the next search start from the beginning
-            } else {
-                *start_byte = currentByte;
-            }
-            return -1;
-        }
-    }    
+    AthleteResultRecord result;
+    if (Database_GetAthleteResult(race_ids, i, &result) != 0) {
+        return -1;
+    }
 
-    // The requested race was not found
-    *start_byte = 0;
-    return -1;
+    raceData->time = result.time;
+    raceData->diff = result.diff;
+    Database_CopyString(raceData->fispoints, sizeof(raceData->fispoints), result.fispoints);
+    raceData->rank = result.rank;
+    raceData->participants = result.participants;
+    return 0;
 }
-
-
-
-
-
-
-
-
-
-
-
-
@@ -1,17 +1,20 @@
 
 #pragma once
 
+#include "../db/Database.h"
+
 #define TEMPLATE_ATHLETE "./resources/athlete/template.html"
 #define TEMPLATE_RACE    "./resources/race/template.html"
+#define PLACEHOLDER_MAX_SIZE 64  // Placeholders in the templates are written as @{NAME}
 
 // Used for displaying a single race in the statistics menu
 typedef struct {
     char date[256];
     char location[256];
-    char nation[256];
-    char category[256];
-    char discipline[256];
-    char type[256];
+    DictionaryCode nation = 0;
+    DictionaryCode category = 0;
+    DictionaryCode discipline = 0;
+    DictionaryCode type = 0;
     unsigned int participants = 0;
     unsigned int rank = 0;
     unsigned int time = 0;
@@ -24,6 +27,6 @@ int CreatePage_Athlete(int fiscode, char** PageBuffer, int* PageBuffer_size);
 int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size);
 
 // Util functions
-int WriteToBuffer(char* string, char** buffer, int buffer_size, int* currentByte);
+int WriteToBuffer(const char* string, char** buffer, int buffer_size, int* currentByte);
 
 
@@ -1,14 +1,18 @@
 
 #include "CreatePages.h"
 
-#include "../LoadFile.h"
+#include "../StaticFile.h"
 #include "../db/Database.h"
 #include "../util/RaceTime.h"
+#include "../util/Log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#define RACE_PAGE_FIELDS_SIZE 64    // The max size of the raceid and codex numbers on the page
+#define RACE_PAGE_RESULT_SIZE 1024  // The max size of the html and the numbers of one result, without its strings
+
 
 /**
  * -------------------------------------------------------------------------------------------
@@ -26,7 +30,7 @@
 int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size)
 {
     if (*PageBuffer != 0) {
-        fprintf(stderr, "[%ld] Failed to create page for Race Results: the buffer parameter needs to be set to 0\n", (long)getpid());
+        fprintf(stderr, "[%ld] Failed to create page for Race Results: the buffer parameter needs to be set to 0\n", GetLogId());
         return -1;
     }
     
@@ -55,9 +59,9 @@ int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size)
     char file[] = TEMPLATE_RACE;
     char* buffer = 0;
     int buffer_size = 0;
-    if (LoadFile(file, &buffer, &buffer_size) < 0) {
+    if (StaticFile_LoadContent(file, &buffer, &buffer_size) < 0) {
         // The LoadFile function will print the error message
-        if (buffer) { free(buffer); }
+        StaticFile_FreeContent(buffer);
         if (results) { free(results); }
         return -1;  
     }
@@ -65,15 +69,24 @@ int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size)
 
     // --------------------------------------------------------------------------------------------
     // Allocate memory for the PageBuffer
-    // Using an extra 256 bytes for each ResultElement to make sure it can 
-    // store the template file, and the Race data that will be inserted into it
+    // Using an extra RACE_PAGE_FIELDS_SIZE bytes for the race info, and RACE_PAGE_RESULT_SIZE bytes for each result
+    // together with the size of their strings, to make sure it can store the template file, and the Race data
+    // that will be inserted into it. The strings are never longer in the page than in the database
     // --------------------------------------------------------------------------------------------
-    int results_memory_size = number_of_results * (sizeof(ResultElement) + 256); 
-    *PageBuffer_size = buffer_size + sizeof(race_info) + results_memory_size;
+    int race_info_memory_size = RACE_PAGE_FIELDS_SIZE + sizeof(race_info.date) + sizeof(race_info.location);
+    DictionaryCode codes[] = { race_info.nation, race_info.category, race_info.discipline, race_info.type, race_info.gender };
+    for (int i = 0; i < 5; i++) {
+        race_info_memory_size += strlen(Database_GetDictionaryString(codes[i]));
+    }
+    int results_memory_size = 0;
+    for (int i = 0; i < number_of_results; i++) {
+        results_memory_size += RACE_PAGE_RESULT_SIZE + strlen(results[i].name) + strlen(results[i].nation) + strlen(results[i].fispoints);
+    }
+    *PageBuffer_size = buffer_size + race_info_memory_size + results_memory_size;
     
     if ((*PageBuffer = (char*) malloc(*PageBuffer_size * sizeof(char))) == 0) {
-        fprintf(stderr, "[%ld] Failed to create page for Race Results: failed to allocate memory for the page\n", (long)getpid());
-        if (buffer) { free(buffer); }
+        fprintf(stderr, "[%ld] Failed to create page for Race Results: failed to allocate memory for the page\n", GetLogId());
+        StaticFile_FreeContent(buffer);
         if (results) { free(results); }
         return -1;
     }
@@ -99,15 +112,20 @@ int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size)
         }
         
         // A placeholder was detected
-        // Attempt to create a substring for the placeholder text
+        // Attempt to copy the placeholder text, so that the template itself is never modified
         currentByte += 2;
         char* placeholder = 0;
+        char placeholder_text[PLACEHOLDER_MAX_SIZE];
         int placeholder_start = currentByte;
         
         while (currentByte < buffer_size) {
             if (buffer[currentByte] == '}') {
-                placeholder = &(buffer[placeholder_start]);
-                buffer[currentByte] = '\0';
+                int placeholder_size = currentByte - placeholder_start;
+                if (placeholder_size < PLACEHOLDER_MAX_SIZE) {
+                    memcpy(placeholder_text, &(buffer[placeholder_start]), placeholder_size);
+                    placeholder_text[placeholder_size] = '\0';
+                    placeholder = &(placeholder_text[0]);
+                }
                 currentByte++;
                 break;
             }
@@ -136,7 +154,7 @@ int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size)
             }    
             else if (strcmp(placeholder, "RACE_INFO_NATION") == 0)
             {
-                char* p = &(race_info.nation[0]);
+                const char* p = Database_GetDictionaryString(race_info.nation);
                 WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
             }
             else if (strcmp(placeholder, "RACE_INFO_LOCATION") == 0)
@@ -146,22 +164,22 @@ int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size)
             }
             else if (strcmp(placeholder, "RACE_INFO_CATEGORY") == 0)
             {
-                char* p = &(race_info.category[0]);
+                const char* p = Database_GetDictionaryString(race_info.category);
                 WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
             }
             else if (strcmp(placeholder, "RACE_INFO_DISCIPLINE") == 0)
             {
-                char* p = &(race_info.discipline[0]);
+                const char* p = Database_GetDictionaryString(race_info.discipline);
                 WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
             }
             else if (strcmp(placeholder, "RACE_INFO_TYPE") == 0)
             {
-                char* p = &(race_info.type[0]);
+                const char* p = Database_GetDictionaryString(race_info.type);
                 WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
             }
             else if (strcmp(placeholder, "RACE_INFO_GENDER") == 0)
             {
-                char* p = &(race_info.gender[0]);
+                const char* p = Database_GetDictionaryString(race_info.gender);
                 WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
             }
             else if (strcmp(placeholder, "RACE_RESULTS") == 0)
@@ -220,7 +238,7 @@ int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size)
                     // NAME
                     {
                         char div_start[] = "<div class='race-result-field name-field'>";
-                        char* p = &(results[i].name[0]);
+                        const char* p = results[i].name;
 
                         WriteToBuffer(&(div_start[0]), PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
                         WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
@@ -241,7 +259,7 @@ int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size)
                     // NATION
                     {
                         char div_start[] = "<div class='race-result-field nation-field'>";
-                        char* p = &(results[i].nation[0]);
+                        const char* p = results[i].nation;
 
                         WriteToBuffer(&(div_start[0]), PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
                         WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
@@ -277,7 +295,7 @@ int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size)
                     // FISPOINTS
                     {
                         char div_start[] = "<div class='race-result-field fispoints-field'>";
-                        char* p = &(results[i].fispoints[0]);
+                        const char* p = results[i].fispoints;
 
                         WriteToBuffer(&(div_start[0]), PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
                         WriteToBuffer(p, PageBuffer, *PageBuffer_size, &PageBuffer_currentByte);
@@ -301,7 +319,7 @@ int CreatePage_RaceResults(int raceid, char** PageBuffer, int* PageBuffer_size)
     }
     *PageBuffer_size = PageBuffer_currentByte;
 
-    if (buffer) { free(buffer); }
+    StaticFile_FreeContent(buffer);
     if (results) { free(results); }
     return 0;
 }
@@ -17,7 +17,7 @@
  * Returns 0 on success, and -1 on failure
  * ------------------------------------------------------------------------------------------------------
  */
-int WriteToBuffer(char* string, char** buffer, int buffer_size, int* currentByte)
+int WriteToBuffer(const char* string, char** buffer, int buffer_size, int* currentByte)
 {
     if (string == 0 || *buffer == 0 || buffer_size == 0 || (*currentByte >= buffer_size)) {
         return -1;
@@ -0,0 +1,186 @@
+#include "Server.h"
+
+#include "../libs/uici.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RESOLVER_CACHE_SIZE 256  // The max number of client names that are remembered
+#define RESOLVER_CACHE_TTL 300   // Seconds a resolved client name is remembered
+#define RESOLVER_QUEUE_SIZE 64   // The max number of addresses waiting to be resolved, more are not resolved
+#define ADDRESS_MAX_SIZE INET_ADDRSTRLEN
+
+typedef struct {
+    char address[ADDRESS_MAX_SIZE];  // Empty if the entry is not used
+    char name[NI_MAXHOST];
+    time_t expires;  // 0 if the entry is not used
+    bool resolved;  // False while the name is waiting to be resolved
+} ResolvedName;
+
+static bool resolve_names = false;
+
+// The names are resolved by a background thread, so accepting a connection never waits for DNS
+// Every process that accepts connections starts its own thread the first time it is needed
+static pthread_mutex_t resolver_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t resolver_cond = PTHREAD_COND_INITIALIZER;
+static pid_t resolver_pid = 0;
+static ResolvedName cache[RESOLVER_CACHE_SIZE];
+static int queue[RESOLVER_QUEUE_SIZE];  // Indexes into the cache
+static int queue_front = 0;
+static int queue_size = 0;
+
+static void LookupClientName(char* client, int client_size);
+static void* RunResolver(void* arg);
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Sets whether the names of the clients should be looked up, to be used in the logs
+ * When disabled (the default), clients are only known by their numeric address
+ * ----------------------------------------------------------------------------
+ */
+void SetClientNameResolution(bool enabled)
+{
+    resolve_names = enabled;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Accepts a new connection on the listening socket
+ * The client is named by its numeric address, so no DNS lookup is done while accepting.
+ * If name resolution is enabled (see "SetClientNameResolution") the name is used instead, but only if it has
+ * already been resolved. Otherwise it is resolved in the background, and is used for the next connection from the same address
+ *
+ * fd_listen: The file descriptor that is listening for new connections
+ * client: Set to the name of the client
+ * client_size: The size of the client buffer
+ *
+ * Returns the file descriptor of the new connection, or -1 on failure with errno set
+ * ----------------------------------------------------------------------------
+ */
+int AcceptClient(int fd_listen, char* client, int client_size)
+{
+    int fd = u_accept_numeric(fd_listen, client, client_size);
+    if (fd != -1 && resolve_names && client[0] != '\0') {
+        LookupClientName(client, client_size);
+    }
+    return fd;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Replaces the numeric address with the name of the client, if it is in the cache
+ * Addresses that are not in the cache, or have expired, are queued to be resolved by the background thread
+ * ----------------------------------------------------------------------------
+ */
+static void LookupClientName(char* client, int client_size)
+{
+    time_t now = time(0);
+    pthread_mutex_lock(&resolver_lock);
+
+    if (resolver_pid != getpid())
+    {
+        // The process was forked from a process with its own thread. The addresses it had queued will never be resolved here
+        queue_size = 0;
+        for (int i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+            if (!cache[i].resolved) { cache[i].address[0] = '\0'; }
+        }
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, RunResolver, 0) != 0) {
+            pthread_mutex_unlock(&resolver_lock);
+            return;
+        }
+        pthread_detach(thread);
+        resolver_pid = getpid();
+    }
+
+    // Find the address in the cache, and the entry to replace if it is not there
+    // Unused entries never expire, so they are replaced first. Entries that are waiting to be resolved are never replaced
+    int found = -1;
+    int replace = -1;
+    for (int i = 0; i < RESOLVER_CACHE_SIZE && found == -1; i++)
+    {
+        if (strcmp(cache[i].address, client) == 0) {
+            found = i;
+        }
+        else if ((cache[i].address[0] == '\0' || cache[i].resolved) && (replace == -1 || cache[i].expires < cache[replace].expires)) {
+            replace = i;
+        }
+    }
+
+    if (found != -1 && (!cache[found].resolved || cache[found].expires > now))
+    {
+        if (cache[found].resolved) {
+            strncpy(client, cache[found].name, client_size - 1);
+            client[client_size - 1] = '\0';
+        }
+        pthread_mutex_unlock(&resolver_lock);
+        return;
+    }
+
+    // Queue the address to be resolved
+    int index = (found != -1) ? found : replace;
+    if (queue_size < RESOLVER_QUEUE_SIZE && index != -1)
+    {
+        strncpy(cache[index].address, client, ADDRESS_MAX_SIZE - 1);
+        cache[index].address[ADDRESS_MAX_SIZE - 1] = '\0';
+        cache[index].resolved = false;
+        queue[(queue_front + queue_size) % RESOLVER_QUEUE_SIZE] = index;
+        queue_size++;
+        pthread_cond_signal(&resolver_cond);
+    }
+    pthread_mutex_unlock(&resolver_lock);
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * The background thread that resolves the queued addresses into names
+ * Addresses without a name are stored with the numeric address as the name, so they are not looked up again until they expire
+ * Nothing is printed by this thread, since it may be running when the process forks
+ * ----------------------------------------------------------------------------
+ */
+static void* RunResolver(void* arg)
+{
+    (void) arg;
+    while (true)
+    {
+        pthread_mutex_lock(&resolver_lock);
+        while (queue_size == 0) {
+            pthread_cond_wait(&resolver_cond, &resolver_lock);
+        }
+        int index = queue[queue_front];
+        queue_front = (queue_front + 1) % RESOLVER_QUEUE_SIZE;
+        queue_size--;
+        char address[ADDRESS_MAX_SIZE];
+        strcpy(address, cache[index].address);
+        pthread_mutex_unlock(&resolver_lock);
+
+        // The lookup is done without holding the lock, so the accepting thread never waits for it
+        char name[NI_MAXHOST];
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        if (inet_pton(AF_INET, address, &(addr.sin_addr)) != 1 ||
+            getnameinfo((struct sockaddr*) &addr, sizeof(addr), name, sizeof(name), NULL, 0, NI_NAMEREQD) != 0)
+        {
+            strcpy(name, address);
+        }
+
+        pthread_mutex_lock(&resolver_lock);
+        if (strcmp(cache[index].address, address) == 0) {
+            strcpy(cache[index].name, name);
+            cache[index].expires = time(0) + RESOLVER_CACHE_TTL;
+            cache[index].resolved = true;
+        }
+        pthread_mutex_unlock(&resolver_lock);
+    }
+    return 0;
+}
@@ -0,0 +1,699 @@
+#include "Server.h"
+
+#include "../libs/Restart.h"
+#include "../util/Log.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CLIENT_NAME_SIZE 255
+#define MAX_EVENTS 256
+#define READ_BUFFER_INITIAL_SIZE 2048
+
+#define STATE_READING 0
+#define STATE_WRITING 1
+
+typedef struct Connection {
+    int fd = -1;
+    int state = STATE_READING;
+    time_t last_active = 0;
+    int requests = 0;  // The number of requests that have been received over the connection
+    bool keep_alive = false;  // True if the connection should be kept alive once the current response has been sent
+    char client[CLIENT_NAME_SIZE];
+
+    // The bytes read from the client. The request is parsed once the end of the headers has been received
+    char* in = 0;
+    int in_size = 0;
+    int in_capacity = 0;
+    int in_scanned = 0;  // The number of bytes that have been searched for the end of the headers
+    int header_size = 0;  // The size of the headers, once the end of them has been found
+
+    // The bytes of the response that could not be written to the socket yet
+    char* out = 0;
+    int out_size = 0;
+    int out_sent = 0;
+    int out_capacity = 0;
+
+    // The part of a static file that could not be sent yet. It is sent once all bytes in "out" have been written
+    int file_fd = -1;  // The file is shared, and is never closed by the connection
+    off_t file_offset = 0;
+    off_t file_end = 0;
+
+    // All connections are stored in a list ordered by their last activity,
+    // so the idle connections can be found without looping though every connection
+    struct Connection* prev = 0;
+    struct Connection* next = 0;
+} Connection;
+
+static int epoll_fd = -1;
+static Connection** connections = 0;  // Indexed by the file descriptor of the connection
+static int max_connections = 0;
+static Connection* oldest = 0;
+static Connection* newest = 0;
+
+static void RunEventLoop(int fd_listen);
+static void AcceptConnections(int fd_listen);
+static void ReadFromConnection(Connection* connection);
+static void ProcessRequests(Connection* connection);
+static int ProcessRequest(Connection* connection);
+static void WriteToConnection(Connection* connection);
+static int FinishResponse(Connection* connection);
+static int QueueResponse(int socket, struct iovec* iov, int iov_count);
+static int QueueFile(int socket, int fd, long offset, int size);
+static int SendQueuedFile(Connection* connection);
+static void CloseConnection(Connection* connection);
+static void CloseIdleConnections();
+static void TouchConnection(Connection* connection);
+static int SetNonBlocking(int fd);
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Runs the server with a pool of worker processes that each run a non-blocking event loop
+ * Every worker uses epoll to wait for new connections and for connected clients that are ready to be read from or written to,
+ * so a single process can serve a large number of slow clients at the same time.
+ * See "RunWorkers" for how the workers are supervised
+ *
+ * fd_listen: The file descriptor that is listening for new connections, or -1 if every worker opens its own
+ * config: The server config, containing the number of worker processes to start
+ *
+ * Returns 0 once the server has been stopped
+ * Returns -1 if the server could not be started
+ * ----------------------------------------------------------------------------
+ */
+int RunServer_Event(int fd_listen, const ServerConfig* config)
+{
+    return RunWorkers(fd_listen, config, RunEventLoop);
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * The event loop for a single worker process
+ * This function never returns, the worker exits if the event loop could not be created
+ *
+ * fd_listen: The file descriptor that is listening for new connections
+ * ----------------------------------------------------------------------------
+ */
+static void RunEventLoop(int fd_listen)
+{
+    if (SetNonBlocking(fd_listen) == -1) {
+        fprintf(stderr, "[%ld] Failed to start event loop: Failed to make the listening socket non-blocking: %s\n", GetLogId(), strerror(errno));
+        exit(1);
+    }
+
+    // A connection is stored at the index of its file descriptor, so the table needs one slot for every possible descriptor
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1 || limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > (1 << 20)) {
+        limit.rlim_cur = (1 << 20);
+    }
+    max_connections = (int) limit.rlim_cur;
+    if ((connections = (Connection**) calloc(max_connections, sizeof(Connection*))) == 0) {
+        fprintf(stderr, "[%ld] Failed to start event loop: Failed to allocate the connection table\n", GetLogId());
+        exit(1);
+    }
+
+    if ((epoll_fd = epoll_create1(0)) == -1) {
+        fprintf(stderr, "[%ld] Failed to start event loop: epoll_create1 failed: %s\n", GetLogId(), strerror(errno));
+        exit(1);
+    }
+
+    // Only wake up one of the workers when a new connection arrives on the shared listening socket
+    struct epoll_event event;
+    event.events = EPOLLIN;
+#ifdef EPOLLEXCLUSIVE
+    event.events |= EPOLLEXCLUSIVE;
+#endif
+    event.data.fd = fd_listen;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd_listen, &event) == -1) {
+        fprintf(stderr, "[%ld] Failed to start event loop: Failed to add the listening socket: %s\n", GetLogId(), strerror(errno));
+        exit(1);
+    }
+
+    // All HTTP responses are queued on the connection instead of being written with a blocking write
+    SetResponseWriter(QueueResponse);
+    SetFileWriter(QueueFile);
+
+    fprintf(stderr, "[%ld] Worker started\n", GetLogId());
+    struct epoll_event events[MAX_EVENTS];
+    while (true)
+    {
+        int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, 1000);
+        if (ready == -1) {
+            if (errno != EINTR) {
+                fprintf(stderr, "[%ld] epoll_wait failed: %s\n", GetLogId(), strerror(errno));
+            }
+            continue;
+        }
+
+        for (int i = 0; i < ready; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == fd_listen) {
+                AcceptConnections(fd_listen);
+                continue;
+            }
+
+            Connection* connection = connections[fd];
+            if (connection == 0) {
+                continue;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                CloseConnection(connection);
+                continue;
+            }
+            if (connection->state == STATE_READING && (events[i].events & EPOLLIN)) {
+                ReadFromConnection(connection);
+            }
+            else if (connection->state == STATE_WRITING && (events[i].events & EPOLLOUT)) {
+                WriteToConnection(connection);
+            }
+        }
+
+        CloseIdleConnections();
+    }
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Accepts all pending connections on the listening socket and adds them to the event loop
+ *
+ * fd_listen: The non-blocking file descriptor that is listening for new connections
+ * ----------------------------------------------------------------------------
+ */
+static void AcceptConnections(int fd_listen)
+{
+    while (true)
+    {
+        char client[CLIENT_NAME_SIZE];
+        int fd;
+        if ((fd = AcceptClient(fd_listen, client, CLIENT_NAME_SIZE)) == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fprintf(stderr, "[%ld] Failed to accept connection: %s\n", GetLogId(), strerror(errno));
+            }
+            return;
+        }
+
+        Connection* connection = 0;
+        if (fd >= max_connections || SetNonBlocking(fd) == -1 || (connection = new Connection) == 0) {
+            fprintf(stderr, "[%ld] Failed to add connection from %s to the event loop\n", GetLogId(), client);
+            r_close(fd);
+            continue;
+        }
+        connection->fd = fd;
+        strcpy(connection->client, client);
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            fprintf(stderr, "[%ld] Failed to add connection from %s to the event loop: %s\n", GetLogId(), client, strerror(errno));
+            r_close(fd);
+            delete connection;
+            continue;
+        }
+
+        connections[fd] = connection;
+        TouchConnection(connection);
+        fprintf(stderr, "[%ld] Client connected: %s\n", GetLogId(), client);
+    }
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Reads all available bytes from the client
+ * Once the end of the request headers has been received, the request is handled and responded to
+ *
+ * connection: The connection to read from
+ * ----------------------------------------------------------------------------
+ */
+static void ReadFromConnection(Connection* connection)
+{
+    while (true)
+    {
+        // Grow the buffer if needed. One byte is always kept free for the null-terminating character
+        if (connection->in_size + 1 >= connection->in_capacity && connection->in_capacity < REQUEST_MAX_SIZE)
+        {
+            int capacity = (connection->in_capacity == 0) ? READ_BUFFER_INITIAL_SIZE : connection->in_capacity * 2;
+            if (capacity > REQUEST_MAX_SIZE) {
+                capacity = REQUEST_MAX_SIZE;
+            }
+            char* in = (char*) realloc(connection->in, capacity * sizeof(char));
+            if (in == 0) {
+                fprintf(stderr, "[%ld] Failed to allocate memory for client request\n", GetLogId());
+                CloseConnection(connection);
+                return;
+            }
+            connection->in = in;
+            connection->in_capacity = capacity;
+        }
+
+        // Process the request as it is if it does not fit in the buffer, in the same way as the blocking servers do
+        int space = connection->in_capacity - connection->in_size - 1;
+        if (space <= 0) {
+            ProcessRequests(connection);
+            return;
+        }
+
+        ssize_t bytes = read(connection->fd, &(connection->in[connection->in_size]), space);
+        if (bytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fprintf(stderr, "[%ld] Failed to read client request: %s\n", GetLogId(), strerror(errno));
+                CloseConnection(connection);
+            }
+            return;
+        }
+        if (bytes == 0) {
+            // The client closed the connection before the full request was received
+            CloseConnection(connection);
+            return;
+        }
+
+        // Look for the end of the headers. The search continues where the previous one ended
+        connection->in_size += bytes;
+        TouchConnection(connection);
+        if ((connection->header_size = FindEndOfHeaders(connection->in, connection->in_size, &(connection->in_scanned))) > 0) {
+            ProcessRequests(connection);
+            return;
+        }
+    }
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Handles the request that has been read from the client, and then every pipelined request after it
+ * that is already in the buffer. This continues for as long as the responses can be written right away,
+ * the rest of the requests are handled once the pending response has been sent (see "WriteToConnection")
+ *
+ * connection: The connection that has received a full request
+ * ----------------------------------------------------------------------------
+ */
+static void ProcessRequests(Connection* connection)
+{
+    while (ProcessRequest(connection) == 0 && connection->state == STATE_READING && connection->in_size > 0) {
+        if ((connection->header_size = FindEndOfHeaders(connection->in, connection->in_size, &(connection->in_scanned))) <= 0) {
+            return;
+        }
+    }
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Parses and handles the request that has been read from the client
+ * The response is queued on the connection, and the connection starts waiting for the socket to become writable
+ * if the full response could not be written right away
+ *
+ * connection: The connection that has received a full request
+ *
+ * Returns 0 if the connection is still open, and -1 if it was closed
+ * ----------------------------------------------------------------------------
+ */
+static int ProcessRequest(Connection* connection)
+{
+    connection->in[connection->in_size] = '\0';
+    connection->state = STATE_WRITING;
+    connection->requests++;
+
+    Request request;
+    request.buffer = connection->in;
+    request.buffer_size = connection->in_size;
+    request.header_size = (connection->header_size > 0) ? connection->header_size : 0;
+
+    if (ParseClientRequest(&request) == -1) {
+        SetKeepAlive(connection->fd, false);
+        SendHttpResponse(connection->fd, 400, CONNECTION_CLOSE, TYPE_HTML, "Bad Request: Invalid request, failed to parse the request line");
+        fprintf(stderr, "[%ld] Failed to parse the request line from the client\n", GetLogId());
+    }
+    else
+    {
+        if (request.query) {
+            fprintf(stderr, "[%ld] Client request line: %s %s?%s %s\n", GetLogId(), request.method, request.path, request.query, request.protocol);
+        } else {
+            fprintf(stderr, "[%ld] Client request line: %s %s %s\n", GetLogId(), request.method, request.path, request.protocol);
+        }
+
+        SetKeepAlive(connection->fd, IsKeepAliveRequest(&request) && connection->requests < CONNECTION_MAX_REQUESTS);
+        if (HandleClientRequest(connection->fd, &request) == -1 && !IsKeepAlive(connection->fd)) {
+            fprintf(stderr, "[%ld] Failed to handle the client request: Closing connection...\n", GetLogId());
+            CloseConnection(connection);
+            return -1;
+        }
+    }
+
+    // The request buffer is reused for the next request on the same connection.
+    // Any bytes after the request are the start of the next one, and are moved to the front of the buffer
+    connection->keep_alive = IsKeepAlive(connection->fd);
+    int pipelined_size = (connection->keep_alive && request.method != 0) ? GetPipelinedSize(&request) : 0;
+    if (pipelined_size > 0) {
+        memmove(connection->in, &(connection->in[request.header_size]), pipelined_size);
+    }
+    connection->in_size = pipelined_size;
+    connection->in_scanned = 0;
+    connection->header_size = 0;
+
+    if (connection->out_sent == connection->out_size && connection->file_fd == -1) {
+        return FinishResponse(connection);
+    }
+
+    // Wait for the socket to become writable in order to send the rest of the response
+    struct epoll_event event;
+    event.events = EPOLLOUT;
+    event.data.fd = connection->fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection->fd, &event) == -1) {
+        fprintf(stderr, "[%ld] Failed to wait for the client to become writable: %s\n", GetLogId(), strerror(errno));
+        CloseConnection(connection);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Writes as much as possible of the queued response to the client
+ * Once the full response has been sent, the connection waits for the next request or is closed (see "FinishResponse")
+ *
+ * connection: The connection to write to
+ * ----------------------------------------------------------------------------
+ */
+static void WriteToConnection(Connection* connection)
+{
+    while (connection->out_sent < connection->out_size)
+    {
+        ssize_t bytes = write(connection->fd, &(connection->out[connection->out_sent]), connection->out_size - connection->out_sent);
+        if (bytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fprintf(stderr, "[%ld] Failed to send HTTP Response: %s\n", GetLogId(), strerror(errno));
+                CloseConnection(connection);
+            }
+            return;
+        }
+        connection->out_sent += bytes;
+        TouchConnection(connection);
+    }
+    if (connection->file_fd != -1)
+    {
+        if (SendQueuedFile(connection) == -1) {
+            fprintf(stderr, "[%ld] Failed to send HTTP Response: %s\n", GetLogId(), strerror(errno));
+            CloseConnection(connection);
+            return;
+        }
+        if (connection->file_fd != -1) {
+            return;
+        }
+    }
+
+    // Wait for the next request from the client
+    if (connection->keep_alive) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = connection->fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection->fd, &event) == -1) {
+            fprintf(stderr, "[%ld] Failed to wait for the next request from the client: %s\n", GetLogId(), strerror(errno));
+            CloseConnection(connection);
+            return;
+        }
+    }
+
+    // Handle the pipelined requests that were received while the response was being sent
+    if (FinishResponse(connection) == 0 && connection->in_size > 0 &&
+        (connection->header_size = FindEndOfHeaders(connection->in, connection->in_size, &(connection->in_scanned))) > 0)
+    {
+        ProcessRequests(connection);
+    }
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Called once the full response has been sent
+ * The connection either starts waiting for the next request, or is closed if it should not be kept alive
+ *
+ * connection: The connection the response was sent over
+ *
+ * Returns 0 if the connection is still open, and -1 if it was closed
+ * ----------------------------------------------------------------------------
+ */
+static int FinishResponse(Connection* connection)
+{
+    if (!connection->keep_alive) {
+        CloseConnection(connection);
+        return -1;
+    }
+    connection->state = STATE_READING;
+    connection->out_sent = 0;
+    connection->out_size = 0;
+    connection->file_fd = -1;
+    TouchConnection(connection);
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * The ResponseWriter used by the event loop (see "SetResponseWriter")
+ * Writes as much of the response as possible without blocking, and stores the rest on the connection
+ * so that it can be sent once the socket becomes writable again
+ *
+ * socket: The file descriptor the client is connected over
+ * iov: The buffers to send, in order. They are sent together with "writev", and only the unsent bytes are copied
+ * iov_count: The number of buffers
+ *
+ * Returns 0 on success, and -1 on failure
+ * ----------------------------------------------------------------------------
+ */
+static int QueueResponse(int socket, struct iovec* iov, int iov_count)
+{
+    Connection* connection = (socket >= 0 && socket < max_connections) ? connections[socket] : 0;
+    if (connection == 0) {
+        return (r_writev(socket, iov, iov_count) == -1) ? -1 : 0;
+    }
+
+    // Try to write directly to the socket if nothing is already waiting to be sent
+    if (connection->out_sent == connection->out_size && connection->file_fd == -1)
+    {
+        connection->out_sent = 0;
+        connection->out_size = 0;
+        while (iov_count > 0)
+        {
+            ssize_t bytes = writev(socket, iov, iov_count);
+            if (bytes == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                return -1;
+            }
+
+            // Skip over the buffers that were written, and the written part of the first one that was not
+            while (iov_count > 0 && (size_t) bytes >= iov->iov_len) {
+                bytes -= iov->iov_len;
+                iov++;
+                iov_count--;
+            }
+            if (iov_count > 0) {
+                iov->iov_base = (char*) iov->iov_base + bytes;
+                iov->iov_len -= bytes;
+            }
+        }
+        if (iov_count == 0) {
+            return 0;
+        }
+    }
+
+    // Store the bytes that could not be written
+    int size = 0;
+    for (int i = 0; i < iov_count; i++) {
+        size += iov[i].iov_len;
+    }
+    if (connection->out_size + size > connection->out_capacity)
+    {
+        int capacity = connection->out_size + size;
+        char* out = (char*) realloc(connection->out, capacity * sizeof(char));
+        if (out == 0) {
+            errno = ENOMEM;
+            return -1;
+        }
+        connection->out = out;
+        connection->out_capacity = capacity;
+    }
+    for (int i = 0; i < iov_count; i++) {
+        memcpy(&(connection->out[connection->out_size]), iov[i].iov_base, iov[i].iov_len);
+        connection->out_size += iov[i].iov_len;
+    }
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * The FileWriter used by the event loop (see "SetFileWriter")
+ * Sends as much of the file as possible without blocking, and remembers the rest on the connection
+ * so that it can be sent once the socket becomes writable again.
+ * The file is never read into memory, it is sent with "sendfile" directly from the open file
+ *
+ * socket: The file descriptor the client is connected over
+ * fd: The open file to send
+ * offset: Where in the file to start sending from
+ * size: The number of bytes to send
+ *
+ * Returns 0 on success, and -1 on failure
+ * ----------------------------------------------------------------------------
+ */
+static int QueueFile(int socket, int fd, long offset, int size)
+{
+    Connection* connection = (socket >= 0 && socket < max_connections) ? connections[socket] : 0;
+    if (connection == 0 || connection->file_fd != -1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    connection->file_fd = fd;
+    connection->file_offset = offset;
+    connection->file_end = offset + size;
+
+    // The file has to wait if the bytes before it could not all be written yet
+    if (connection->out_sent < connection->out_size) {
+        return 0;
+    }
+    return SendQueuedFile(connection);
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Sends as much as possible of the file that is queued on the connection
+ * The file is removed from the connection once all of it has been sent
+ *
+ * Returns 0 if all of the file was sent, or if the socket is not writable right now
+ * Returns -1 on failure
+ * ----------------------------------------------------------------------------
+ */
+static int SendQueuedFile(Connection* connection)
+{
+    while (connection->file_offset < connection->file_end)
+    {
+        ssize_t bytes = sendfile(connection->fd, connection->file_fd, &(connection->file_offset), connection->file_end - connection->file_offset);
+        if (bytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            return -1;
+        }
+        if (bytes == 0) {
+            errno = EIO;  // The file is shorter than when it was opened
+            return -1;
+        }
+        TouchConnection(connection);
+    }
+    connection->file_fd = -1;
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Closes the connection, removes it from the event loop and frees all memory used by it
+ *
+ * connection: The connection to close
+ * ----------------------------------------------------------------------------
+ */
+static void CloseConnection(Connection* connection)
+{
+    // Remove the connection from the list of connections
+    if (connection->prev) { connection->prev->next = connection->next; }
+    else { oldest = connection->next; }
+    if (connection->next) { connection->next->prev = connection->prev; }
+    else { newest = connection->prev; }
+
+    connections[connection->fd] = 0;
+    if (r_close(connection->fd) == -1) {  // Closing the socket also removes it from epoll
+        fprintf(stderr, "[%ld] Failed to close fd_active: %s\n", GetLogId(), strerror(errno));
+    }
+    fprintf(stderr, "[%ld] %s disconnected\n", GetLogId(), connection->client);
+
+    if (connection->in) { free(connection->in); }
+    if (connection->out) { free(connection->out); }
+    delete connection;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Closes all connections that have been idle for longer than CONNECTION_IDLE_TIMEOUT
+ * ----------------------------------------------------------------------------
+ */
+static void CloseIdleConnections()
+{
+    time_t now = time(0);
+    while (oldest != 0 && (now - oldest->last_active) > CONNECTION_IDLE_TIMEOUT) {
+        fprintf(stderr, "[%ld] Connection timed out: %s\n", GetLogId(), oldest->client);
+        CloseConnection(oldest);
+    }
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Marks the connection as active, by moving it to the end of the list of connections
+ *
+ * connection: The connection that was active
+ * ----------------------------------------------------------------------------
+ */
+static void TouchConnection(Connection* connection)
+{
+    connection->last_active = time(0);
+    if (newest == connection) {
+        return;
+    }
+
+    // Remove the connection from its current position in the list (if it is in the list)
+    if (connection->prev) { connection->prev->next = connection->next; }
+    else if (oldest == connection) { oldest = connection->next; }
+    if (connection->next) { connection->next->prev = connection->prev; }
+
+    // Add the connection to the end of the list
+    connection->prev = newest;
+    connection->next = 0;
+    if (newest) { newest->next = connection; }
+    newest = connection;
+    if (oldest == 0) { oldest = connection; }
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Sets the O_NONBLOCK flag on the given file descriptor
+ * Returns 0 on success, and -1 on failure
+ * ----------------------------------------------------------------------------
+ */
+static int SetNonBlocking(int fd)
+{
+    int flags;
+    if ((flags = fcntl(fd, F_GETFL, 0)) == -1) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
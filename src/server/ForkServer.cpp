@@ -0,0 +1,75 @@
+#include "Server.h"
+
+#include "../libs/Restart.h"
+#include "../util/Log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#define CLIENT_NAME_SIZE 255
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Runs the server with one new child process for each connection
+ * The parent process only listens for new connections, and every accepted client
+ * is handled in a separate child process that exits once the client has been served.
+ *
+ * fd_listen: The file descriptor that is listening for new connections
+ *
+ * This function only returns if the server could not be started
+ * ----------------------------------------------------------------------------
+ */
+int RunServer_Fork(int fd_listen)
+{
+    int fd_active;
+    char client[CLIENT_NAME_SIZE];
+    pid_t childpid;
+
+    while (true)
+    {
+        // Accept a new connection and fork a new process used to handle the connected client
+        if ((fd_active = AcceptClient(fd_listen, client, CLIENT_NAME_SIZE)) == -1) {
+            perror("Failed to accept connection");
+            continue;
+        }
+        if ((childpid = fork()) == -1) {
+            perror("Failed to fork child process");
+            r_close(fd_active);
+            continue;
+        }
+
+        // -----------------------------------------------------------------------------
+        // Child:
+        // Close the file descriptor that is used to listen for new connections
+        // Then read the received messasge and handle the connected client
+        // -----------------------------------------------------------------------------
+        if (childpid == 0)
+        {
+            if (r_close(fd_listen) == -1) {
+                fprintf(stderr, "[%ld] Failed to close fd_listen: %s. Closing connection...\n", GetLogId(), strerror(errno));
+                fprintf(stderr, "[%ld] %s disconnected\n", GetLogId(), client);
+                exit(1);
+            }
+
+            if (ServeClient(fd_active, client) == -1) {
+                exit(1);
+            }
+            exit(0);
+        }
+
+        // -----------------------------------------------------------------------------
+        // Parent:
+        // Close the file descriptor that the client is connected on
+        // Wait for zombie processes and restart the loop to wait for new connections
+        // -----------------------------------------------------------------------------
+        if (r_close(fd_active) == -1) {
+            fprintf(stderr, "[PARENT] Failed to close fd_active: %s\n", strerror(errno));
+        }
+        while (r_waitpid(-1, NULL, WNOHANG) > 0);  // Clean up zombies (non-blocking)
+    }
+
+    return 0;
+}
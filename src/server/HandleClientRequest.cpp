@@ -2,11 +2,15 @@
 #include "Server.h"
 
 #include "./routes/Routes.h"
+#include "../db/Database.h"
 #include "../util/StringUtil.h"
+#include "../util/Log.h"
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
+static int RouteClientRequest(int socket, Request* request);
+
 
 /**
  * --------------------------------------------------------------------------------------------
@@ -25,11 +29,27 @@ int HandleClientRequest(int socket, Request* request)
     if (strcmp(request->protocol, "HTTP/1.1") != 0 )
     {
         SendHttpResponse(socket, 505, CONNECTION_CLOSE, TYPE_HTML, "HTTP Version Not Supported: Only HTTP/1.1 is supported by the server");
-        fprintf(stderr, "[%ld] Invalid Request: HTTP Version Not Supported: %s. Only HTTP/1.1 is supported by the server\n", (long)getpid(), request->protocol);
+        fprintf(stderr, "[%ld] Invalid Request: HTTP Version Not Supported: %s. Only HTTP/1.1 is supported by the server\n", GetLogId(), request->protocol);
         return 0;  // Return 0 since the client request was technically handled
     }
 
 
+    // Every lookup of the request is made in the same version of the database, even if a new version is loaded meanwhile
+    Database_AcquireSnapshot();
+    int result = RouteClientRequest(socket, request);
+    Database_ReleaseSnapshot();
+    return result;
+}
+
+
+/**
+ * --------------------------------------------------------------------------------------------
+ * Sends the request to the route for its path
+ * Returns the result of the route, or 0 if the path was not found
+ * --------------------------------------------------------------------------------------------
+ */
+static int RouteClientRequest(int socket, Request* request)
+{
     // ----------------------------------
     // Routes
     // ----------------------------------
@@ -53,8 +73,8 @@ int HandleClientRequest(int socket, Request* request)
 
 
     // Not Found: Invalid path
-    SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "Not Found: The requested resource was not found");
-    fprintf(stderr, "[%ld] Not Found: The path given by the client was not found: %s\n", (long)getpid(), request->path);
+    SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "Not Found: The requested resource was not found");
+    fprintf(stderr, "[%ld] Not Found: The path given by the client was not found: %s\n", GetLogId(), request->path);
     return 0;  // Return 0 since the client request was technically handled
 }
 
@@ -0,0 +1,330 @@
+#include "Server.h"
+
+#include "../util/StringUtil.h"
+#include <string.h>
+#include <strings.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static char* ParseToken(char* p, char* end, char** token);
+static bool HasBody(Request* request);
+
+
+/**
+ * ------------------------------------------------------------------------------------------------
+ * Searches for the end of the request headers (an empty line, "\r\n\r\n") in the bytes received so far
+ * The search can be resumed when more bytes have been received, without searching the same bytes again.
+ * 16 bytes are compared at a time when SSE2 is available
+ *
+ * buffer: The bytes received from the client
+ * size: The number of bytes in the buffer
+ * scanned: The number of bytes that have already been searched. Should be set to 0 before the first call,
+ *          and is updated so that the next call continues where this one ended
+ *
+ * Returns the number of bytes up to and including the empty line, once it has been found
+ * Returns -2 if the end of the headers has not been received yet
+ * ------------------------------------------------------------------------------------------------
+ */
+int FindEndOfHeaders(const char* buffer, int size, int* scanned)
+{
+    // A match can start in the last 3 bytes of the previous search, if the rest of it was not received until now
+    int i = (*scanned > 3) ? *scanned - 3 : 0;
+
+#ifdef __SSE2__
+    // Compare the bytes at 4 offsets at once, so that every bit in the mask is the start of a full "\r\n\r\n"
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    for (; i + 19 <= size; i += 16)
+    {
+        __m128i b0 = _mm_loadu_si128((const __m128i*) &(buffer[i]));
+        __m128i b1 = _mm_loadu_si128((const __m128i*) &(buffer[i + 1]));
+        __m128i b2 = _mm_loadu_si128((const __m128i*) &(buffer[i + 2]));
+        __m128i b3 = _mm_loadu_si128((const __m128i*) &(buffer[i + 3]));
+        __m128i match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, cr), _mm_cmpeq_epi8(b1, lf)),
+                                      _mm_and_si128(_mm_cmpeq_epi8(b2, cr), _mm_cmpeq_epi8(b3, lf)));
+        int mask = _mm_movemask_epi8(match);
+        if (mask != 0) {
+            *scanned = size;
+            return i + __builtin_ctz(mask) + 4;
+        }
+    }
+#endif
+
+    // Search the remaining bytes by jumping between the '\r' characters
+    while (i + 4 <= size)
+    {
+        const char* cr_found = (const char*) memchr(&(buffer[i]), '\r', size - i - 3);
+        if (cr_found == 0) {
+            break;
+        }
+        i = (int)(cr_found - buffer);
+        if (buffer[i + 1] == '\n' && buffer[i + 2] == '\r' && buffer[i + 3] == '\n') {
+            *scanned = size;
+            return i + 4;
+        }
+        i++;
+    }
+
+    *scanned = size;
+    return -2;
+}
+
+
+/**
+ * ------------------------------------------------------------------------------------------------
+ * Parses the request from the client
+ * The request line is parsed in a single pass, and the method, path, query and protocol are set to point
+ * directly into the buffer. No bytes are copied, the delimiter after each token is replaced with '\0' instead.
+ * The header lines are not parsed here, they are only located. Use "GetRequestHeader" to find a header.
+ *
+ * If "request->header_size" has been set (see "FindEndOfHeaders"), only the bytes up to the end of the headers
+ * belong to this request. Otherwise the whole buffer is used.
+ *
+ * request: A pointer to the Request object containing the buffer, and the pointers to the substrings that will be created
+ *
+ * No error messages gets printed inside this function
+ * Returns 0 on success, and -1 on failure.
+ * ------------------------------------------------------------------------------------------------
+ */
+int ParseClientRequest(Request* request)
+{
+    char* buffer = request->buffer;
+    int size = (request->header_size > 0) ? request->header_size : request->buffer_size;
+    char* end = &(buffer[size]);
+
+    // -------------------------------------------------------------------
+    // Find the end of the request line, and the HEADERS and BODY after it
+    // -------------------------------------------------------------------
+    char* line_end = (char*) memchr(buffer, '\n', size);
+    if (line_end == 0) {
+        line_end = end;
+    }
+    if (line_end < end)
+    {
+        request->headers = line_end + 1;
+        request->headers_size = (request->header_size > 0) ? (int)(end - request->headers) - 2 : (int)(end - request->headers);
+        if (request->headers_size < 0) {
+            request->headers_size = 0;
+        }
+        if (request->header_size > 0) {
+            request->headers[request->headers_size] = '\0';  // Replaces the '\r' of the empty line that ends the headers
+        }
+    }
+
+    // The bytes after the headers are only the body if the request says it has one.
+    // Otherwise they are the start of the next request (see "GetPipelinedSize")
+    if (request->header_size > 0 && request->header_size < request->buffer_size && HasBody(request)) {
+        request->body = end;
+    }
+
+
+    // -------------------------------------------------------------------
+    // Find the required tokens: METHOD, PATH and PROTOCOL
+    // -------------------------------------------------------------------
+    char* p = buffer;
+    p = ParseToken(p, line_end, &(request->method));
+    p = ParseToken(p, line_end, &(request->path));
+    p = ParseToken(p, line_end, &(request->protocol));
+
+    // Parsing failed if not excatly 3 tokens was found on the request line
+    char* extra = 0;
+    ParseToken(p, line_end, &extra);
+    if (request->method == 0 || request->path == 0 || request->protocol == 0 || extra != 0) {
+        request->method = 0;
+        request->path = 0;
+        request->protocol = 0;
+        return -1;
+    }
+
+
+    // -------------------------------------------------------------------
+    // Find optional tokens: SERVER and PORT, used if the path is an absolute url ("http://server:port/path")
+    // -------------------------------------------------------------------
+    if (strncmp(request->path, "http://", 7) == 0)
+    {
+        char* server = &(request->path[7]);
+        char* server_end = strchr(server, '/');
+        if (server_end != 0 && server_end > server)
+        {
+            // Move the server name back one step, to make room for the null-character between the server and the path
+            int server_size = (int)(server_end - server);
+            memmove(server - 1, server, server_size);
+            server--;
+            server[server_size] = '\0';
+            request->server = server;
+            request->path = server_end;
+
+            char* colon = strchr(server, ':');
+            if (colon != 0 && is_digit(colon[1]))
+            {
+                bool digits = true;
+                for (char* c = colon + 1; *c != '\0'; c++) {
+                    digits = digits && is_digit(*c);
+                }
+                if (digits) {
+                    *colon = '\0';
+                    request->port = colon + 1;
+                }
+            }
+        }
+    }
+
+
+    // -------------------------------------------------------------------
+    // QUERY
+    // -------------------------------------------------------------------
+    char* question_mark = strchr(request->path, '?');
+    if (question_mark != 0) {
+        *question_mark = '\0';
+        if (question_mark[1] != '\0') {
+            request->query = question_mark + 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * ------------------------------------------------------------------------------------------------
+ * Finds the value of a header in the request, without copying it
+ * Header names are compared case-insensitively
+ *
+ * request: The parsed request
+ * name: The name of the header, without the ':'
+ * value: Set to point to the value of the header in the request buffer, without leading and trailing spaces.
+ *        The value is not null-terminated, so "value->size" has to be used
+ *
+ * Returns 0 on success
+ * Returns -2 if the header was not found
+ * ------------------------------------------------------------------------------------------------
+ */
+int GetRequestHeader(Request* request, const char* name, StringView* value)
+{
+    if (request->headers == 0) {
+        return -2;
+    }
+
+    int name_size = strlen(name);
+    char* line = request->headers;
+    char* end = &(request->headers[request->headers_size]);
+    while (line < end)
+    {
+        char* line_end = (char*) memchr(line, '\n', end - line);
+        if (line_end == 0) {
+            line_end = end;
+        }
+
+        if (line_end - line > name_size && line[name_size] == ':' && strncasecmp(line, name, name_size) == 0)
+        {
+            char* start = &(line[name_size + 1]);
+            char* stop = line_end;
+            while (start < stop && (*start == ' ' || *start == '\t')) { start++; }
+            while (stop > start && (stop[-1] == ' ' || stop[-1] == '\t' || stop[-1] == '\r')) { stop--; }
+            value->data = start;
+            value->size = (int)(stop - start);
+            return 0;
+        }
+
+        line = line_end + 1;
+    }
+    return -2;
+}
+
+
+/**
+ * ------------------------------------------------------------------------------------------------
+ * Checks if the client allows the connection to be kept alive after the request has been responded to
+ * HTTP/1.1 connections are persistent unless the client sends "Connection: close".
+ * Requests with a body are never kept alive, since the body is not read by the server
+ * and would otherwise be mistaken for the next request.
+ *
+ * request: The parsed request
+ *
+ * Returns true if the connection can be kept alive, and false otherwise
+ * ------------------------------------------------------------------------------------------------
+ */
+bool IsKeepAliveRequest(Request* request)
+{
+    if (request->protocol == 0 || strcmp(request->protocol, "HTTP/1.1") != 0 || HasBody(request)) {
+        return false;
+    }
+
+    StringView value;
+    if (GetRequestHeader(request, "Connection", &value) == 0) {
+        for (int i = 0; i + 5 <= value.size; i++) {
+            if (strncasecmp(&(value.data[i]), "close", 5) == 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/**
+ * ------------------------------------------------------------------------------------------------
+ * Gets the number of bytes after the request that were received together with it
+ * When the client pipelines its requests, these bytes are the start of the next request,
+ * and should be kept and parsed as the next request instead of being dropped
+ *
+ * request: The parsed request
+ *
+ * Returns the number of bytes after the end of the headers, or 0 if the request has a body
+ * ------------------------------------------------------------------------------------------------
+ */
+int GetPipelinedSize(Request* request)
+{
+    if (request->header_size <= 0 || HasBody(request)) {
+        return 0;
+    }
+    return request->buffer_size - request->header_size;
+}
+
+
+/**
+ * ------------------------------------------------------------------------------------------------
+ * Finds the next token on the request line, and null-terminates it
+ * Tokens are separated by spaces or tabs
+ *
+ * p: Where to start looking for the token
+ * end: The end of the request line
+ * token: Set to the start of the token, or 0 if there are no more tokens
+ *
+ * Returns a pointer to the position after the token
+ * ------------------------------------------------------------------------------------------------
+ */
+static char* ParseToken(char* p, char* end, char** token)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
+    }
+    if (p >= end) {
+        *token = 0;
+        return p;
+    }
+
+    *token = p;
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r') {
+        p++;
+    }
+    *p = '\0';
+    return (p < end) ? p + 1 : p;
+}
+
+
+/**
+ * ------------------------------------------------------------------------------------------------
+ * Checks if the request says that a body follows the headers
+ * "Content-Length: 0" is sent by some clients even when there is no body
+ * ------------------------------------------------------------------------------------------------
+ */
+static bool HasBody(Request* request)
+{
+    StringView value;
+    if (GetRequestHeader(request, "Content-Length", &value) == 0 && !(value.size == 1 && value.data[0] == '0')) {
+        return true;
+    }
+    return (GetRequestHeader(request, "Transfer-Encoding", &value) == 0);
+}
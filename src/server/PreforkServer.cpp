@@ -0,0 +1,291 @@
+#include "Server.h"
+
+#include "../libs/Restart.h"
+#include "../libs/uici.h"
+#include "../db/Database.h"
+#include "../util/Log.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#define CLIENT_NAME_SIZE 255
+#define MIN_WORKER_LIFETIME 1  // Workers that die faster than this (in seconds) are restarted with a delay
+
+static volatile sig_atomic_t stop_server = 0;
+
+// The workers that are running, which the database reloader thread sends SIGHUP to (see "ReloadWorkers")
+static pid_t* worker_pids = 0;
+static int worker_count = 0;
+static pthread_mutex_t workers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void HandleStopSignal(int signo);
+static pid_t StartWorker(int fd_listen, const ServerConfig* config, WorkerLoop loop);
+static void RunWorker(int fd_listen);
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Runs the server with a pool of pre-forked worker processes
+ * Every worker is a long-lived process that accepts connections on the shared listening socket,
+ * and serves the clients one after another in a loop.
+ * See "RunWorkers" for how the workers are supervised
+ *
+ * fd_listen: The file descriptor that is listening for new connections, or -1 if every worker opens its own
+ * config: The server config, containing the number of worker processes to start
+ *
+ * Returns 0 once the server has been stopped
+ * Returns -1 if the server could not be started
+ * ----------------------------------------------------------------------------
+ */
+int RunServer_Prefork(int fd_listen, const ServerConfig* config)
+{
+    return RunWorkers(fd_listen, config, RunWorker);
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Starts a pool of worker processes that all run the given worker loop
+ * The parent process only supervises the workers, and restarts any worker that dies.
+ * Sending SIGINT or SIGTERM to the parent stops all workers before the parent exits.
+ * Only the parent watches the database files, and reloads them when they are replaced or when it gets SIGHUP.
+ * Once it has checked the new files and written their indexes, it tells the workers to load them (see "ReloadWorkers").
+ * The workers that are restarted later start with the new database
+ *
+ * If "config->reuseport" is set, every worker opens its own listening socket with SO_REUSEPORT instead of sharing one,
+ * which lets the kernel spread the new connections evenly over the workers
+ *
+ * fd_listen: The file descriptor that is listening for new connections, shared by all workers. -1 if reuseport is used
+ * config: The server config, containing the number of worker processes to start
+ * loop: The function each worker runs. It should never return
+ *
+ * Returns 0 once the server has been stopped
+ * Returns -1 if the server could not be started
+ * ----------------------------------------------------------------------------
+ */
+int RunWorkers(int fd_listen, const ServerConfig* config, WorkerLoop loop)
+{
+    int workers = config->workers;
+    if (workers <= 0) {
+        fprintf(stderr, "[PARENT] Failed to start server: Invalid number of workers: %d\n", workers);
+        return -1;
+    }
+
+    pid_t* pids;
+    time_t* started;
+    if ((pids = (pid_t*) malloc(workers * sizeof(pid_t))) == 0 || (started = (time_t*) malloc(workers * sizeof(time_t))) == 0) {
+        fprintf(stderr, "[PARENT] Failed to start server: Failed to allocate memory for the workers\n");
+        if (pids) { free(pids); }
+        return -1;
+    }
+
+    struct sigaction act;
+    act.sa_handler = HandleStopSignal;
+    act.sa_flags = 0;
+    sigemptyset(&act.sa_mask);
+    if (sigaction(SIGINT, &act, NULL) == -1 || sigaction(SIGTERM, &act, NULL) == -1) {
+        fprintf(stderr, "[PARENT] Failed to start server: Failed to set signal handlers: %s\n", strerror(errno));
+        free(pids);
+        free(started);
+        return -1;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // Start all workers, then supervise them and restart any worker that dies
+    // -----------------------------------------------------------------------------
+    for (int i = 0; i < workers; i++) {
+        pids[i] = -1;
+        started[i] = 0;
+    }
+    pthread_mutex_lock(&workers_lock);
+    worker_pids = pids;
+    worker_count = workers;
+    pthread_mutex_unlock(&workers_lock);
+
+    while (!stop_server)
+    {
+        for (int i = 0; i < workers && !stop_server; i++)
+        {
+            if (pids[i] != -1) {
+                continue;
+            }
+            // Prevent a worker that keeps dying right away from making the parent fork in a tight loop
+            if (time(0) - started[i] < MIN_WORKER_LIFETIME) {
+                sleep(MIN_WORKER_LIFETIME);
+            }
+            pid_t pid = StartWorker(fd_listen, config, loop);
+            pthread_mutex_lock(&workers_lock);
+            pids[i] = pid;
+            pthread_mutex_unlock(&workers_lock);
+            started[i] = time(0);
+        }
+
+        // The worker is only reaped once it has been removed from the workers, so the reloader thread never sends
+        // SIGHUP to a pid that has been reused by another process
+        siginfo_t info;
+        info.si_pid = 0;
+        if (waitid(P_ALL, 0, &info, WEXITED | WNOWAIT) == -1) {
+            if (errno == ECHILD) {
+                sleep(MIN_WORKER_LIFETIME);  // No worker could be started, wait a bit before trying again
+            } else if (errno != EINTR) {
+                fprintf(stderr, "[PARENT] Failed to wait for workers: %s\n", strerror(errno));
+            }
+            continue;
+        }
+
+        pid_t pid = info.si_pid;
+        pthread_mutex_lock(&workers_lock);
+        for (int i = 0; i < workers; i++) {
+            if (pids[i] == pid) {
+                pids[i] = -1;
+            }
+        }
+        pthread_mutex_unlock(&workers_lock);
+
+        int status;
+        if (r_waitpid(pid, &status, 0) == -1) {
+            fprintf(stderr, "[PARENT] Failed to wait for worker %ld: %s\n", (long)pid, strerror(errno));
+        } else if (WIFSIGNALED(status)) {
+            fprintf(stderr, "[PARENT] Worker %ld was killed by signal %d: Restarting worker...\n", (long)pid, WTERMSIG(status));
+        } else {
+            fprintf(stderr, "[PARENT] Worker %ld exited with status %d: Restarting worker...\n", (long)pid, WEXITSTATUS(status));
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // Stop all workers
+    // -----------------------------------------------------------------------------
+    fprintf(stderr, "[PARENT] Stopping %d workers\n", workers);
+    pthread_mutex_lock(&workers_lock);
+    for (int i = 0; i < workers; i++) {
+        if (pids[i] > 0) {
+            kill(pids[i], SIGTERM);
+        }
+    }
+    worker_pids = 0;
+    worker_count = 0;
+    pthread_mutex_unlock(&workers_lock);
+    while (r_wait(NULL) > 0);
+
+    free(pids);
+    free(started);
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Signal handler for SIGINT and SIGTERM in the parent process
+ * ----------------------------------------------------------------------------
+ */
+static void HandleStopSignal(int signo)
+{
+    (void) signo;
+    stop_server = 1;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Tells all workers to load the database that the parent has just loaded, by sending them SIGHUP
+ * This is called by the database reloader thread of the parent, once the new files have been checked and their indexes
+ * have been written (see "Database_SetReloadListener"). The workers then only map the files and the indexes.
+ * Every worker still keeps its own copy of the snapshot, so the files are mapped and their checksums are checked
+ * once in every process, but the indexes are only built and written once
+ * ----------------------------------------------------------------------------
+ */
+void ReloadWorkers()
+{
+    pthread_mutex_lock(&workers_lock);
+    if (worker_pids != 0) {
+        fprintf(stderr, "[PARENT] Reloading the database in %d workers\n", worker_count);
+        for (int i = 0; i < worker_count; i++) {
+            if (worker_pids[i] > 0) {
+                kill(worker_pids[i], SIGHUP);
+            }
+        }
+    }
+    pthread_mutex_unlock(&workers_lock);
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Forks a new worker process that starts serving clients
+ *
+ * fd_listen: The file descriptor that is listening for new connections, or -1 if the worker should open its own
+ * config: The server config, used when the worker opens its own listening socket
+ * loop: The function the worker runs
+ *
+ * Returns the pid of the new worker in the parent process
+ * Returns -1 if the worker could not be started
+ * ----------------------------------------------------------------------------
+ */
+static pid_t StartWorker(int fd_listen, const ServerConfig* config, WorkerLoop loop)
+{
+    pid_t childpid;
+    if ((childpid = fork()) == -1) {
+        fprintf(stderr, "[PARENT] Failed to fork worker process: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (childpid == 0)
+    {
+        // The worker should use the default behaviour when it gets stopped by the parent
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+
+        // Every worker reloads its own copy of the database when the parent sends SIGHUP, without interrupting the client
+        // it is serving. The parent may have swapped in new files after it forked this worker, but before it could tell it
+        Database_StartReloader(false);
+        Database_Reload();
+
+        // Open a listening socket for this worker only. The kernel spreads the connections over all sockets bound to the port
+        if (fd_listen == -1 && (fd_listen = u_open_listener(config->port, config->backlog, U_REUSEPORT)) == -1) {
+            fprintf(stderr, "[%ld] Failed to open the listening socket for the worker: %s\n", GetLogId(), strerror(errno));
+            exit(1);
+        }
+        loop(fd_listen);
+        exit(0);
+    }
+
+    return childpid;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * The loop for a single worker process
+ * Accepts a connection on the shared listening socket, serves the client, and then waits for the next connection
+ * This function never returns
+ *
+ * fd_listen: The file descriptor that is listening for new connections
+ * ----------------------------------------------------------------------------
+ */
+static void RunWorker(int fd_listen)
+{
+    int fd_active;
+    char client[CLIENT_NAME_SIZE];
+
+    fprintf(stderr, "[%ld] Worker started\n", GetLogId());
+    while (true)
+    {
+        if ((fd_active = AcceptClient(fd_listen, client, CLIENT_NAME_SIZE)) == -1) {
+            fprintf(stderr, "[%ld] Failed to accept connection: %s\n", GetLogId(), strerror(errno));
+            continue;
+        }
+
+        ServeClient(fd_active, client);
+
+        if (r_close(fd_active) == -1) {
+            fprintf(stderr, "[%ld] Failed to close fd_active: %s\n", GetLogId(), strerror(errno));
+        }
+    }
+}
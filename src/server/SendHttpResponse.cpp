@@ -1,13 +1,122 @@
 
 #include "Server.h"
 
+#include "../StaticFile.h"
 #include "../libs/Restart.h"
+#include "../util/Log.h"
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
 #include <time.h>
 
+static ResponseWriter response_writer = 0;
+static FileWriter file_writer = 0;
+
+// The socket whose current request may keep the connection alive (see "SetKeepAlive")
+// Every thread serves its own connection, so this is stored per thread
+static thread_local int keep_alive_socket = -1;
+static thread_local bool keep_alive_allowed = false;
+static thread_local bool keep_alive_sent = false;
+
+// The full status line for every status code that is used, so that it can be copied straight into the header
+typedef struct {
+    int code;
+    const char* line;
+    int size;
+} StatusLine;
+
+#define STATUS_LINE(code, reason) { code, "HTTP/1.1 " #code " " reason "\r\n", sizeof("HTTP/1.1 " #code " " reason "\r\n") - 1 }
+static const StatusLine status_lines[] = {
+    STATUS_LINE(200, "OK"),
+    STATUS_LINE(404, "Not Found"),
+    STATUS_LINE(400, "Bad Request"),
+    STATUS_LINE(500, "Internal Server Error"),
+    STATUS_LINE(405, "Method Not Allowed"),
+    STATUS_LINE(505, "HTTP Version Not Supported"),
+};
+static const int STATUS_LINE_COUNT = sizeof(status_lines) / sizeof(status_lines[0]);
+
+// The "Date" header line only changes once per second, so it is formatted once and then reused by every response
+// Every thread keeps its own copy, so it can be updated without any locking
+static thread_local time_t date_time = -1;
+static thread_local char date_line[64];
+static thread_local int date_line_size = 0;
+
+static const char* ResolveConnection(int socket, const char* connection);
+static bool AppendStatusLine(char* header, int* header_size, int statuscode);
+static bool AppendDateLine(char* header, int* header_size);
+static bool AppendHeaderLine(char* header, int* header_size, const char* name, int name_size, const char* value);
+static bool AppendContentLength(char* header, int* header_size, int content_length);
+static bool Append(char* header, int* header_size, const char* data, int size);
+static int WriteResponse(int socket, struct iovec* iov, int iov_count);
+static int SendFileBlocking(int socket, int fd, int size);
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Sets the function that is used to write all HTTP responses to the socket
+ * This is used by servers with non-blocking sockets, where the response can not always be written right away.
+ * Setting the writer to 0 restores the default behaviour, where the response is written directly with a blocking "writev".
+ *
+ * writer: The function to use. It should return 0 once it has taken over the data, or -1 on failure
+ * ----------------------------------------------------------------------------
+ */
+void SetResponseWriter(ResponseWriter writer)
+{
+    response_writer = writer;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Sets the function that is used to send the content of static files to the socket (see "SendStaticFile")
+ * Setting the writer to 0 restores the default behaviour, where the file is sent directly with a blocking "sendfile".
+ *
+ * writer: The function to use. It should return 0 once it has taken over the file, or -1 on failure
+ * ----------------------------------------------------------------------------
+ */
+void SetFileWriter(FileWriter writer)
+{
+    file_writer = writer;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Sets whether the connection over the given socket may be kept alive after the current request
+ * This should be called before every request is handled. Responses sent with CONNECTION_ALIVE
+ * will only keep the connection alive if it has been allowed here, otherwise CONNECTION_CLOSE is sent instead.
+ *
+ * socket: The file descriptor the client is connected over
+ * allowed: True if the client and the server both allow the connection to be kept alive
+ * ----------------------------------------------------------------------------
+ */
+void SetKeepAlive(int socket, bool allowed)
+{
+    keep_alive_socket = socket;
+    keep_alive_allowed = allowed;
+    keep_alive_sent = false;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Checks if the connection over the given socket should be kept alive once the current request has been handled
+ * That is only the case if it was allowed by "SetKeepAlive", and every response sent since then used CONNECTION_ALIVE
+ *
+ * socket: The file descriptor the client is connected over
+ *
+ * Returns true if the connection should be kept alive, and false if it should be closed
+ * ----------------------------------------------------------------------------
+ */
+bool IsKeepAlive(int socket)
+{
+    return (socket == keep_alive_socket && keep_alive_allowed && keep_alive_sent);
+}
+
 
 /**
  * ----------------------------------------------------------------------------
@@ -19,6 +128,7 @@
  * socket: The file descriptor that represents the socket to send the http response over.
  * statuscode: The status code to use.
  * connection: The connection type in the header. Should be a valid connection type.
+ *             CONNECTION_ALIVE is replaced with CONNECTION_CLOSE if the connection can not be kept alive (see "SetKeepAlive").
  * type: The content type in the header. Should be a valid content type.
  * body: The actual body of the HTTP response.
  *
@@ -29,120 +139,266 @@
 int SendHttpResponse(int socket, int statuscode, const char* connection, const char* type, const char* body)
 {
     if (statuscode < 100 || statuscode >= 600) {
-        fprintf(stderr, "[%ld] Failed to send HTTP Response: Invalid status code\n", (long)getpid());
+        fprintf(stderr, "[%ld] Failed to send HTTP Response: Invalid status code\n", GetLogId());
         return -1;
     }
 
-    // Convert the status code into a string
-    int digit3 = (statuscode / 100);
-    int digit2 = ((statuscode - (digit3 * 100)) / 10);
-    int digit1 = (statuscode - (digit3 * 100) - (digit2 * 10));
-    char statuscode_str[5];
-    statuscode_str[0] = (char) (((int)'0') + digit3);
-    statuscode_str[1] = (char) (((int)'0') + digit2);
-    statuscode_str[2] = (char) (((int)'0') + digit1);
-    statuscode_str[3] = ' ';
-    statuscode_str[4] = '\0';
-
-
-    // Create the individual header lines
-    char status_line[LINE_MAX_SIZE];
-    strcpy(status_line, "HTTP/1.1 ");
-    strcat(status_line, statuscode_str);
-    if (statuscode == 200)
-        strcat(status_line, "OK");
-    else if (statuscode == 201)
-        strcat(status_line, "Created");
-    else if (statuscode == 202)
-        strcat(status_line, "Accepted");
-    else if (statuscode == 204)
-        strcat(status_line, "No Content");
-    else if (statuscode == 206)
-        strcat(status_line, "Partial Content");
-    else if (statuscode == 400)
-        strcat(status_line, "Bad Request");
-    else if (statuscode == 401)
-        strcat(status_line, "Unauthorized");
-    else if (statuscode == 403)
-        strcat(status_line, "Forbidden");
-    else if (statuscode == 404)
-        strcat(status_line, "Not Found");
-    else if (statuscode == 500)
-        strcat(status_line, "Internal Server Error");
-    else
-        strcat(status_line, " No-Response-Phrase");
-    strcat(status_line, "\r\n");
-
-    char date[32];
-    time_t time_now;
-    struct tm ts;
-    time_now = time(0);
-    ts = *gmtime(&time_now);
-    strftime(date, LINE_MAX_SIZE, "%a, %d %b %Y %H:%M:%S %Z", &ts);
-
-    char date_line[LINE_MAX_SIZE];
-    strcpy(date_line, "Date: ");
-    strcat(date_line, date);
-    strcat(date_line, "\r\n");
-
-    char connection_line[LINE_MAX_SIZE];
-    if (connection != 0) {
-        strcpy(connection_line, "Connection: ");
-        strcat(connection_line, connection);
-        strcat(connection_line, "\r\n");
+    connection = ResolveConnection(socket, connection);
+
+    // The length of the body is always sent, so the client knows where the response ends on a persistent connection
+    int body_size = 0;
+    if (body != 0)
+        body_size = strlen(body) + 1;  // The extra character is for the '\n' that will be added at the end
+
+
+    // Copy all header lines into one small buffer. The body is never copied, it is sent straight from the given string
+    char header[HEADER_MAX_SIZE];
+    int header_size = 0;
+    bool header_created = AppendStatusLine(header, &header_size, statuscode) && AppendDateLine(header, &header_size);
+    if (header_created && connection != 0)
+        header_created = AppendHeaderLine(header, &header_size, "Connection: ", 12, connection);
+    if (header_created && type != 0)
+        header_created = AppendHeaderLine(header, &header_size, "Content-Type: ", 14, type);
+    header_created = header_created && AppendContentLength(header, &header_size, body_size) && Append(header, &header_size, "\r\n", 2);
+    if (!header_created) {
+        fprintf(stderr, "[%ld] Failed to send HTTP Response: The header is too large\n", GetLogId());
+        if (socket == keep_alive_socket) { keep_alive_allowed = false; }
+        return -1;
     }
 
-    char type_line[LINE_MAX_SIZE];
-    if (type != 0) {
-        strcpy(type_line, "Content-Type: ");
-        strcat(type_line, type);
-        strcat(type_line, "\r\n");
+    struct iovec iov[3];
+    int iov_count = 1;
+    iov[0].iov_base = header;
+    iov[0].iov_len = header_size;
+    if (body != 0) {
+        iov[1].iov_base = (void*) body;
+        iov[1].iov_len = body_size - 1;
+        iov[2].iov_base = (void*) "\n";  // The body should end with a newline character
+        iov[2].iov_len = 1;
+        iov_count = 3;
     }
 
-    int status_line_size = strlen(status_line);
-    int date_line_size = strlen(date_line);
-    int connection_line_size = 0;
-    int type_line_size = 0;
-    if (connection != 0)
-        connection_line_size = strlen(connection_line);
-    if (type != 0)
-        type_line_size = strlen(type_line);
-
-    // Combine all the individual lines into a full HTTP Header
-    int HEADER_SIZE = status_line_size + date_line_size + connection_line_size + type_line_size + (sizeof(char) * 3);
-    char header[HEADER_SIZE];
-    strcpy(header, status_line);
-    strcat(header, date_line);
-    if (connection != 0)
-        strcat(header, connection_line);
-    if (type != 0)
-        strcat(header, type_line);
-    if (body != 0)
-        strcat(header, "\r\n");
+    // Send the header and the body together, without combining them into one buffer first
+    if (WriteResponse(socket, iov, iov_count) == -1) {
+        fprintf(stderr, "[%ld] Failed to send HTTP Response: %s\n", GetLogId(), strerror(errno));
+        if (socket == keep_alive_socket) { keep_alive_allowed = false; }
+        return -1;
+    }
 
+    return 0;
+}
 
-    // Combine the header and body into a full HTTP Response
-    int BODY_SIZE = 0;
-    if (body != 0)
-        BODY_SIZE = strlen(body) + 1;  // The extra character is for the '\n' that will be added at the end
-    int RESPONSE_SIZE = (HEADER_SIZE + BODY_SIZE);
-    char http_response[RESPONSE_SIZE];
-    strcpy(http_response, header);
-    if (body != 0) {
-        strcat(http_response, body);
-        strcat(http_response, "\n");  // The body should end with a newline character
+
+/**
+ * ----------------------------------------------------------------------------
+ * Sends a static file as a "200 OK" response over the given socket
+ * The header is built from the lines that were precomputed when the file was opened (see "StaticFile_OpenAll"),
+ * and the content is sent with "sendfile" directly from the open file, so it is never copied into the process.
+ *
+ * socket: The file descriptor that represents the socket to send the http response over.
+ * connection: The connection type in the header (see "SendHttpResponse")
+ * path: The path to the static file
+ *
+ * Returns 0 on success
+ * Returns -1 on failure
+ * Returns -2 if the file is not a static file that has been opened. Nothing is sent in that case
+ * ----------------------------------------------------------------------------
+ */
+int SendStaticFile(int socket, const char* connection, const char* path)
+{
+    const StaticFile* file = 0;
+    if (StaticFile_Get(path, &file) == -2) {
+        return -2;
     }
 
-    // Send the full HTTP Response over the socket
-    // Using (RESPONSE_SIZE - 1) for the size, since '\0' is not needed and actually prevents javascript files from working
-    if (r_write(socket, http_response, RESPONSE_SIZE - 1) == -1) {
-        fprintf(stderr, "[%ld] Failed to send HTTP Response: r_write failed: %s\n", (long)getpid(), strerror(errno));
+    connection = ResolveConnection(socket, (connection != 0) ? connection : CONNECTION_CLOSE);
+
+    // Only the connection line differs between the responses, the rest is copied from the cached lines
+    char header[HEADER_MAX_SIZE];
+    int header_size = 0;
+    if (!AppendStatusLine(header, &header_size, 200) || !AppendDateLine(header, &header_size) ||
+        !AppendHeaderLine(header, &header_size, "Connection: ", 12, connection) || !Append(header, &header_size, file->header, file->header_size))
+    {
+        fprintf(stderr, "[%ld] Failed to send static file: %s: The header is too large\n", GetLogId(), path);
+        if (socket == keep_alive_socket) { keep_alive_allowed = false; }
         return -1;
     }
 
+    struct iovec iov;
+    iov.iov_base = header;
+    iov.iov_len = header_size;
+
+    int result = 0;
+    if (response_writer && file_writer) {
+        result = (response_writer(socket, &iov, 1) == -1 || file_writer(socket, file->fd, 0, file->size) == -1) ? -1 : 0;
+    } else {
+        result = (r_writev(socket, &iov, 1) == -1 || SendFileBlocking(socket, file->fd, file->size) == -1) ? -1 : 0;
+    }
+    if (result == -1) {
+        fprintf(stderr, "[%ld] Failed to send static file: %s: %s\n", GetLogId(), path, strerror(errno));
+        if (socket == keep_alive_socket) { keep_alive_allowed = false; }
+        return -1;
+    }
     return 0;
 }
 
 
+/**
+ * ----------------------------------------------------------------------------
+ * Only keeps the connection alive if it is allowed for the current request (see "SetKeepAlive")
+ * Returns the connection type that should be sent in the header
+ * ----------------------------------------------------------------------------
+ */
+static const char* ResolveConnection(int socket, const char* connection)
+{
+    bool keep_alive = (connection != 0 && strcmp(connection, CONNECTION_ALIVE) == 0);
+    if (keep_alive && (socket != keep_alive_socket || !keep_alive_allowed)) {
+        connection = CONNECTION_CLOSE;
+        keep_alive = false;
+    }
+    if (socket == keep_alive_socket) {
+        keep_alive_allowed = keep_alive;
+        keep_alive_sent = keep_alive;
+    }
+    return connection;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Appends the status line for the status code to the header
+ * Status codes that are not in the table get the reason phrase "No-Response-Phrase"
+ * Returns true on success, and false if the header is full
+ * ----------------------------------------------------------------------------
+ */
+static bool AppendStatusLine(char* header, int* header_size, int statuscode)
+{
+    for (int i = 0; i < STATUS_LINE_COUNT; i++) {
+        if (status_lines[i].code == statuscode) {
+            return Append(header, header_size, status_lines[i].line, status_lines[i].size);
+        }
+    }
+
+    char line[LINE_MAX_SIZE];
+    int size = snprintf(line, LINE_MAX_SIZE, "HTTP/1.1 %d No-Response-Phrase\r\n", statuscode);
+    return Append(header, header_size, line, size);
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Appends the "Date" header line to the header
+ * The line is only formatted again when the time has changed since the last response
+ * Returns true on success, and false if the header is full
+ * ----------------------------------------------------------------------------
+ */
+static bool AppendDateLine(char* header, int* header_size)
+{
+    time_t time_now = time(0);
+    if (time_now != date_time)
+    {
+        struct tm ts;
+        gmtime_r(&time_now, &ts);
+        date_line_size = strftime(date_line, sizeof(date_line), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &ts);
+        date_time = time_now;
+    }
+    return Append(header, header_size, date_line, date_line_size);
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Appends a header line to the header
+ * name: The name of the header, including the ": " after it
+ * name_size: The size of the name
+ * value: The value of the header
+ * Returns true on success, and false if the header is full
+ * ----------------------------------------------------------------------------
+ */
+static bool AppendHeaderLine(char* header, int* header_size, const char* name, int name_size, const char* value)
+{
+    return Append(header, header_size, name, name_size) && Append(header, header_size, value, strlen(value)) && Append(header, header_size, "\r\n", 2);
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Appends the "Content-Length" header line to the header
+ * Returns true on success, and false if the header is full
+ * ----------------------------------------------------------------------------
+ */
+static bool AppendContentLength(char* header, int* header_size, int content_length)
+{
+    // Write the digits from the back of the line
+    char line[32];
+    int start = sizeof(line);
+    line[--start] = '\n';
+    line[--start] = '\r';
+    do {
+        line[--start] = (char)('0' + (content_length % 10));
+        content_length /= 10;
+    } while (content_length > 0);
+    start -= 16;
+    memcpy(&(line[start]), "Content-Length: ", 16);
+    return Append(header, header_size, &(line[start]), sizeof(line) - start);
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Copies the bytes to the end of the header
+ * Returns true on success, and false if the header is full
+ * ----------------------------------------------------------------------------
+ */
+static bool Append(char* header, int* header_size, const char* data, int size)
+{
+    if (*header_size + size > HEADER_MAX_SIZE) {
+        return false;
+    }
+    memcpy(&(header[*header_size]), data, size);
+    *header_size += size;
+    return true;
+}
 
 
+/**
+ * ----------------------------------------------------------------------------
+ * Writes all the given buffers to the socket, in order
+ * Uses the response writer if one has been set (see "SetResponseWriter"), otherwise a blocking "writev".
+ * Partial writes are continued until everything has been written.
+ * Returns 0 on success, and -1 on failure
+ * ----------------------------------------------------------------------------
+ */
+static int WriteResponse(int socket, struct iovec* iov, int iov_count)
+{
+    if (response_writer) {
+        return response_writer(socket, iov, iov_count);
+    }
+    return (r_writev(socket, iov, iov_count) == -1) ? -1 : 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Sends the first "size" bytes of the file over a blocking socket
+ * Returns 0 on success, and -1 on failure
+ * ----------------------------------------------------------------------------
+ */
+static int SendFileBlocking(int socket, int fd, int size)
+{
+    off_t offset = 0;
+    while (offset < size)
+    {
+        ssize_t bytes = sendfile(socket, fd, &offset, size - offset);
+        if (bytes == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytes == 0) {
+            errno = EIO;  // The file is shorter than when it was opened
+        }
+        if (bytes <= 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
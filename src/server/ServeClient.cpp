@@ -0,0 +1,85 @@
+#include "Server.h"
+
+#include "../util/Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/**
+ * ------------------------------------------------------------------------------------------------
+ * Serves a client that is connected over the given socket
+ * The messages from the client are read and parsed, and then handled and responded to.
+ * Requests are served one after another over the same socket for as long as the connection is kept alive,
+ * which is until the client asks to close it, is idle for CONNECTION_IDLE_TIMEOUT seconds, or
+ * CONNECTION_MAX_REQUESTS requests have been served.
+ * The socket is not closed by this function, that is up to the caller
+ *
+ * socket: The file descriptor the client is connected over
+ * client: The name of the connected client, only used for printing messages
+ *
+ * Returns 0 on success
+ * Returns -1 if a request could not be read, or could not be handled and responded to correctly
+ * ------------------------------------------------------------------------------------------------
+ */
+int ServeClient(int socket, char* client)
+{
+    fprintf(stderr, "[%ld] Client connected: %s\n", GetLogId(), client);
+
+    int requests = 0;
+    char* received = 0;  // Bytes that were received after the previous request, when the client pipelines its requests
+    int received_size = 0;
+    while (requests < CONNECTION_MAX_REQUESTS)
+    {
+        // Read and parse the message received from the client over the socket
+        Request request;
+        int result = ReadClientRequest(socket, &request, received, received_size);
+        received = 0;
+        received_size = 0;
+        if (result == -2) {
+            break;  // The client closed the connection, or stopped sending requests
+        }
+        if (result == -1) {
+            fprintf(stderr, "[%ld] Failed to read and parse client request: Closing connection...\n", GetLogId());
+            fprintf(stderr, "[%ld] %s disconnected\n", GetLogId(), client);
+            return -1;
+        }
+        requests++;
+
+
+        if (request.query) {
+            fprintf(stderr, "[%ld] Client request line: %s %s?%s %s\n", GetLogId(), request.method, request.path, request.query, request.protocol);
+        } else {
+            fprintf(stderr, "[%ld] Client request line: %s %s %s\n", GetLogId(), request.method, request.path, request.protocol);
+        }
+
+
+        // Handle the client request and respond to it
+        // The connection is still kept alive if an error response was sent successfully
+        SetKeepAlive(socket, IsKeepAliveRequest(&request) && requests < CONNECTION_MAX_REQUESTS);
+        int handled = HandleClientRequest(socket, &request);
+
+        // Keep the start of the next request, if it was received together with this one
+        if (IsKeepAlive(socket) && (received_size = GetPipelinedSize(&request)) > 0) {
+            memmove(request.buffer, &(request.buffer[request.header_size]), received_size);
+            received = request.buffer;
+        }
+        else if (request.buffer) {
+            free(request.buffer);
+        }
+        if (handled == -1 && !IsKeepAlive(socket)) {
+            fprintf(stderr, "[%ld] Failed to handle the client request: Closing connection...\n", GetLogId());
+            fprintf(stderr, "[%ld] %s disconnected\n", GetLogId(), client);
+            return -1;
+        }
+        if (!IsKeepAlive(socket)) {
+            break;
+        }
+    }
+
+
+    if (received) { free(received); }
+    fprintf(stderr, "[%ld] %s disconnected\n", GetLogId(), client);
+    return 0;
+}
@@ -1,16 +1,29 @@
 
 #pragma once
 
+#include <sys/uio.h>
+
 #define REQUEST_MAX_SIZE 32768
 #define LINE_MAX_SIZE 256
+#define HEADER_MAX_SIZE 1024  // The max size of the header of a response, the body is sent separately
 #define CONNECTION_CLOSE "close"
 #define CONNECTION_ALIVE "keep-alive"
 #define TYPE_HTML "text/html; charset=iso-8859-1"
 #define TYPE_JSON "application/json"
+#define TYPE_JAVASCRIPT "text/javascript"
+
+#define CONNECTION_IDLE_TIMEOUT 15  // Seconds a connection can be idle, while waiting for a request, before it gets closed
+#define CONNECTION_MAX_REQUESTS 100  // The number of requests that can be served over a single persistent connection
+
+#define SERVER_MODE_FORK    0  // One new child process for each connection
+#define SERVER_MODE_PREFORK 1  // A fixed pool of long-lived worker processes
+#define SERVER_MODE_EVENT   2  // A fixed pool of worker processes that each run a non-blocking event loop
+#define SERVER_MODE_THREAD  3  // A single process with a fixed pool of threads
 
 typedef struct {
     char* buffer = 0;  
     int buffer_size = 0;
+    int header_size = 0;  // The number of bytes up to and including the empty line that ends the headers, 0 if not known
 
     // Substrings - Pointers to different locations in the buffer above
     char* protocol = 0;
@@ -20,10 +33,54 @@ typedef struct {
     char* path = 0;
     char* query = 0;
     char* headers = 0;
+    int headers_size = 0;  // The size of the header lines, not including the empty line
     char* body = 0;
 } Request;
 
-int ReadClientRequest(int socket, Request* request);
+// A string inside another buffer, which is not null-terminated
+typedef struct {
+    char* data;
+    int size;
+} StringView;
+
+typedef struct {
+    unsigned short port = 80;
+    int mode = SERVER_MODE_PREFORK;
+    int workers = 0;  // The number of worker processes, or threads. Uses the number of cores if set to 0
+    int backlog = 0;  // The max number of pending connections on the listening socket. Uses SOMAXCONN if set to 0
+    bool reuseport = false;  // Every worker process opens its own listening socket with SO_REUSEPORT
+    bool resolve_names = false;  // Look up the names of the clients in the background, to be used in the logs
+    bool convert_database = false;  // Convert the database files to the current version of the v2 format, fold the delta into them, and exit instead of starting the server
+} ServerConfig;
+
+// Used to replace how responses are written to the socket, e.g. by servers that use non-blocking sockets
+typedef int (*ResponseWriter)(int socket, struct iovec* iov, int iov_count);
+typedef int (*FileWriter)(int socket, int fd, long offset, int size);
+
+// The loop that each worker process runs
+typedef void (*WorkerLoop)(int fd_listen);
+
+int ReadClientRequest(int socket, Request* request, char* received, int received_size);
+int FindEndOfHeaders(const char* buffer, int size, int* scanned);
+int ParseClientRequest(Request* request);
+int GetRequestHeader(Request* request, const char* name, StringView* value);
+bool IsKeepAliveRequest(Request* request);
+int GetPipelinedSize(Request* request);
 int HandleClientRequest(int socket, Request* request);
 int SendHttpResponse(int socket, int statuscode, const char* connection, const char* type, const char* body);
+int SendStaticFile(int socket, const char* connection, const char* path);
+int ServeClient(int socket, char* client);
+int AcceptClient(int fd_listen, char* client, int client_size);
+void SetClientNameResolution(bool enabled);
+void SetResponseWriter(ResponseWriter writer);
+void SetFileWriter(FileWriter writer);
+void SetKeepAlive(int socket, bool allowed);
+bool IsKeepAlive(int socket);
+
+int RunServer_Fork(int fd_listen);
+int RunServer_Prefork(int fd_listen, const ServerConfig* config);
+int RunServer_Event(int fd_listen, const ServerConfig* config);
+int RunServer_Thread(int fd_listen, int threads);
+int RunWorkers(int fd_listen, const ServerConfig* config, WorkerLoop loop);
+void ReloadWorkers();
 
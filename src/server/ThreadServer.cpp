@@ -0,0 +1,219 @@
+#include "Server.h"
+
+#include "../libs/Restart.h"
+#include "../util/Log.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIENT_NAME_SIZE 255
+#define QUEUE_SIZE 1024  // The max number of accepted connections waiting in the queue of a single thread
+
+typedef struct {
+    int fd;
+    char client[CLIENT_NAME_SIZE];
+} PendingConnection;
+
+// Every thread has its own queue of accepted connections. New connections are added to the back,
+// the owner takes connections from the front, and idle threads steal connections from the back
+typedef struct {
+    pthread_mutex_t lock;
+    PendingConnection connections[QUEUE_SIZE];
+    int front;
+    int size;
+} WorkQueue;
+
+static WorkQueue* queues = 0;
+static int queue_count = 0;
+
+// Used by idle threads to wait for new connections
+static pthread_mutex_t pending_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
+static int pending = 0;  // The number of connections waiting in all queues
+
+static void* RunThread(void* arg);
+static bool PushConnection(WorkQueue* queue, int fd, const char* client);
+static bool TakeConnection(int index, PendingConnection* connection);
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Runs the server in a single process with a fixed pool of threads
+ * The calling thread accepts the connections and hands them out to the queues of the threads in turn.
+ * A thread that runs out of connections steals from the queues of the other threads,
+ * so that a thread that is busy with a slow client does not hold up the connections waiting for it.
+ * All threads share the same in-memory database (see "Database_Preload"), which is reloaded by a thread of its own
+ *
+ * fd_listen: The file descriptor that is listening for new connections
+ * threads: The number of threads to start
+ *
+ * Returns -1 if the server could not be started. Otherwise the function never returns
+ * ----------------------------------------------------------------------------
+ */
+int RunServer_Thread(int fd_listen, int threads)
+{
+    if (threads <= 0) {
+        fprintf(stderr, "[PARENT] Failed to start server: Invalid number of threads: %d\n", threads);
+        return -1;
+    }
+
+    if ((queues = (WorkQueue*) malloc(threads * sizeof(WorkQueue))) == 0) {
+        fprintf(stderr, "[PARENT] Failed to start server: Failed to allocate memory for the work queues\n");
+        return -1;
+    }
+    queue_count = threads;
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&(queues[i].lock), NULL);
+        queues[i].front = 0;
+        queues[i].size = 0;
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_t thread;
+        int error;
+        if ((error = pthread_create(&thread, NULL, RunThread, (void*)(long) i)) != 0) {
+            fprintf(stderr, "[PARENT] Failed to start server: Failed to create thread: %s\n", strerror(error));
+            return -1;
+        }
+        pthread_detach(thread);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // Accept new connections and add them to the queues of the threads in turn
+    // -----------------------------------------------------------------------------
+    int fd_active;
+    char client[CLIENT_NAME_SIZE];
+    int next = 0;
+    while (true)
+    {
+        if ((fd_active = AcceptClient(fd_listen, client, CLIENT_NAME_SIZE)) == -1) {
+            fprintf(stderr, "[%ld] Failed to accept connection: %s\n", GetLogId(), strerror(errno));
+            continue;
+        }
+
+        // Use the next queue that is not full
+        bool added = false;
+        for (int i = 0; i < queue_count && !added; i++) {
+            added = PushConnection(&(queues[next]), fd_active, client);
+            next = (next + 1) % queue_count;
+        }
+        if (!added) {
+            fprintf(stderr, "[%ld] Too many pending connections: Closing connection from %s\n", GetLogId(), client);
+            r_close(fd_active);
+            continue;
+        }
+
+        pthread_mutex_lock(&pending_lock);
+        pending++;
+        pthread_cond_signal(&pending_cond);
+        pthread_mutex_unlock(&pending_lock);
+    }
+
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * The loop for a single thread
+ * Takes a connection from the queues, serves the client, and then takes the next connection
+ *
+ * arg: The index of the queue owned by the thread
+ * ----------------------------------------------------------------------------
+ */
+static void* RunThread(void* arg)
+{
+    int index = (int)(long) arg;
+    PendingConnection connection;
+
+    fprintf(stderr, "[%ld] Thread started\n", GetLogId());
+    while (true)
+    {
+        // Wait until there is a connection waiting in any of the queues
+        pthread_mutex_lock(&pending_lock);
+        while (pending == 0) {
+            pthread_cond_wait(&pending_cond, &pending_lock);
+        }
+        pending--;
+        pthread_mutex_unlock(&pending_lock);
+
+        // One connection has been reserved for this thread, so keep looking until it is found
+        while (!TakeConnection(index, &connection));
+
+        ServeClient(connection.fd, connection.client);
+
+        if (r_close(connection.fd) == -1) {
+            fprintf(stderr, "[%ld] Failed to close fd_active: %s\n", GetLogId(), strerror(errno));
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Adds a connection to the back of the queue
+ * Returns true on success, and false if the queue is full
+ * ----------------------------------------------------------------------------
+ */
+static bool PushConnection(WorkQueue* queue, int fd, const char* client)
+{
+    pthread_mutex_lock(&(queue->lock));
+    if (queue->size == QUEUE_SIZE) {
+        pthread_mutex_unlock(&(queue->lock));
+        return false;
+    }
+
+    PendingConnection* connection = &(queue->connections[(queue->front + queue->size) % QUEUE_SIZE]);
+    connection->fd = fd;
+    snprintf(connection->client, CLIENT_NAME_SIZE, "%s", client);
+    queue->size++;
+
+    pthread_mutex_unlock(&(queue->lock));
+    return true;
+}
+
+
+/**
+ * ----------------------------------------------------------------------------
+ * Takes a connection from the front of the thread's own queue
+ * If the own queue is empty, a connection is stolen from the back of the queue of another thread
+ *
+ * index: The index of the queue owned by the thread
+ * connection: Set to the connection that was taken
+ *
+ * Returns true if a connection was taken, and false if all queues are empty
+ * ----------------------------------------------------------------------------
+ */
+static bool TakeConnection(int index, PendingConnection* connection)
+{
+    WorkQueue* queue = &(queues[index]);
+    pthread_mutex_lock(&(queue->lock));
+    if (queue->size > 0) {
+        *connection = queue->connections[queue->front];
+        queue->front = (queue->front + 1) % QUEUE_SIZE;
+        queue->size--;
+        pthread_mutex_unlock(&(queue->lock));
+        return true;
+    }
+    pthread_mutex_unlock(&(queue->lock));
+
+    for (int i = 1; i < queue_count; i++)
+    {
+        queue = &(queues[(index + i) % queue_count]);
+        pthread_mutex_lock(&(queue->lock));
+        if (queue->size > 0) {
+            queue->size--;
+            *connection = queue->connections[(queue->front + queue->size) % QUEUE_SIZE];
+            pthread_mutex_unlock(&(queue->lock));
+            return true;
+        }
+        pthread_mutex_unlock(&(queue->lock));
+    }
+    return false;
+}
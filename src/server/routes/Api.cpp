@@ -7,6 +7,7 @@
 #include "../Server.h"
 #include "../../util/StringUtil.h"
 #include "../../api/api.h"
+#include "../../util/Log.h"
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -23,8 +24,8 @@
  */
 static int SendAndPrint_MethodNotAllowed(int socket, Request* request)
 {
-    SendHttpResponse(socket, 405, CONNECTION_CLOSE, TYPE_HTML, "Method Not Allowed: The API call exist but the method is not allowed");
-    fprintf(stderr, "[%ld] Method Not Allowed: The request path was valid: %s, but the method is not allowed: %s\n", (long)getpid(), request->path, request->method);
+    SendHttpResponse(socket, 405, CONNECTION_ALIVE, TYPE_HTML, "Method Not Allowed: The API call exist but the method is not allowed");
+    fprintf(stderr, "[%ld] Method Not Allowed: The request path was valid: %s, but the method is not allowed: %s\n", GetLogId(), request->path, request->method);
     return 0;
 }
 
@@ -183,8 +184,8 @@ int Route_Api(int socket, Request* request)
     // -------------------------------------------------------------------
     // Not Found: Invalid API call
     // -------------------------------------------------------------------
-    SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "Not Found: The requested API call was not found");
-    fprintf(stderr, "[%ld] Not Found: The api call given by the client was not found: %s\n", (long)getpid(), request->path);
+    SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "Not Found: The requested API call was not found");
+    fprintf(stderr, "[%ld] Not Found: The api call given by the client was not found: %s\n", GetLogId(), request->path);
     return 0;
 }
 
@@ -4,6 +4,7 @@
 #include "../Server.h"
 #include "../../LoadFile.h"  // Remove later
 #include "../../pages/CreatePages.h"
+#include "../../util/Log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,8 +18,8 @@ int Route_AthletePage(int socket, Request* request)
     // ---------------------------------------------------
     if (strcmp(request->method, "GET") != 0)
     {
-        SendHttpResponse(socket, 405, CONNECTION_CLOSE, TYPE_HTML, "Method Not Allowed: The resource was found but the method is not allowed");
-        fprintf(stderr, "[%ld] Method Not Allowed: The request path was valid: %s, but the method is not allowed: %s\n", (long)getpid(), request->path, request->method);
+        SendHttpResponse(socket, 405, CONNECTION_ALIVE, TYPE_HTML, "Method Not Allowed: The resource was found but the method is not allowed");
+        fprintf(stderr, "[%ld] Method Not Allowed: The request path was valid: %s, but the method is not allowed: %s\n", GetLogId(), request->path, request->method);
         return 0;
     }
 
@@ -32,8 +33,8 @@ int Route_AthletePage(int socket, Request* request)
     }
     if (fiscode <= 0)
     {
-        SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "Not Found: Invalid fiscode");
-        fprintf(stderr, "[%ld] Not Found: Failed to create athlete page. Invalid fiscode was given in the query parameter: %s\n", (long)getpid(), request->query);
+        SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "Not Found: Invalid fiscode");
+        fprintf(stderr, "[%ld] Not Found: Failed to create athlete page. Invalid fiscode was given in the query parameter: %s\n", GetLogId(), request->query);
         return 0;
     }
 
@@ -47,19 +48,19 @@ int Route_AthletePage(int socket, Request* request)
     if ((res = CreatePage_Athlete(fiscode, &PageBuffer, &PageBuffer_size)) < 0)
     {
         if (res == -2) {
-            SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "Not Found: The requested fiscode could not be found");
-            fprintf(stderr, "[%ld] Not Found: Failed to create the athlete page since the requested fiscode could not be found: %s\n", (long)getpid(), request->query);
+            SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "Not Found: The requested fiscode could not be found");
+            fprintf(stderr, "[%ld] Not Found: Failed to create the athlete page since the requested fiscode could not be found: %s\n", GetLogId(), request->query);
         }
         else {
-            SendHttpResponse(socket, 500, CONNECTION_CLOSE, TYPE_HTML, "Server Error: Failed to create the requested resource");
-            fprintf(stderr, "[%ld] Server Error: Failed to create the athlete page for the requested fiscode: %s\n", (long)getpid(), request->query);
+            SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "Server Error: Failed to create the requested resource");
+            fprintf(stderr, "[%ld] Server Error: Failed to create the athlete page for the requested fiscode: %s\n", GetLogId(), request->query);
         }
         if (PageBuffer) { free(PageBuffer); }
         return 0; 
     }
 
-    SendHttpResponse(socket, 200, CONNECTION_CLOSE, TYPE_HTML, PageBuffer);
-    fprintf(stderr, "[%ld] OK: The requested athlete page for (%s) was created and sent back to the client\n", (long)getpid(), request->query);
+    SendHttpResponse(socket, 200, CONNECTION_ALIVE, TYPE_HTML, PageBuffer);
+    fprintf(stderr, "[%ld] OK: The requested athlete page for (%s) was created and sent back to the client\n", GetLogId(), request->query);
     if (PageBuffer) { free(PageBuffer); }
     
     return 0;
@@ -85,8 +86,8 @@ int OLD_OLD_OLD_Route_AthletePage(int socket, Request* request)
 {
     if (strcmp(request->method, "GET") != 0)
     {
-        SendHttpResponse(socket, 405, CONNECTION_CLOSE, TYPE_HTML, "Method Not Allowed: The resource was found but the method is not allowed");
-        fprintf(stderr, "[%ld] Method Not Allowed: The request path was valid: %s, but the method is not allowed: %s\n", (long)getpid(), request->path, request->method);
+        SendHttpResponse(socket, 405, CONNECTION_ALIVE, TYPE_HTML, "Method Not Allowed: The resource was found but the method is not allowed");
+        fprintf(stderr, "[%ld] Method Not Allowed: The request path was valid: %s, but the method is not allowed: %s\n", GetLogId(), request->path, request->method);
         return 0;
     }
 
@@ -107,8 +108,8 @@ int OLD_OLD_OLD_Route_AthletePage(int socket, Request* request)
         file = &(FILE_MAIN[0]);
     }
     else {
-        SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "Not Found: The requested resource was not found");
-        fprintf(stderr, "[%ld] Not Found: The path given by the client was not found: %s\n", (long)getpid(), request->path);
+        SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "Not Found: The requested resource was not found");
+        fprintf(stderr, "[%ld] Not Found: The path given by the client was not found: %s\n", GetLogId(), request->path);
         return 0;  // Return 0 since the client request was technically handled
     }
     
@@ -117,13 +118,13 @@ int OLD_OLD_OLD_Route_AthletePage(int socket, Request* request)
     if (LoadFile(file, &buffer, &buffer_size) < 0) 
     {
         if (buffer) { free(buffer); }
-        SendHttpResponse(socket, 500, CONNECTION_CLOSE, TYPE_HTML, "Server Error: Failed to load the request resource");
-        fprintf(stderr, "[%ld] Server Error: Failed to load the request resource: %s\n", (long)getpid(), request->path);
+        SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "Server Error: Failed to load the request resource");
+        fprintf(stderr, "[%ld] Server Error: Failed to load the request resource: %s\n", GetLogId(), request->path);
         return 0;  // Return 0 since the client request was technically handled
     }
 
-    SendHttpResponse(socket, 200, CONNECTION_CLOSE, TYPE_HTML, buffer);
-    fprintf(stderr, "[%ld] OK: The requested resource (%s) was found and sent back to the client\n", (long)getpid(), request->path);
+    SendHttpResponse(socket, 200, CONNECTION_ALIVE, TYPE_HTML, buffer);
+    fprintf(stderr, "[%ld] OK: The requested resource (%s) was found and sent back to the client\n", GetLogId(), request->path);
     return 0;
 }
 
@@ -2,7 +2,7 @@
 #include "Routes.h"
 
 #include "../Server.h"
-#include "../../LoadFile.h"
+#include "../../util/Log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,8 +25,8 @@ int Route_HomePage(int socket, Request* request)
 {
     if (strcmp(request->method, "GET") != 0)
     {
-        SendHttpResponse(socket, 405, CONNECTION_CLOSE, TYPE_HTML, "Method Not Allowed: The resource was found but the method is not allowed");
-        fprintf(stderr, "[%ld] Method Not Allowed: The request path was valid: %s, but the method is not allowed: %s\n", (long)getpid(), request->path, request->method);
+        SendHttpResponse(socket, 405, CONNECTION_ALIVE, TYPE_HTML, "Method Not Allowed: The resource was found but the method is not allowed");
+        fprintf(stderr, "[%ld] Method Not Allowed: The request path was valid: %s, but the method is not allowed: %s\n", GetLogId(), request->path, request->method);
         return 0;
     }
     
@@ -45,23 +45,24 @@ int Route_HomePage(int socket, Request* request)
         file = &(FILE_MAIN[0]);
     }
     else {
-        SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "Not Found: The requested resource was not found");
-        fprintf(stderr, "[%ld] Not Found: The path given by the client was not found: %s\n", (long)getpid(), request->path);
+        SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "Not Found: The requested resource was not found");
+        fprintf(stderr, "[%ld] Not Found: The path given by the client was not found: %s\n", GetLogId(), request->path);
         return 0;  // Return 0 since the client request was technically handled
     }
     
-    char* buffer = 0;
-    int buffer_size = 0;
-    if (LoadFile(file, &buffer, &buffer_size) < 0) 
+    // The file is sent directly from the open file, without being loaded into memory
+    int res = SendStaticFile(socket, CONNECTION_ALIVE, file);
+    if (res == -2)
     {
-        if (buffer) { free(buffer); }
-        SendHttpResponse(socket, 500, CONNECTION_CLOSE, TYPE_HTML, "Server Error: Failed to load the request resource");
-        fprintf(stderr, "[%ld] Server Error: Failed to load the request resource: %s\n", (long)getpid(), request->path);
+        SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "Server Error: Failed to load the request resource");
+        fprintf(stderr, "[%ld] Server Error: Failed to load the request resource: %s\n", GetLogId(), request->path);
         return 0;  // Return 0 since the client request was technically handled
     }
+    if (res == -1) {
+        return -1;
+    }
 
-    SendHttpResponse(socket, 200, CONNECTION_CLOSE, TYPE_HTML, buffer);
-    fprintf(stderr, "[%ld] OK: The requested resource (%s) was found and sent back to the client\n", (long)getpid(), request->path);
+    fprintf(stderr, "[%ld] OK: The requested resource (%s) was found and sent back to the client\n", GetLogId(), request->path);
     return 0;
 }
 
@@ -3,6 +3,7 @@
 
 #include "../Server.h"
 #include "../../pages/CreatePages.h"
+#include "../../util/Log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -28,8 +29,8 @@ int Route_RacePage(int socket, Request* request)
     // ----------------------------------------------
     if (strcmp(request->method, "GET") != 0)
     {
-        SendHttpResponse(socket, 405, CONNECTION_CLOSE, TYPE_HTML, "Method Not Allowed: The resource was found but the method is not allowed");
-        fprintf(stderr, "[%ld] Method Not Allowed: The request path was valid: %s, but the method is not allowed: %s\n", (long)getpid(), request->path, request->method);
+        SendHttpResponse(socket, 405, CONNECTION_ALIVE, TYPE_HTML, "Method Not Allowed: The resource was found but the method is not allowed");
+        fprintf(stderr, "[%ld] Method Not Allowed: The request path was valid: %s, but the method is not allowed: %s\n", GetLogId(), request->path, request->method);
         return 0;
     }
 
@@ -43,8 +44,8 @@ int Route_RacePage(int socket, Request* request)
     }
     if (raceid <= 0)
     {
-        SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "Not Found: Invalid race id");
-        fprintf(stderr, "[%ld] Not Found: Failed to create race page. Invalid race id was given in the query parameter: %s\n", (long)getpid(), request->query);
+        SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "Not Found: Invalid race id");
+        fprintf(stderr, "[%ld] Not Found: Failed to create race page. Invalid race id was given in the query parameter: %s\n", GetLogId(), request->query);
         return 0;
     }
 
@@ -58,20 +59,20 @@ int Route_RacePage(int socket, Request* request)
     if ((res = CreatePage_RaceResults(raceid, &PageBuffer, &PageBuffer_size)) < 0)
     {
         if (res == -2) {
-            SendHttpResponse(socket, 404, CONNECTION_CLOSE, TYPE_HTML, "Not Found: The requested race id could not be found");
-            fprintf(stderr, "[%ld] Not Found: Failed to create the race page since the requested raceid could not be found: %s\n", (long)getpid(), request->query);
+            SendHttpResponse(socket, 404, CONNECTION_ALIVE, TYPE_HTML, "Not Found: The requested race id could not be found");
+            fprintf(stderr, "[%ld] Not Found: Failed to create the race page since the requested raceid could not be found: %s\n", GetLogId(), request->query);
         }
         else {
-            SendHttpResponse(socket, 500, CONNECTION_CLOSE, TYPE_HTML, "Server Error: Failed to create the requested resource");
-            fprintf(stderr, "[%ld] Server Error: Failed to create the race page for the requested raceid: %s\n", (long)getpid(), request->query);
+            SendHttpResponse(socket, 500, CONNECTION_ALIVE, TYPE_HTML, "Server Error: Failed to create the requested resource");
+            fprintf(stderr, "[%ld] Server Error: Failed to create the race page for the requested raceid: %s\n", GetLogId(), request->query);
         }
         if (PageBuffer) { free(PageBuffer); }
         return 0;
     }
 
 
-    SendHttpResponse(socket, 200, CONNECTION_CLOSE, TYPE_HTML, PageBuffer);
-    fprintf(stderr, "[%ld] OK: The requested race page for (%s) was created and sent back to the client\n", (long)getpid(), request->query);
+    SendHttpResponse(socket, 200, CONNECTION_ALIVE, TYPE_HTML, PageBuffer);
+    fprintf(stderr, "[%ld] OK: The requested race page for (%s) was created and sent back to the client\n", GetLogId(), request->query);
     if (PageBuffer) { free(PageBuffer); }
     
     return 0;
@@ -0,0 +1,40 @@
+#include "Log.h"
+
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static thread_local long log_id = 0;
+static pthread_once_t fork_handler_once = PTHREAD_ONCE_INIT;
+
+static void InstallForkHandler();
+static void ResetInChild();
+
+
+/*
+ * ----------------------------------------------------------------
+ * Gets the id that is printed at the start of every log message
+ * This is the id of the calling thread, which is the same as the process id in single-threaded processes,
+ * so that messages from different worker threads can be told apart.
+ * The id is cached, and the cache is reset in forked children so that they log with their own id
+ * ----------------------------------------------------------------
+ */
+long GetLogId()
+{
+    if (log_id == 0) {
+        pthread_once(&fork_handler_once, InstallForkHandler);
+        log_id = (long) syscall(SYS_gettid);
+    }
+    return log_id;
+}
+
+
+static void InstallForkHandler()
+{
+    pthread_atfork(0, 0, ResetInChild);
+}
+
+static void ResetInChild()
+{
+    log_id = 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+
+/* ---------------------------------------------------
+ * Logging
+ * -------------------------------------------------- */
+long GetLogId();
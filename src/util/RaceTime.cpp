@@ -21,7 +21,7 @@ unsigned int RaceTime_string_to_ms(char* time_string)
     // Copy the given time_string since it needs to be modified
     char* str = 0;
     int str_size = strlen(time_string);
-    str = (char*) malloc(str_size * sizeof(char));
+    str = (char*) malloc((str_size + 1) * sizeof(char));
     if (str == 0)
         return -1;
     strcpy(str, time_string);